@@ -0,0 +1,250 @@
+/*
+ * main.cpp
+ *
+ *  Created on: 2026. 10. 17.
+ *      Author: tys
+ *
+ * Reactor balancing policies under skewed session lifetimes.
+ * every [reactors]th connection is long-lived, the others close after one request.
+ * round robin puts all the long-lived sessions on the same reactor.
+ * then the long-lived sessions ping-pong, reports the spread and the tail latency.
+ * the clients bind 127.0.0.x so the peer hash sees different addresses.
+ *
+ * usage: ./test [long-lived sessions] [requests per session] [reactors]
+ */
+
+#include <reactor/acceptor/AcceptorThread.h>
+#include <reactor/Reactors.h>
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <mutex>
+#include <chrono>
+#include <csignal>
+
+#include <string.h>
+#include <arpa/inet.h>
+#include <netinet/tcp.h>
+
+using namespace reactor;
+
+class EchoHandler : public EventHandler
+{
+protected:
+  void handle_registered() override {}
+
+  void handle_input() override
+  {
+    ssize_t recv_size = ::recv(io_handle_, buff_, sizeof(buff_), 0);
+    if (recv_size <= 0)
+    {
+      reactor_->remove_event_handler(this);
+      return;
+    }
+
+    ssize_t sent_size __attribute__((unused)) = ::send(io_handle_, buff_, recv_size, MSG_NOSIGNAL);
+  }
+
+  void handle_output  () override {}
+  void handle_close   () override { reactor_->remove_event_handler(this); }
+  void handle_timeout () override {}
+  void handle_error   (const int &, const std::string &) override {}
+  void handle_shutdown() override {}
+
+  void handle_removed () override
+  {
+    ::close(io_handle_);
+    delete this;
+  }
+
+private:
+  char buff_[4096];
+};
+
+class EchoHandlerFactory : public EventHandlerFactory
+{
+public:
+  EventHandler *create(const io_handle_t &, const sockaddr_storage &) override
+  { return new EchoHandler; }
+};
+
+static int
+connect_client(const uint16_t &port, const int &index)
+{
+  int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+
+  struct sockaddr_in local;
+  memset(&local, 0x00, sizeof(local));
+  local.sin_family      = AF_INET;
+  local.sin_addr.s_addr = htonl(0x7F000001 + (index % 250));
+  ::bind(fd, (struct sockaddr *)&local, sizeof(local));
+
+  struct sockaddr_in addr;
+  memset(&addr, 0x00, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_port   = htons(port);
+  inet_pton(AF_INET, "127.0.0.1", &addr.sin_addr);
+
+  if (::connect(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0)
+  {
+    ::close(fd);
+    return -1;
+  }
+
+  int enable = 1;
+  setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+  return fd;
+}
+
+static bool
+ping(const int &fd)
+{
+  char request[64];
+  memset(request, 'x', sizeof(request));
+  if (::send(fd, request, sizeof(request), 0) != sizeof(request))
+    return false;
+
+  size_t recvd = 0;
+  while (recvd < sizeof(request))
+  {
+    ssize_t size = ::recv(fd, request, sizeof(request), 0);
+    if (size <= 0)
+      return false;
+    recvd += size;
+  }
+
+  return true;
+}
+
+static void
+run_bench(const char *name, ReactorBalancer *balancer, const uint16_t &port,
+          const int &sessions, const int &requests, const size_t &reactor_num)
+{
+  Reactors reactors;
+  reactors.init(reactor_num, 10000, 100);
+  reactors.set_balancer(balancer);
+  reactors.start();
+
+  Acceptor acceptor;
+  if (acceptor.listen_ipv46(port, 1000) == false)
+  {
+    printf("[%s] listen failed %s\n", name, acceptor.err_str().c_str());
+    reactors.stop();
+    return;
+  }
+
+  EchoHandlerFactory factory;
+  AcceptorThread acceptor_thread(acceptor, reactors, factory);
+  acceptor_thread.start();
+
+  // skewed lifetimes. the short sessions are gone before the next connection.
+  std::vector<int> fds;
+  bool result = true;
+  for (int index = 0; index < sessions * (int)reactor_num && result == true; ++index)
+  {
+    int fd = connect_client(port, index);
+    if (fd < 0 || ping(fd) == false)
+    {
+      result = false;
+      break;
+    }
+
+    if (index % reactor_num == 0)
+    {
+      fds.push_back(fd);
+      continue;
+    }
+
+    ::close(fd);
+    while (reactors.handler_count() > fds.size())
+      std::this_thread::yield();
+  }
+
+  size_t max_sessions = 0, min_sessions = SIZE_MAX;
+  for (Reactor *reactor : reactors.get_reactors())
+  {
+    max_sessions = std::max(max_sessions, reactor->handler_count());
+    min_sessions = std::min(min_sessions, reactor->handler_count());
+  }
+
+  std::atomic<bool> failed{false};
+  std::mutex latencies_lock;
+  std::vector<uint32_t> latencies;
+  latencies.reserve(fds.size() * requests);
+
+  std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+
+  std::vector<std::thread> threads;
+  for (int fd : fds)
+    threads.emplace_back([&, fd]()
+    {
+      std::vector<uint32_t> local;
+      local.reserve(requests);
+
+      for (int count = 0; count < requests; ++count)
+      {
+        std::chrono::steady_clock::time_point sent = std::chrono::steady_clock::now();
+        if (ping(fd) == false)
+        {
+          failed = true;
+          return;
+        }
+        local.push_back(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - sent).count());
+      }
+
+      std::lock_guard<std::mutex> guard(latencies_lock);
+      latencies.insert(latencies.end(), local.begin(), local.end());
+    });
+
+  for (std::thread &thread : threads)
+    thread.join();
+
+  int64_t elapsed_usec =
+      std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - begin).count();
+
+  for (int fd : fds)
+    ::close(fd);
+
+  std::sort(latencies.begin(), latencies.end());
+  auto percentile = [&](const double &rate) -> double
+  {
+    if (latencies.size() == 0)
+      return 0;
+    return latencies[std::min(latencies.size() - 1, (size_t)(latencies.size() * rate))] / 1000.0;
+  };
+
+  printf("[%s] %s, sessions per reactor max %zu min %zu, %.0f req/s, p50 %.1f usec, p99 %.1f usec, p99.9 %.1f usec\n",
+         name, (result == true && failed == false) ? "ok" : "failed", max_sessions, min_sessions,
+         latencies.size() * 1000000.0 / (elapsed_usec > 0 ? elapsed_usec : 1),
+         percentile(0.5), percentile(0.99), percentile(0.999));
+
+  acceptor_thread.stop();
+  reactors.stop();
+  acceptor.close();
+}
+
+int main(int argc, char *argv[])
+{
+  signal(SIGPIPE, SIG_IGN);
+
+  int     sessions    = argc > 1 ? atoi(argv[1]) : 32;
+  int     requests    = argc > 2 ? atoi(argv[2]) : 2000;
+  size_t  reactor_num = argc > 3 ? atoi(argv[3]) : 4;
+
+  RoundRobinBalancer        round_robin;
+  LeastConnectionsBalancer  least_connections;
+  PowerOfTwoBalancer        power_of_two;
+  LeastLatencyBalancer      least_latency;
+  PeerHashBalancer          peer_hash;
+
+  run_bench("round robin      ", &round_robin,       30021, sessions, requests, reactor_num);
+  run_bench("least connections", &least_connections, 30022, sessions, requests, reactor_num);
+  run_bench("power of two     ", &power_of_two,      30023, sessions, requests, reactor_num);
+  run_bench("least latency    ", &least_latency,     30024, sessions, requests, reactor_num);
+  run_bench("peer hash        ", &peer_hash,         30025, sessions, requests, reactor_num);
+
+  return 0;
+}
@@ -0,0 +1,288 @@
+/*
+ * main.cpp
+ *
+ *  Created on: 2026. 10. 17.
+ *      Author: tys
+ *
+ * example/simple echo workload on the demuxer engines, head to head.
+ * (epoll, io_uring readiness, io_uring multishot accept/recv)
+ * reports the connect time, the throughput and the round trip latency.
+ *
+ * usage: ./test [connections] [requests per connection] [reactors]
+ */
+
+#include <reactor/acceptor/AcceptorThread.h>
+#include <reactor/EventHandlerAttr.h>
+#include <reactor/Reactors.h>
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <mutex>
+#include <chrono>
+#include <csignal>
+
+#include <string.h>
+#include <arpa/inet.h>
+#include <netinet/tcp.h>
+
+using namespace reactor;
+
+class EchoHandler : public EventHandler
+{
+public:
+  EchoHandler(const bool &recv_completion) { set_recv_completion(recv_completion); }
+
+protected:
+  void handle_registered() override {}
+
+  void handle_input() override
+  {
+    ssize_t recv_size = ::recv(io_handle_, buff_, sizeof(buff_), 0);
+    if (recv_size <= 0)
+      return;
+
+    size_ = recv_size;
+    reactor_->register_writable(this);
+  }
+
+  // io_uring engine, the reactor has received the data already.
+  void handle_recv(const uint8_t *data, const size_t &size) override
+  {
+    size_ = std::min(size, sizeof(buff_));
+    memcpy(buff_, data, size_);
+    reactor_->register_writable(this);
+  }
+
+  void handle_output() override
+  {
+    ssize_t sent_size __attribute__((unused)) = ::send(io_handle_, buff_, size_, MSG_NOSIGNAL);
+  }
+
+  void handle_close   () override { reactor_->remove_event_handler(this); }
+  void handle_timeout () override {}
+  void handle_error   (const int &, const std::string &) override {}
+  void handle_shutdown() override {}
+
+  void handle_removed () override
+  {
+    ::close(io_handle_);
+    delete this;
+  }
+
+private:
+  char    buff_[4096];
+  size_t  size_ = 0;
+};
+
+class EchoHandlerFactory : public EventHandlerFactory
+{
+public:
+  EventHandler *create(const io_handle_t &, const sockaddr_storage &) override
+  { return new EchoHandler(false); }
+};
+
+// multishot accept, registered by Reactor::register_acceptor.
+class EchoAcceptHandler : public EventHandler
+{
+public:
+  EchoAcceptHandler(Reactors &reactors) : reactors_(reactors) {}
+
+protected:
+  void handle_accept(const io_handle_t &io_handle) override
+  {
+    int enable = 1;
+    setsockopt(io_handle, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(int));
+
+    EchoHandler *handler = new EchoHandler(true);
+    EventHandlerAttr::io_handle(handler) = io_handle;
+    if (reactors_.get_reactor()->register_event_handler(handler, io_handle) == false)
+    {
+      ::close(io_handle);
+      delete handler;
+    }
+  }
+
+  void handle_registered() override {}
+  void handle_removed   () override {}
+  void handle_input     () override {}
+  void handle_output    () override {}
+  void handle_close     () override {}
+  void handle_timeout   () override {}
+  void handle_error     (const int &, const std::string &) override {}
+  void handle_shutdown  () override {}
+
+private:
+  Reactors &reactors_;
+};
+
+static bool
+run_clients(const uint16_t        &port,
+            const int             &connections,
+            const int             &requests,
+            int64_t               &connect_usec,
+            std::vector<uint32_t> &latencies)
+{
+  std::atomic<int>  failed{0};
+  std::atomic<int>  connected{0};
+  std::atomic<bool> go{false};
+  std::mutex        latencies_lock;
+  std::vector<std::thread> threads;
+
+  std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+
+  for (int connection = 0; connection < connections; ++connection)
+    threads.emplace_back([&]()
+    {
+      int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+      struct sockaddr_in addr;
+      memset(&addr, 0x00, sizeof(addr));
+      addr.sin_family = AF_INET;
+      addr.sin_port   = htons(port);
+      inet_pton(AF_INET, "127.0.0.1", &addr.sin_addr);
+
+      if (::connect(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0)
+      {
+        ++failed;
+        ++connected;
+        ::close(fd);
+        return;
+      }
+
+      int enable = 1;
+      setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+
+      ++connected;
+      while (go.load() == false)
+        std::this_thread::yield();
+
+      char request[64];
+      char response[64];
+      memset(request, 'x', sizeof(request));
+
+      std::vector<uint32_t> local;
+      local.reserve(requests);
+
+      for (int count = 0; count < requests; ++count)
+      {
+        std::chrono::steady_clock::time_point sent = std::chrono::steady_clock::now();
+        ::send(fd, request, sizeof(request), 0);
+
+        size_t recvd = 0;
+        while (recvd < sizeof(request))
+        {
+          ssize_t size = ::recv(fd, response, sizeof(response), 0);
+          if (size <= 0) { ++failed; ::close(fd); return; }
+          recvd += size;
+        }
+
+        local.push_back(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - sent).count());
+      }
+
+      ::close(fd);
+
+      std::lock_guard<std::mutex> guard(latencies_lock);
+      latencies.insert(latencies.end(), local.begin(), local.end());
+    });
+
+  while (connected.load() < connections)
+    std::this_thread::yield();
+
+  connect_usec =
+      std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - begin).count();
+  go = true;
+
+  for (std::thread &thread : threads)
+    thread.join();
+
+  return failed.load() == 0;
+}
+
+enum MODE { MODE_EPOLL, MODE_URING_POLL, MODE_URING_COMPLETION };
+
+static void
+run_bench(const char *name, const MODE &mode, const uint16_t &port,
+          const int &connections, const int &requests, const size_t &reactor_num)
+{
+  Reactors reactors;
+  if (reactors.init(reactor_num, 10000, 100, nullptr,
+                    mode == MODE_EPOLL ? Reactor::IoDemuxer::ENGINE_EPOLL
+                                       : Reactor::IoDemuxer::ENGINE_IO_URING) == false)
+  {
+    printf("[%s] io_uring is not available\n", name);
+    return;
+  }
+  reactors.start();
+
+  Acceptor acceptor;
+  if (acceptor.listen_ipv46(port, 1000) == false)
+  {
+    printf("[%s] listen failed %s\n", name, acceptor.err_str().c_str());
+    reactors.stop();
+    return;
+  }
+
+  EchoHandlerFactory  factory;
+  EchoAcceptHandler   accept_handler(reactors);
+  AcceptorThread      *acceptor_thread = nullptr;
+
+  if (mode == MODE_URING_COMPLETION)
+  {
+    EventHandlerAttr::io_handle(&accept_handler) = acceptor.io_handle();
+    reactors.get_reactors()[0]->register_acceptor(&accept_handler, acceptor.io_handle());
+  }
+  else
+  {
+    acceptor_thread = new AcceptorThread(acceptor, reactors, factory);
+    acceptor_thread->start();
+  }
+
+  int64_t connect_usec = 0;
+  std::vector<uint32_t> latencies;
+  latencies.reserve((size_t)connections * requests);
+
+  std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+  bool result = run_clients(port, connections, requests, connect_usec, latencies);
+  int64_t elapsed_usec =
+      std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - begin).count();
+
+  std::sort(latencies.begin(), latencies.end());
+  auto percentile = [&](const double &rate) -> double
+  {
+    if (latencies.size() == 0)
+      return 0;
+    return latencies[std::min(latencies.size() - 1, (size_t)(latencies.size() * rate))] / 1000.0;
+  };
+
+  double total_requests = (double)connections * requests;
+  printf("[%s] %s, %d x %d requests, connect %ld usec, %.0f req/s, p50 %.1f usec, p99 %.1f usec, p99.9 %.1f usec\n",
+         name, result ? "ok" : "failed", connections, requests, connect_usec,
+         total_requests * 1000000 / (elapsed_usec - connect_usec),
+         percentile(0.5), percentile(0.99), percentile(0.999));
+
+  if (acceptor_thread != nullptr)
+  {
+    acceptor_thread->stop();
+    delete acceptor_thread;
+  }
+
+  reactors.stop();
+  acceptor.close();
+}
+
+int main(int argc, char *argv[])
+{
+  signal(SIGPIPE, SIG_IGN);
+
+  int     connections = argc > 1 ? atoi(argv[1]) : 16;
+  int     requests    = argc > 2 ? atoi(argv[2]) : 10000;
+  size_t  reactor_num = argc > 3 ? atoi(argv[3]) : 1;
+
+  run_bench("epoll              ", MODE_EPOLL,            30011, connections, requests, reactor_num);
+  run_bench("io_uring poll      ", MODE_URING_POLL,       30012, connections, requests, reactor_num);
+  run_bench("io_uring completion", MODE_URING_COMPLETION, 30013, connections, requests, reactor_num);
+
+  return 0;
+}
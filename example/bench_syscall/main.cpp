@@ -0,0 +1,246 @@
+/*
+ * main.cpp
+ *
+ *  Created on: 2026. 10. 17.
+ *      Author: tys
+ *
+ * Counts the server side syscalls per request of a small ping-pong echo.
+ * (MSG_PEEK compatibility mode, default, edge-triggered)
+ * recv/send/read/write/epoll_wait/epoll_ctl are interposed in this binary,
+ * the client threads are excluded from the counters.
+ *
+ * usage: ./test [connections] [requests per connection]
+ */
+
+#include <tcp_reactor/tcp_reactor.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <chrono>
+#include <csignal>
+
+#include <dlfcn.h>
+#include <arpa/inet.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+
+using namespace reactor;
+
+enum { SYS_RECV, SYS_SEND, SYS_READ, SYS_WRITE, SYS_EPOLL_WAIT, SYS_EPOLL_CTL, SYS_MAX };
+static const char *syscall_names[SYS_MAX] = { "recv", "send", "read", "write", "epoll_wait", "epoll_ctl" };
+
+static std::atomic<uint64_t> syscall_counts[SYS_MAX];
+static thread_local bool     bench_client = false;
+
+static inline void count_syscall(const int &type)
+{
+  if (bench_client == false)
+    syscall_counts[type].fetch_add(1, std::memory_order_relaxed);
+}
+
+#define REAL_FUNC(name) \
+  static auto real = reinterpret_cast<decltype(&::name)>(dlsym(RTLD_NEXT, #name))
+
+extern "C"
+{
+ssize_t recv(int fd, void *buf, size_t len, int flags)
+{
+  REAL_FUNC(recv);
+  count_syscall(SYS_RECV);
+  return real(fd, buf, len, flags);
+}
+
+ssize_t send(int fd, const void *buf, size_t len, int flags)
+{
+  REAL_FUNC(send);
+  count_syscall(SYS_SEND);
+  return real(fd, buf, len, flags);
+}
+
+ssize_t read(int fd, void *buf, size_t count)
+{
+  REAL_FUNC(read);
+  count_syscall(SYS_READ);
+  return real(fd, buf, count);
+}
+
+ssize_t write(int fd, const void *buf, size_t count)
+{
+  REAL_FUNC(write);
+  count_syscall(SYS_WRITE);
+  return real(fd, buf, count);
+}
+
+int epoll_wait(int epfd, struct epoll_event *events, int maxevents, int timeout)
+{
+  REAL_FUNC(epoll_wait);
+  count_syscall(SYS_EPOLL_WAIT);
+  return real(epfd, events, maxevents, timeout);
+}
+
+int epoll_ctl(int epfd, int op, int fd, struct epoll_event *event)
+{
+  REAL_FUNC(epoll_ctl);
+  count_syscall(SYS_EPOLL_CTL);
+  return real(epfd, op, fd, event);
+}
+}
+
+class EchoSession : public TCPSessionHandler
+{
+public:
+  EchoSession(const sockaddr_storage &addr) : TCPSessionHandler(addr) {}
+
+protected:
+  void handle_registered() override {}
+  void handle_removed   () override { delete this; }
+  void handle_input     () override
+  {
+    // edge-triggered reads until EAGAIN.
+    while (true)
+    {
+      ssize_t recv_size = ::recv(io_handle(), buffer_, sizeof(buffer_), 0);
+      if (recv_size <= 0)
+      {
+        if (recv_size == 0 || errno != EAGAIN)
+          close();
+        return;
+      }
+
+      send(0, (const uint8_t *)buffer_, recv_size);
+      if (edge_triggered() == false)
+        return;
+    }
+  }
+
+  void handle_sent      (const int32_t &, const uint8_t *, const size_t &) override {}
+  void handle_close     () override {}
+  void handle_timeout   (const int64_t &) override {}
+  void handle_error     (const int &, const std::string &) override {}
+  void handle_sent_error(const int &, const std::string &,
+                         const int32_t &, const uint8_t *, const size_t &) override {}
+  void handle_shutdown  () override {}
+
+private:
+  char buffer_[4096];
+};
+
+class EchoSessionFactory : public TCPSessionHandlerFactory
+{
+public:
+  TCPSessionHandler *create(const io_handle_t &, const sockaddr_storage &addr) override
+  { return new EchoSession(addr); }
+};
+
+static bool
+run_clients(const uint16_t &port, const int &connections, const int &requests)
+{
+  std::atomic<int> failed{0};
+  std::vector<std::thread> threads;
+
+  for (int connection = 0; connection < connections; ++connection)
+    threads.emplace_back([&]()
+    {
+      bench_client = true;
+
+      int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+      struct sockaddr_in addr;
+      memset(&addr, 0x00, sizeof(addr));
+      addr.sin_family = AF_INET;
+      addr.sin_port   = htons(port);
+      inet_pton(AF_INET, "127.0.0.1", &addr.sin_addr);
+
+      if (::connect(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0)
+      {
+        ++failed;
+        ::close(fd);
+        return;
+      }
+
+      int enable = 1;
+      setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+
+      char request[64] = "GET / HTTP/1.1\r\n\r\n";
+      char response[64];
+      size_t request_size = strlen(request);
+
+      for (int count = 0; count < requests; ++count)
+      {
+        ::send(fd, request, request_size, 0);
+
+        size_t recvd = 0;
+        while (recvd < request_size)
+        {
+          ssize_t size = ::recv(fd, response, sizeof(response), 0);
+          if (size <= 0) { ++failed; ::close(fd); return; }
+          recvd += size;
+        }
+      }
+
+      ::close(fd);
+    });
+
+  for (std::thread &thread : threads)
+    thread.join();
+
+  return failed.load() == 0;
+}
+
+static void
+run_bench(const char *name, const bool &peek_on_read, const bool &edge_triggered,
+          const uint16_t &port, const int &connections, const int &requests)
+{
+  EchoSessionFactory factory;
+  TCPReactor server;
+
+  server.set_acceptor_ipv46(&factory, port);
+  server.set_reactor(1, 10000, 100);
+  server.reactors.set_peek_on_read  (peek_on_read);
+  server.reactors.set_edge_triggered(edge_triggered);
+  if (server.start() == false)
+  {
+    printf("%s: start failed %s\n", name, server.acceptor.err_str().c_str());
+    return;
+  }
+
+  for (std::atomic<uint64_t> &count : syscall_counts)
+    count = 0;
+
+  std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+  bool result = run_clients(port, connections, requests);
+  int64_t elapsed_usec =
+      std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - begin).count();
+
+  // wait for the close events.
+  std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+  uint64_t total = 0;
+  for (std::atomic<uint64_t> &count : syscall_counts)
+    total += count;
+
+  double total_requests = (double)connections * requests;
+
+  printf("[%s] %s, %d x %d requests, %ld usec\n",
+         name, result ? "ok" : "failed", connections, requests, elapsed_usec);
+  for (int type = 0; type < SYS_MAX; ++type)
+    printf("  %-10s %10lu  %6.2f/req\n",
+           syscall_names[type], syscall_counts[type].load(), syscall_counts[type] / total_requests);
+  printf("  %-10s %10lu  %6.2f/req\n", "total", total, total / total_requests);
+
+  server.stop();
+}
+
+int main(int argc, char *argv[])
+{
+  signal(SIGPIPE, SIG_IGN);
+
+  int connections = argc > 1 ? atoi(argv[1]) : 16;
+  int requests    = argc > 2 ? atoi(argv[2]) : 10000;
+
+  run_bench("MSG_PEEK  ", true,  false, 30001, connections, requests);
+  run_bench("no peek   ", false, false, 30002, connections, requests);
+  run_bench("edge      ", false, true,  30003, connections, requests);
+
+  return 0;
+}
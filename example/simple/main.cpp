@@ -9,6 +9,7 @@
 #include <reactor/Reactors.h>
 #include <reactor/trace.h>
 
+#include <deque>
 #include <string.h>
 
 using namespace reactor;
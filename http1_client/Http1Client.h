@@ -130,12 +130,13 @@ Http1Client::handle_timeout()
 {
   int32_t min_msec = 0;
 
+  std::vector<int64_t> timeouts;
   while ((min_msec = timer_.get_min_timeout_milliseconds()) == 0)
   {
-    std::deque<std::unordered_set<int64_t>> timeouts = timer_.extract_timeout_objects();
-    for (const auto &keys : timeouts)
-      for (const auto &key : keys)
-        on_timeout(key);
+    timeouts.clear();
+    timer_.extract_timeout_objects(timeouts);
+    for (const int64_t &key : timeouts)
+      on_timeout(key);
   }
 
   if (min_msec <= 0)
@@ -5,7 +5,9 @@
 #include <http1_protocol/HttpHeader.h>
 #include <http1_protocol/HttpStatus.h>
 #include <http1_protocol/HttpVersion.h>
+#include <http1_protocol/HttpRange.h>
 #include <websocket/WebSocket.h>
+#include <reactor/SendQueue.h>
 #include <reactor/trace.h>
 
 #include <string_view>
@@ -64,6 +66,28 @@ public:
   std::string
   packet(const bool &with_content_length = true);
 
+  /**
+   * the body is length bytes of file at offset, sent by sendfile(). (Http1Handler)
+   * content-length is set, body is not used.
+   */
+  void
+  set_body_file(const SendQueue::FilePtr &file, const size_t &offset, const size_t &length);
+
+  const SendQueue::FilePtr &body_file       () const { return body_file_; }
+  const size_t             &body_file_offset() const { return body_file_offset_; }
+  const size_t             &body_file_length() const { return body_file_length_; }
+
+  /**
+   * the response of the file at path, Range of request_header is applied. (a single range)
+   * 200, 206 with content-range or 416.
+   * nullopt: the file can not be opened or it is not a regular file, errno is set. (e.g. 404)
+   */
+  static std::optional<Http1Response>
+  file(const int32_t     &stream_id,
+       const std::string &path,
+       const HttpHeader  &request_header  = {},
+       const HttpHeader  &response_header = {});
+
   static Http1Response  // 웹소켓으로 업그레이드 응답을 만들어줌.
   websocket_permission(const int32_t     &stream_id,
                        const std::string &sec_websocket_key,
@@ -80,6 +104,10 @@ protected:
 protected:
   int32_t status_ = 0;
 
+  SendQueue::FilePtr  body_file_;
+  size_t              body_file_offset_ = 0;
+  size_t              body_file_length_ = 0;
+
   friend class Http1Protocol<Http1Response>;
 };
 
@@ -167,6 +195,67 @@ Http1Response::packet(const bool &with_content_length)
   return packet + body;
 }
 
+inline void
+Http1Response::set_body_file(const SendQueue::FilePtr &file, const size_t &offset, const size_t &length)
+{
+  body_file_        = file;
+  body_file_offset_ = offset;
+  body_file_length_ = length;
+
+  header.set("content-length", std::to_string(length));
+}
+
+inline std::optional<Http1Response>
+Http1Response::file(const int32_t     &stream_id,
+                    const std::string &path,
+                    const HttpHeader  &request_header,
+                    const HttpHeader  &response_header)
+{
+  SendQueue::FilePtr file = SendQueue::File::open(path);
+  if (file == nullptr)
+    return std::nullopt;
+
+  // a directory, a fifo or a device.
+  if (file->regular() == false)
+  {
+    errno = EINVAL;
+    return std::nullopt;
+  }
+
+  int64_t size = file->size();
+  if (size < 0)
+    return std::nullopt;
+
+  HttpRange range;
+  HttpRange::RESULT result = HttpRange::RANGE_NONE;
+  if (request_header.contains("range") == true)
+    result = HttpRange::parse(request_header.ref_value("range"), size, range);
+
+  Http1Response h1(stream_id, 200, response_header);
+  h1.header.set("accept-ranges", "bytes");
+
+  switch (result)
+  {
+    case HttpRange::RANGE_PARTIAL:
+      h1.status_ = 206;
+      h1.header.set("content-range", range.content_range(size));
+      h1.set_body_file(file, range.offset, range.length);
+      break;
+
+    case HttpRange::RANGE_NOT_SATISFIABLE:
+      h1.status_ = 416;
+      h1.header.set("content-range",  HttpRange::unsatisfied_range(size));
+      h1.header.set("content-length", "0");
+      break;
+
+    default:
+      h1.set_body_file(file, 0, size);
+      break;
+  }
+
+  return h1;
+}
+
 inline std::optional<Http1Response>
 Http1Response::parse(const std::string_view &message)
 {
@@ -0,0 +1,134 @@
+/*
+ * HttpRange.h
+ *
+ *  Created on: 2026. 10. 17.
+ *      Author: tys
+ */
+
+#ifndef HTTPPROTOCOL_HTTPRANGE_H_
+#define HTTPPROTOCOL_HTTPRANGE_H_
+
+#include <http1_protocol/HttpHeader.h>
+#include <string>
+#include <cctype>
+
+namespace https_reactor
+{
+
+// Range: bytes=... of a request, a single range. (RFC 7233)
+// the multiple ranges (multipart/byteranges) are ignored, the whole is sent.
+class HttpRange
+{
+public:
+  typedef enum
+  {
+    RANGE_NONE            = 0,  // no range or ignored, 200 with the whole.
+    RANGE_PARTIAL         = 1,  // 206 Partial Content
+    RANGE_NOT_SATISFIABLE = 2,  // 416 Range Not Satisfiable
+  } RESULT;
+
+  size_t offset = 0;
+  size_t length = 0;
+
+  // value of the Range header, size of the representation.
+  static RESULT parse(const std::string &value, const size_t &size, HttpRange &range);
+
+  // content-range of 206, "bytes first-last/size"
+  std::string content_range(const size_t &size) const
+  {
+    return "bytes " + std::to_string(offset) + "-" + std::to_string(offset + length - 1) +
+           "/" + std::to_string(size);
+  }
+
+  // content-range of 416, "bytes */size"
+  static std::string unsatisfied_range(const size_t &size)
+  {
+    return "bytes */" + std::to_string(size);
+  }
+
+private:
+  // digits only, false: empty or overflow.
+  static bool to_number(const std::string &str, size_t &number);
+};
+
+inline HttpRange::RESULT
+HttpRange::parse(const std::string &value, const size_t &size, HttpRange &range)
+{
+  std::string spec = value;
+  spec.erase(0, spec.find_first_not_of(' '));
+  spec.erase(spec.find_last_not_of(' ') + 1);
+
+  if (HttpHeader::to_lower(spec.substr(0, 6)) != "bytes=")
+    return RANGE_NONE;
+
+  spec.erase(0, 6);
+  if (spec.find(',') != std::string::npos)
+    return RANGE_NONE;
+
+  std::string::size_type dash = spec.find('-');
+  if (dash == std::string::npos)
+    return RANGE_NONE;
+
+  std::string first_str = spec.substr(0, dash);
+  std::string last_str  = spec.substr(dash + 1);
+
+  // bytes=-n, the last n bytes.
+  if (first_str.empty() == true)
+  {
+    size_t suffix = 0;
+    if (to_number(last_str, suffix) == false)
+      return RANGE_NONE;
+
+    if (suffix == 0 || size == 0)
+      return RANGE_NOT_SATISFIABLE;
+
+    range.length = suffix < size ? suffix : size;
+    range.offset = size - range.length;
+    return RANGE_PARTIAL;
+  }
+
+  size_t first = 0;
+  if (to_number(first_str, first) == false)
+    return RANGE_NONE;
+
+  size_t last = size > 0 ? size - 1 : 0;
+  // bytes=first-last, bytes=first-
+  if (last_str.empty() == false)
+  {
+    size_t number = 0;
+    if (to_number(last_str, number) == false || number < first)
+      return RANGE_NONE;
+
+    if (number < last)
+      last = number;
+  }
+
+  if (first >= size)
+    return RANGE_NOT_SATISFIABLE;
+
+  range.offset = first;
+  range.length = last - first + 1;
+  return RANGE_PARTIAL;
+}
+
+inline bool
+HttpRange::to_number(const std::string &str, size_t &number)
+{
+  if (str.empty() == true || str.length() > 18)
+    return false;
+
+  number = 0;
+  for (const char &ch : str)
+  {
+    if (std::isdigit((unsigned char)ch) == 0)
+      return false;
+
+    number = number * 10 + (ch - '0');
+  }
+
+  return true;
+}
+
+}
+
+#endif /* HTTPPROTOCOL_HTTPRANGE_H_ */
@@ -1,5 +1,6 @@
 #include <http1_reactor/Http1Handler.h>
 #include <tcp_reactor/TCPEventHandler.h>
+#include <algorithm>
 
 using namespace https_reactor;
 
@@ -17,18 +18,28 @@ Http1Handler::next_stream_id()
 void
 Http1Handler::handle_input()
 {
-  if (websocket_ == true)
+  // edge-triggered이면 EAGAIN까지 읽는다.
+  while (true)
   {
-    this->handle_input_ws();
-    return;
+    bool read_more = (websocket_ == true) ? this->handle_input_ws() : this->handle_input_http1();
+    if (read_more == false || edge_triggered() == false)
+      return;
   }
+}
 
+// 계속 읽을 수 있으면 true
+bool
+Http1Handler::handle_input_http1()
+{
   ssize_t recvd_size = ::recv(this->io_handle(),
                               buffer_http1_.data()+buffer_http1_recvd_,
                               buffer_http1_.size()-buffer_http1_recvd_, 0);
 
   if (recvd_size <= 0)
   {
+    if (recvd_size < 0 && errno == EAGAIN)
+      return false;
+
     if (recvd_size < 0)
     {
       char err_buff[256];
@@ -36,33 +47,43 @@ Http1Handler::handle_input()
     }
 
     ::shutdown(this->io_handle(), SHUT_RD);
-    return;
+    return false;
   }
 
   buffer_http1_recvd_ += recvd_size;
+  parse_http1();
+
+  return true;
+}
+
+void
+Http1Handler::parse_http1()
+{
   try
   {
     // HTTP 1.1규약상 한번에 하나의 메세지만 온다.
     std::optional<Http1Request> h1req_opt =
-        Http1Request::parse(std::string_view(buffer_http1_.data(), buffer_http1_.size()));
+        Http1Request::parse(std::string_view(buffer_http1_.data(), buffer_http1_recvd_));
 
     // incomplete
     if (h1req_opt.has_value() == false)
       return;
 
-    buffer_http1_.clear();
+    buffer_http1_recvd_ = 0;
 
     h1req_opt->stream_id = next_stream_id();
+
+    ++requests_in_progress_;
     this->handle_request(h1req_opt.value());
   }
   catch (const std::exception &e)
   {
-    buffer_http1_.clear();
+    buffer_http1_recvd_ = 0;
     this->handle_error(EINVAL, e.what());
   }
 }
 
-void
+bool
 Http1Handler::handle_input_ws()
 {
   ssize_t recvd_size = ::recv(this->io_handle(),
@@ -71,6 +92,9 @@ Http1Handler::handle_input_ws()
 
   if (recvd_size <= 0)
   {
+    if (recvd_size < 0 && errno == EAGAIN)
+      return false;
+
     if (recvd_size < 0)
     {
       char err_buff[1024];
@@ -78,18 +102,29 @@ Http1Handler::handle_input_ws()
     }
 
     ::shutdown(this->io_handle(), SHUT_RD);
-    return;
+    return false;
   }
 
   buffer_websocket_recvd_ += recvd_size;
+  parse_ws();
+
+  return true;
+}
+
+void
+Http1Handler::parse_ws()
+{
   std::deque<WebSocket> requests;
   while (true)
   {
     try
     {
-      WebSocket request = WebSocket::parse(buffer_websocket_.data(), buffer_websocket_.size());
+      WebSocket request = WebSocket::parse(buffer_websocket_.data(), buffer_websocket_recvd_);
 
-      buffer_websocket_.erase(buffer_websocket_.begin(), buffer_websocket_.begin()+request.size());
+      // 버퍼 크기는 유지하고 남은 데이터를 앞으로 당긴다.
+      std::copy(buffer_websocket_.begin()+request.size(),
+                buffer_websocket_.begin()+buffer_websocket_recvd_,
+                buffer_websocket_.begin());
       buffer_websocket_recvd_ -= request.size();
 
       requests.emplace_back(request);
@@ -109,7 +144,6 @@ Http1Handler::handle_input_ws()
 
       this->handle_error(EINVAL, e.what());
 
-      buffer_websocket_.clear();
       buffer_websocket_recvd_ = 0;
       return;
     }
@@ -119,6 +153,35 @@ Http1Handler::handle_input_ws()
     this->handle_request(requests);
 }
 
+void
+Http1Handler::handle_recv(const uint8_t *data, const size_t &size)
+{
+  // 버퍼가 가득 찬 경우 recv() == 0과 같이 처리한다.
+  if (websocket_ == true)
+  {
+    if (size > buffer_websocket_.size() - buffer_websocket_recvd_)
+    {
+      ::shutdown(this->io_handle(), SHUT_RD);
+      return;
+    }
+
+    memcpy(buffer_websocket_.data()+buffer_websocket_recvd_, data, size);
+    buffer_websocket_recvd_ += size;
+    parse_ws();
+    return;
+  }
+
+  if (size > buffer_http1_.size() - buffer_http1_recvd_)
+  {
+    ::shutdown(this->io_handle(), SHUT_RD);
+    return;
+  }
+
+  memcpy(buffer_http1_.data()+buffer_http1_recvd_, data, size);
+  buffer_http1_recvd_ += size;
+  parse_http1();
+}
+
 bool
 Http1Handler::send(const Http1Response &response)
 {
@@ -137,7 +200,27 @@ Http1Handler::send(const Http1Response &response)
     sent_res_http1_[response.stream_id] = response;
   }
 
-  return TCPSessionHandler::send(response.stream_id, response.packet());
+  bool sent = false;
+  // the body is not read, sendfile() after the header.
+  if (response.body_file() != nullptr)
+    sent = TCPSessionHandler::send(response.stream_id,
+                                   response.packet(),
+                                   response.body_file(),
+                                   response.body_file_offset(),
+                                   response.body_file_length());
+  else
+    sent = TCPSessionHandler::send(response.stream_id, response.packet());
+
+  if (sent == true)
+    return true;
+
+  {
+    std::lock_guard<std::mutex> guard(sent_res_http1_lock_);
+    sent_res_http1_.erase(response.stream_id);
+  }
+
+  request_done(false);
+  return false;
 }
 
 int32_t
@@ -149,18 +232,75 @@ Http1Handler::send(const WebSocket &response)
     return -1;
   }
 
+  // the packet of the frame is queued, not copied again.
+  auto frame = std::make_shared<const WebSocket>(response);
+
   int32_t stream_id = next_stream_id();
   {
     std::lock_guard<std::mutex> guard(sent_res_ws_lock_);
-    sent_res_ws_[stream_id] = response;
+    sent_res_ws_[stream_id] = frame;
   }
 
-  if (TCPSessionHandler::send(stream_id, response.packet().data(), response.packet().size()) == false)
+  if (TCPSessionHandler::send(stream_id, SendQueue::BytesPtr(frame, &frame->packet())) == false)
+  {
+    std::lock_guard<std::mutex> guard(sent_res_ws_lock_);
+    sent_res_ws_.erase(stream_id);
     return -1;
+  }
 
   return stream_id;
 }
 
+size_t
+Http1Handler::broadcast(Http1Handler *const  *sessions,
+                        const size_t         &count,
+                        const WebSocket      &response)
+{
+  auto frame = std::make_shared<const WebSocket>(response);
+
+  std::vector<Http1Handler      *> targets;
+  std::vector<TCPSessionHandler *> handlers;
+  std::vector<int32_t>             stream_ids;
+  targets   .reserve(count);
+  handlers  .reserve(count);
+  stream_ids.reserve(count);
+
+  for (size_t index = 0; index < count; ++index)
+  {
+    Http1Handler *session = sessions[index];
+    if (session->websocket_.load() == false)
+      continue;
+
+    int32_t stream_id = session->next_stream_id();
+    {
+      std::lock_guard<std::mutex> guard(session->sent_res_ws_lock_);
+      session->sent_res_ws_[stream_id] = frame;
+    }
+
+    targets   .push_back(session);
+    handlers  .push_back(session);
+    stream_ids.push_back(stream_id);
+  }
+
+  std::unique_ptr<bool[]> results(new bool[targets.size()]);
+  size_t queued = TCPSessionHandler::send(handlers.data(),
+                                          stream_ids.data(),
+                                          handlers.size(),
+                                          SendQueue::BytesPtr(frame, &frame->packet()),
+                                          results.get());
+
+  for (size_t index = 0; index < targets.size(); ++index)
+  {
+    if (results[index] == true)
+      continue;
+
+    std::lock_guard<std::mutex> guard(targets[index]->sent_res_ws_lock_);
+    targets[index]->sent_res_ws_.erase(stream_ids[index]);
+  }
+
+  return queued;
+}
+
 void
 Http1Handler::handle_sent_error(const int           &err_no,
                                 const std::string   &err_str,
@@ -185,24 +325,25 @@ Http1Handler::handle_sent_error(const int           &err_no,
     if (response.is_websocket_upgrade() == true)
       websocket_ = true;
 
+    request_done();
     return true;
   };
 
   if (http1_send_error() == true)
     return;
 
-  WebSocket response;
+  std::shared_ptr<const WebSocket> response;
   {
     std::lock_guard<std::mutex> guard(sent_res_ws_lock_);
     auto it = sent_res_ws_.find(stream_id);
     if (it == sent_res_ws_.end())
       return;
 
-    response = it->second;
+    response = std::move(it->second);
     sent_res_ws_.erase(it);
   }
 
-  this->handle_sent_error(err_no, err_str, stream_id, response);
+  this->handle_sent_error(err_no, err_str, stream_id, *response);
 }
 
 void
@@ -211,18 +352,18 @@ Http1Handler::handle_sent(const int32_t &stream_id, const uint8_t *data, const s
   if (handle_sent_http1(stream_id, data, size) == true)
     return;
 
-  WebSocket response;
+  std::shared_ptr<const WebSocket> response;
   {
     std::lock_guard<std::mutex> guard(sent_res_ws_lock_);
     auto it = sent_res_ws_.find(stream_id);
     if (it == sent_res_ws_.end())
       return;
 
-    response = it->second;
+    response = std::move(it->second);
     sent_res_ws_.erase(it);
   }
 
-  this->handle_sent(stream_id, response);
+  this->handle_sent(stream_id, *response);
 }
 
 bool
@@ -247,15 +388,38 @@ Http1Handler::handle_sent_http1(const int32_t &stream_id,
 
   this->handle_sent(response);
 
+  request_done();
   return true;
 }
 
+void
+Http1Handler::request_done(const bool &responded)
+{
+  size_t count = requests_in_progress_.load();
+  while (count > 0 && requests_in_progress_.compare_exchange_weak(count, count - 1) == false)
+    ;
 
+  if (responded == true)
+    responded_ = true;
 
+  if (draining_ == true && requests_in_progress_ == 0)
+    close_after_sent();
+}
 
+void
+Http1Handler::handle_drain()
+{
+  draining_ = true;
 
+  if (websocket_ == true || (responded_ == true && requests_in_progress_ == 0))
+    close_after_sent();
+}
 
+void
+Http1Handler::handle_idle(const EventHandler::IDLE_TYPE &type)
+{
+  if (requests_in_progress_ > 0)
+    return;
 
-
-
-
+  TCPSessionHandler::handle_idle(type);
+}
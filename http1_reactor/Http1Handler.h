@@ -30,6 +30,9 @@ public: // interface
                const size_t           &buffer_websocket_size  = 65535*10)
   : TCPSessionHandler(client_addr), websocket_(false)
   {
+    // io_uring engine이면 reactor가 수신한 데이터를 바로 받는다.
+    set_recv_completion(true);
+
     buffer_http1_     .resize(buffer_http1_size);
     buffer_websocket_ .resize(buffer_websocket_size);
   }
@@ -39,6 +42,20 @@ public: // interface
   int32_t       send              (const WebSocket      &response);
   bool          is_websocket      () const { return websocket_.load(); }
 
+  /**
+   * send of a websocket frame to the sessions, the frame is made once and shared. (fan-out)
+   * the reactor of the sessions is woken up once for the batch.
+   * the sessions not in the websocket state are skipped.
+   * handle_sent(stream_id, response) of each session refers the same frame.
+   * returns the count queued.
+   */
+  static size_t broadcast         (Http1Handler *const  *sessions,
+                                   const size_t         &count,
+                                   const WebSocket      &response);
+  static size_t broadcast         (const std::vector<Http1Handler *> &sessions,
+                                   const WebSocket      &response)
+  { return broadcast(sessions.data(), sessions.size(), response); }
+
 protected: // virtual method
   // http 1.1  reqeust & sent
   virtual void  handle_request    (const Http1Request   &request )  = 0;
@@ -64,13 +81,25 @@ protected: // virtual method
                                    const std::string    &err_str)    { (void)err_no; (void)err_str; }
   virtual void  handle_close      () {};
   virtual void  handle_shutdown   () {};
+  /**
+   * idle keep-alive and websocket: closed now, a request in progress: after its response.
+   * a new connection is closed after its first response, its request may be on the way.
+   */
+  virtual void  handle_drain      () override;
+  // a request in progress is not idle, the application has not responded yet.
+  virtual void  handle_idle       (const EventHandler::IDLE_TYPE &type) override;
 
 protected: // interface
   int32_t       next_stream_id    ();
 
 private:
   void          handle_input      () override;
-  void          handle_input_ws   ();
+  bool          handle_input_http1();
+  bool          handle_input_ws   ();
+  void          handle_recv       (const uint8_t        *data,
+                                   const size_t         &size) override;
+  void          parse_http1       ();
+  void          parse_ws          ();
   void          handle_sent       (const int32_t        &stream_id,
                                    const uint8_t        *data,
                                    const size_t         &size) override;
@@ -100,11 +129,21 @@ private:
   std::map<int32_t, Http1Response> sent_res_http1_;
 
 private:
+  // the frame of a broadcast is shared by the sessions.
   std::mutex sent_res_ws_lock_;
-  std::map<int32_t, WebSocket> sent_res_ws_;
+  std::map<int32_t, std::shared_ptr<const WebSocket>> sent_res_ws_;
 
 private:
   std::atomic<bool> websocket_;
+
+private:
+  // handle_request ~ handle_sent of its response, or a refused send. (send() of any thread)
+  std::atomic<size_t> requests_in_progress_{0};
+  std::atomic<bool>   responded_{false};
+  std::atomic<bool>   draining_{false};
+
+  // responded false: the response was not sent. (refused)
+  void    request_done(const bool &responded = true);
 };
 
 }
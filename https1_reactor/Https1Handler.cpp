@@ -36,6 +36,8 @@ Https1Handler::handle_input(const uint8_t *data, const size_t &size)
     buffer_http1_.clear();
 
     h1req_opt->stream_id = next_stream_id();
+
+    ++requests_in_progress_;
     this->handle_request(h1req_opt.value());
   }
   catch (const std::exception &e)
@@ -100,7 +102,134 @@ Https1Handler::send(const Http1Response &response)
     sent_res_http1_[response.stream_id] = response;
   }
 
-  return SSLSessionHandler::send(response.stream_id, response.packet());
+  {
+    std::lock_guard<std::mutex> guard(file_lock_);
+    // a body file is on the way, the response follows it. (send_waiting)
+    if (file_.file != nullptr)
+    {
+      file_waiting_.push_back(response);
+      return true;
+    }
+
+    if (send_response(response) == true)
+      return true;
+  }
+
+  int err_no = errno;
+  {
+    std::lock_guard<std::mutex> guard(sent_res_http1_lock_);
+    sent_res_http1_.erase(response.stream_id);
+  }
+
+  request_done(false);
+
+  if (err_no != ENOBUFS)
+    this->handle_error(SSL_STATE::NONE, err_no,
+                       "Https1Handler::send(const Http1Response &response) : The body file can not be read.");
+  return false;
+}
+
+bool
+Https1Handler::send_response(const Http1Response &response)
+{
+  std::string packet = response.packet();
+  if (response.body_file() != nullptr)
+  {
+    file_.stream_id = response.stream_id;
+    file_.file      = response.body_file();
+    file_.offset    = response.body_file_offset();
+    file_.remaining = response.body_file_length();
+
+    if (read_file_chunk(packet) == false)
+    {
+      file_ = file_t();
+      return false;
+    }
+  }
+
+  if (SSLSessionHandler::send(response.stream_id, packet) == true)
+    return true;
+
+  // refused by the send watermark, or closed.
+  file_ = file_t();
+  errno = ENOBUFS;
+  return false;
+}
+
+bool
+Https1Handler::read_file_chunk(std::string &data)
+{
+  size_t length = file_.remaining < (size_t)FILE_CHUNK_SIZE ? file_.remaining : (size_t)FILE_CHUNK_SIZE;
+  if (file_.file->read(file_.offset, length, data) == false)
+    return false;
+
+  file_.offset    += length;
+  file_.remaining -= length;
+  return true;
+}
+
+bool
+Https1Handler::send_file_chunk(const int32_t &stream_id)
+{
+  int err_no = 0;
+  {
+    std::lock_guard<std::mutex> guard(file_lock_);
+    if (file_.file == nullptr || file_.stream_id != stream_id)
+      return false;
+
+    // the last chunk is sent.
+    if (file_.remaining == 0)
+    {
+      file_ = file_t();
+      return false;
+    }
+
+    std::string chunk;
+    if (read_file_chunk(chunk) == false)
+      err_no = errno;
+    else if (SSLSessionHandler::send(stream_id, chunk) == false)
+      err_no = ENOBUFS;
+    else
+      return true;
+
+    file_ = file_t();
+    file_waiting_.clear();
+  }
+
+  // content-length is sent already, the connection can not go on.
+  this->handle_sent_error(SSL_STATE::NONE, err_no,
+                          "Https1Handler::send_file_chunk : The body file can not be sent.",
+                          stream_id, nullptr, 0);
+  close();
+  return true;
+}
+
+void
+Https1Handler::send_waiting()
+{
+  while (true)
+  {
+    int32_t stream_id = -1;
+    int     err_no    = 0;
+    {
+      std::lock_guard<std::mutex> guard(file_lock_);
+      if (file_.file != nullptr || file_waiting_.size() == 0)
+        return;
+
+      Http1Response response = std::move(file_waiting_.front());
+      file_waiting_.pop_front();
+
+      if (send_response(response) == true)
+        continue;
+
+      stream_id = response.stream_id;
+      err_no    = errno;
+    }
+
+    this->handle_sent_error(SSL_STATE::NONE, err_no,
+                            "Https1Handler::send_waiting : The response can not be sent.",
+                            stream_id, nullptr, 0);
+  }
 }
 
 int32_t
@@ -132,6 +261,12 @@ Https1Handler::handle_sent_error(const SSL_STATE     &ssl_state,
                                  const int32_t &stream_id, const uint8_t *data, const size_t  &size)
 {
   (void)data; (void)size;
+  {
+    std::lock_guard<std::mutex> guard(file_lock_);
+    if (file_.stream_id == stream_id)
+      file_ = file_t();
+  }
+
   std::function<bool()> http1_send_error = [&]() -> bool
   {
     Http1Response response;
@@ -150,6 +285,7 @@ Https1Handler::handle_sent_error(const SSL_STATE     &ssl_state,
     if (response.is_websocket_upgrade() == true)
       websocket_ = true;
 
+    request_done();
     return true;
   };
 
@@ -194,6 +330,9 @@ bool
 Https1Handler::handle_sent_http1(const int32_t &stream_id, const uint8_t *data, const size_t  &size)
 {
   (void)data; (void)size;
+  if (send_file_chunk(stream_id) == true)
+    return true;
+
   Http1Response response;
   {
     std::lock_guard<std::mutex> guard(sent_res_http1_lock_);
@@ -210,15 +349,39 @@ Https1Handler::handle_sent_http1(const int32_t &stream_id, const uint8_t *data,
 
   this->handle_sent(response);
 
+  request_done();
+  send_waiting();
   return true;
 }
 
+void
+Https1Handler::request_done(const bool &responded)
+{
+  size_t count = requests_in_progress_.load();
+  while (count > 0 && requests_in_progress_.compare_exchange_weak(count, count - 1) == false)
+    ;
 
+  if (responded == true)
+    responded_ = true;
 
+  if (draining_ == true && requests_in_progress_ == 0)
+    close_after_sent();
+}
 
+void
+Https1Handler::handle_drain()
+{
+  draining_ = true;
 
+  if (websocket_ == true || (responded_ == true && requests_in_progress_ == 0))
+    close_after_sent();
+}
 
+void
+Https1Handler::handle_idle(const EventHandler::IDLE_TYPE &type)
+{
+  if (requests_in_progress_ > 0)
+    return;
 
-
-
-
+  SSLSessionHandler::handle_idle(type);
+}
@@ -56,6 +56,13 @@ protected:
   virtual void    handle_close      () {};
   virtual void    handle_removed    () {};
   virtual void    handle_shutdown   () {};
+  /**
+   * idle keep-alive and websocket: closed now, a request in progress: after its response.
+   * a new connection is closed after its first response, its request may be on the way.
+   */
+  virtual void    handle_drain      () override;
+  // a request in progress is not idle, the application has not responded yet.
+  virtual void    handle_idle       (const EventHandler::IDLE_TYPE &type) override;
 
 protected:
   int32_t         next_stream_id    ();
@@ -71,6 +78,15 @@ private:
   bool            handle_sent_http1 (const int32_t  &stream_id,
                                      const uint8_t  *data, const size_t &size);
 
+  // file_lock_ is held. false: the body file can not be read or the send is refused, errno is set.
+  bool            send_response     (const Http1Response  &response);
+  // file_lock_ is held. the next chunk of file_ is appended to data.
+  bool            read_file_chunk   (std::string          &data);
+  // handle_sent of stream_id. true: the next chunk of its body file is on the way, not done yet.
+  bool            send_file_chunk   (const int32_t        &stream_id);
+  // the responses waiting for the body file sent before them.
+  void            send_waiting      ();
+
   void            handle_sent_error (const SSL_STATE      &ssl_state,
                                      const int            &err_no,
                                      const std::string    &err_str,
@@ -93,8 +109,35 @@ private:
   std::mutex sent_res_ws_lock_;
   std::map<int32_t, WebSocket> sent_res_ws_;
 
+private:
+  /**
+   * TLS is encrypted in user space, a body file is read. (no sendfile)
+   * it is sent in chunks, the next one after handle_sent of the previous one,
+   * so a large file is not held in memory. the responses sent meanwhile wait for it.
+   */
+  enum { FILE_CHUNK_SIZE = 65536 };
+  struct file_t
+  {
+    int32_t             stream_id = -1;
+    SendQueue::FilePtr  file;
+    size_t              offset    = 0;
+    size_t              remaining = 0;
+  };
+  std::mutex                file_lock_;
+  file_t                    file_;
+  std::deque<Http1Response> file_waiting_;
+
 private:
   std::atomic<bool> websocket_;
+
+private:
+  // handle_request ~ handle_sent of its response, or a refused send. (send() of any thread)
+  std::atomic<size_t> requests_in_progress_{0};
+  std::atomic<bool>   responded_{false};
+  std::atomic<bool>   draining_{false};
+
+  // responded false: the response was not sent. (refused)
+  void    request_done(const bool &responded = true);
 };
 
 }
@@ -45,12 +45,59 @@ Https1Reactor::stop()
     accept->stop();
 
   reactors.stop();
+  close_reuse_port();
 
   std::unique_lock<std::mutex> lock(stop_cond_lock_);
   stop_     = true;
   stop_cond_ .notify_all();
 }
 
+void
+Https1Reactor::drain(const uint32_t &timeout_msec)
+{
+  {
+    std::unique_lock<std::mutex> lock(stop_cond_lock_);
+    if (stop_ == true)
+      return;
+  }
+
+  for (const auto &accept : acceptor_threads)
+    accept->stop_accept();
+
+  // the AcceptorHandlers remove themselves. (reuse port)
+  reactors.drain(timeout_msec);
+  close_listeners();
+
+  std::unique_lock<std::mutex> lock(stop_cond_lock_);
+  stop_     = true;
+  stop_cond_ .notify_all();
+}
+
+bool
+Https1Reactor::handoff(const std::string &path,
+                       const uint32_t    &drain_msec,
+                       const int32_t     &timeout_msec)
+{
+  {
+    std::unique_lock<std::mutex> lock(stop_cond_lock_);
+    if (stop_ == true)
+      return false;
+  }
+
+  // the order of the reuseport group.
+  std::vector<io_handle_t> io_handles;
+  io_handles.push_back(acceptor.io_handle());
+  for (const auto &listener : reuse_port_acceptors_)
+    io_handles.push_back(listener->io_handle());
+
+  if (ListenerHandoff::send(path, io_handles, timeout_msec) == false)
+    return false;
+
+  handed_off_ = true;
+  drain(drain_msec);
+  return true;
+}
+
 void
 Https1Reactor::wait()
 {
@@ -61,7 +108,8 @@ Https1Reactor::wait()
 bool
 Https1Reactor::start()
 {
-  stop_ = false;
+  stop_       = false;
+  handed_off_ = false;
 
   if (session_factory_ == nullptr)
   {
@@ -69,6 +117,19 @@ Https1Reactor::start()
     return false;
   }
 
+  inherited_handles_.clear();
+  if (handoff_path_.empty() == false)
+  {
+    std::vector<io_handle_t> io_handles;
+    if (ListenerHandoff::receive(handoff_path_, io_handles, handoff_timeout_) == false)
+    {
+      reactor_trace << "no listening socket from" << handoff_path_;
+      return false;
+    }
+
+    inherited_handles_.assign(io_handles.begin(), io_handles.end());
+  }
+
   if (reactors.init(reactor_thread_num_, reactor_max_clients_,
                     reactor_max_events_, reactor_handler_factory_) == false)
   {
@@ -76,6 +137,12 @@ Https1Reactor::start()
     return false;
   }
 
+  reactors.set_idle_timeout(idle_timeout_msec_, read_timeout_msec_);
+
+  admission_.reset();
+  if (admission_limits_.unlimited() == false)
+    admission_ = std::make_shared<AdmissionControl>(admission_limits_, reactors.get_reactors().size());
+
   auto ssl_contexts_opt_ =
       SSLAcceptorThread::prepare_ssl([&](const int &err_no, const std::string &err_str)
                                      {
@@ -103,24 +170,148 @@ Https1Reactor::start()
     std::function<void()> exit_func;
   };
 
-  scope_exit_t scope_exit([&](){ reactors.stop(); });
+  scope_exit_t scope_exit([&](){ reactors.stop(); close_reuse_port(); close_inherited_handles(); });
 
-  switch (acceptor_type_)
+  if (reuse_port_ == true)
   {
-    case IPV4 : if (acceptor.listen_ipv4  (acceptor_port_, acceptor_address_, acceptor_backlog_) == false) return false; else break;
-    case IPV6 : if (acceptor.listen_ipv6  (acceptor_port_, acceptor_address_, acceptor_backlog_) == false) return false; else break;
-    case IPV46: if (acceptor.listen_ipv46 (acceptor_port_, acceptor_address_, acceptor_backlog_) == false) return false; else break;
-    default: return false;
+    reactors.start();
+    if (start_reuse_port() == false)
+      return false;
+
+    close_inherited_handles();
+    scope_exit.ignore = true;
+    return true;
   }
 
+  if (listen(acceptor) == false)
+    return false;
+
+  close_inherited_handles();
+
   reactors.start();
 
   for (size_t thread_num = 0; thread_num < acceptor_thread_num_; ++thread_num)
   {
-    acceptor_threads.push_back(std::make_shared<SSLAcceptorThread>(*session_factory_, ssl_contexts_, acceptor, reactors));
+    acceptor_threads.push_back(std::make_shared<SSLAcceptorThread>(*session_factory_, ssl_contexts_, acceptor, reactors,
+                                                                   nullptr, handler_pool_size_));
+    acceptor_threads.back()->set_cpu_affinity(acceptor_cpus_);
+    acceptor_threads.back()->set_admission_control(admission_.get());
     acceptor_threads.back()->start();
   }
 
   scope_exit.ignore = true;
   return true;
 }
+
+bool
+Https1Reactor::listen(Acceptor &listener)
+{
+  // see TCPReactor::listen
+  if (inherited_handles_.size() > 0)
+  {
+    io_handle_t io_handle = inherited_handles_.front();
+    inherited_handles_.pop_front();
+    return listener.listen_handle(io_handle);
+  }
+
+  listener.set_options(acceptor_options_);
+
+  switch (acceptor_type_)
+  {
+    case IPV4 : return listener.listen_ipv4  (acceptor_port_, acceptor_address_, acceptor_backlog_);
+    case IPV6 : return listener.listen_ipv6  (acceptor_port_, acceptor_address_, acceptor_backlog_);
+    case IPV46: return listener.listen_ipv46 (acceptor_port_, acceptor_address_, acceptor_backlog_);
+    default: return false;
+  }
+}
+
+bool
+Https1Reactor::start_reuse_port()
+{
+  const std::vector<Reactor *> &reactor_list = reactors.get_reactors();
+
+  // the index of a socket in the reuseport group is the order of listen.
+  std::vector<Acceptor *>         listeners;
+  std::vector<std::vector<int>>   cpus;
+  for (size_t index = 0; index < reactor_list.size(); ++index)
+  {
+    Acceptor *listener = &acceptor;
+    if (index > 0)
+    {
+      reuse_port_acceptors_.push_back(std::make_shared<Acceptor>());
+      listener = reuse_port_acceptors_.back().get();
+    }
+
+    listener->set_reuse_port(true);
+    if (listen(*listener) == false)
+      return false;
+
+    listeners.push_back(listener);
+    cpus     .push_back(reactor_list[index]->cpu_affinity());
+  }
+
+  if (steer_by_cpu_ == true && acceptor.attach_reuseport_cbpf(listeners.size(), cpus) == false)
+    return false;
+
+  for (size_t index = 0; index < listeners.size(); ++index)
+  {
+    acceptor_handlers.push_back(
+        std::make_shared<SSLAcceptorHandler>(*session_factory_,
+                                             ssl_contexts_,
+                                             *listeners[index],
+                                             reactors,
+                                             index,
+                                             handler_pool_size_));
+
+    acceptor_handlers.back()->set_admission_control(admission_.get());
+    if (acceptor_handlers.back()->register_acceptor() == false)
+      return false;
+  }
+
+  return true;
+}
+
+// after the reactors are stopped.
+void
+Https1Reactor::close_reuse_port()
+{
+  if (reuse_port_ == false)
+    return;
+
+  // a pending multishot accept of io_uring keeps the socket until the ring is released,
+  // it must leave the reuseport group now. (see TCPReactor::close_reuse_port)
+  if (handed_off_ == false)
+    acceptor.shutdown(SHUT_RDWR);
+  acceptor.close();
+  for (const auto &listener : reuse_port_acceptors_)
+  {
+    if (handed_off_ == false)
+      listener->shutdown(SHUT_RDWR);
+    listener->close();
+  }
+
+  acceptor_handlers    .clear();
+  reuse_port_acceptors_.clear();
+}
+
+// after drain.
+void
+Https1Reactor::close_listeners()
+{
+  if (reuse_port_ == true)
+  {
+    close_reuse_port();
+    return;
+  }
+
+  acceptor.close();
+}
+
+void
+Https1Reactor::close_inherited_handles()
+{
+  for (const io_handle_t &io_handle : inherited_handles_)
+    ::close(io_handle);
+
+  inherited_handles_.clear();
+}
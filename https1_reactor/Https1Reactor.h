@@ -10,13 +10,16 @@
 
 #include <ssl_reactor/SSLEventHandlerFactory.h>
 #include <ssl_reactor/SSLAcceptorThread.h>
+#include <ssl_reactor/SSLAcceptorHandler.h>
+#include <reactor/acceptor/ListenerHandoff.h>
 #include <reactor/Reactors.h>
 #include <memory>
 
 namespace reactor
 {
 
-using SSLAcceptorThreadPtr = std::shared_ptr<SSLAcceptorThread>;
+using SSLAcceptorThreadPtr  = std::shared_ptr<SSLAcceptorThread>;
+using SSLAcceptorHandlerPtr = std::shared_ptr<SSLAcceptorHandler>;
 
 class Https1Reactor
 {
@@ -26,6 +29,7 @@ public:
   Reactors reactors;
   Acceptor acceptor;
   std::deque<SSLAcceptorThreadPtr> acceptor_threads;
+  std::deque<SSLAcceptorHandlerPtr> acceptor_handlers;
 
 
   void set_acceptor_ipv4  (SSLSessionHandlerFactory *factory,
@@ -54,11 +58,69 @@ public:
                            const size_t             &max_events_per_reactor  = 100,
                            ReactorHandlerFactory    *factory = nullptr);
 
+  /**
+   * pins reactor i on reactor_cpus[i % size] and the acceptor threads on acceptor_cpus.
+   * see Reactors::set_cpu_affinity, CpuAffinity::numa_node_cpus. call before start().
+   */
+  void set_cpu_affinity   (const std::vector<std::vector<int>> &reactor_cpus,
+                           const std::vector<int>              &acceptor_cpus = std::vector<int>())
+  {
+    reactors.set_cpu_affinity(reactor_cpus);
+    acceptor_cpus_ = acceptor_cpus;
+  }
+
+  // see TCPReactor::set_idle_timeout, SSLSessionHandler::handle_idle. call before start().
+  void set_idle_timeout   (const uint32_t &idle_msec, const uint32_t &read_msec = 0)
+  {
+    idle_timeout_msec_ = idle_msec;
+    read_timeout_msec_ = read_msec;
+  }
+
+  // see TCPReactor::set_acceptor_options. call before start().
+  void set_acceptor_options(const AcceptorOptions &options) { acceptor_options_ = options; }
+
+  // see TCPReactor::set_handler_pool_size. the SSL of a handler is reused. call before start().
+  void set_handler_pool_size(const size_t &size) { handler_pool_size_ = size; }
+
+  // see TCPReactor::set_admission_limits. call before start().
+  void set_admission_limits(const AdmissionLimits &limits) { admission_limits_ = limits; }
+
+  // see TCPReactor::admission_control
+  const AdmissionControl *admission_control() const { return admission_.get(); }
+
+  // see TCPReactor::set_reuse_port. call before start().
+  void set_reuse_port     (const bool &value, const bool &steer_by_cpu = false)
+  {
+    reuse_port_   = value;
+    steer_by_cpu_ = steer_by_cpu;
+  }
+
+  // see TCPReactor::set_handoff_path. call before start().
+  void set_handoff_path   (const std::string &path, const int32_t &timeout_msec = 5000)
+  {
+    handoff_path_     = path;
+    handoff_timeout_  = timeout_msec;
+  }
+
   bool start();
   void stop ();
   void wait ();
 
+  // see TCPReactor::drain. a session in the handshake is closed at once.
+  void drain  (const uint32_t &timeout_msec);
+
+  // see TCPReactor::handoff
+  bool handoff(const std::string &path,
+               const uint32_t    &drain_msec,
+               const int32_t     &timeout_msec = -1);
+
 private:
+  bool listen           (Acceptor &listener);
+  bool start_reuse_port ();
+  void close_reuse_port ();
+  void close_listeners  ();
+  void close_inherited_handles();
+
   void set_acceptor(const int                 &type,
                     SSLSessionHandlerFactory  *factory,
                     const uint16_t            &port,
@@ -78,6 +140,8 @@ private:
   size_t      reactor_max_clients_  = 10000;
   size_t      reactor_max_events_   = 100;
   ReactorHandlerFactory *reactor_handler_factory_ = nullptr;
+  uint32_t    idle_timeout_msec_    = 0;
+  uint32_t    read_timeout_msec_    = 0;
 
 private:
   enum { IPV4, IPV6, IPV46 };
@@ -86,6 +150,22 @@ private:
   std::string acceptor_address_;
   uint16_t    acceptor_port_        = 0;
   int         acceptor_backlog_     = 100;
+  std::vector<int> acceptor_cpus_;
+  AcceptorOptions  acceptor_options_;
+  size_t           handler_pool_size_ = 0;
+  AdmissionLimits  admission_limits_;
+  std::shared_ptr<AdmissionControl> admission_;
+
+private:
+  bool        reuse_port_           = false;
+  bool        steer_by_cpu_         = false;
+  std::deque<std::shared_ptr<Acceptor>> reuse_port_acceptors_;
+
+private:
+  std::string             handoff_path_;
+  int32_t                 handoff_timeout_  = 5000;
+  bool                    handed_off_       = false;
+  std::deque<io_handle_t> inherited_handles_;
 
 private:
   SSLSessionHandlerFactory  *session_factory_ = nullptr;
@@ -0,0 +1,130 @@
+/*
+ * CpuAffinity.h
+ *
+ *  Created on: 2026. 10. 17.
+ *      Author: tys
+ */
+
+#ifndef IO_REACTOR_REACTOR_CPUAFFINITY_H_
+#define IO_REACTOR_REACTOR_CPUAFFINITY_H_
+
+#include <reactor/DefinedType.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include <pthread.h>
+#include <sched.h>
+#include <sys/socket.h>
+
+namespace reactor
+{
+
+/**
+ * cpu affinity of the reactor/acceptor threads.
+ * numa: linux places a page on the node of the thread that touches it first,
+ * so the memory allocated and written by a pinned thread is local to its node.
+ */
+class CpuAffinity
+{
+public:
+  // pins the calling thread. empty cpus: nothing to do.
+  static bool set_current_thread(const std::vector<int> &cpus)
+  {
+    if (cpus.size() == 0)
+      return true;
+
+    cpu_set_t cpu_set;
+    CPU_ZERO(&cpu_set);
+
+    for (const int &cpu : cpus)
+      if (cpu >= 0 && cpu < CPU_SETSIZE)
+        CPU_SET(cpu, &cpu_set);
+
+    return pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set) == 0;
+  }
+
+  // cpu that processed the last packet of the socket. (SO_INCOMING_CPU) -1: unknown.
+  static int  incoming_cpu(const io_handle_t &io_handle)
+  {
+#ifdef SO_INCOMING_CPU
+    int       cpu   = -1;
+    socklen_t size  = sizeof(cpu);
+    if (getsockopt(io_handle, SOL_SOCKET, SO_INCOMING_CPU, &cpu, &size) == 0)
+      return cpu;
+#else
+    (void)io_handle;
+#endif
+    return -1;
+  }
+
+  // "0-3,8,10-11" -> 0 1 2 3 8 10 11
+  static std::vector<int> parse_cpu_list(const std::string &list)
+  {
+    std::vector<int> cpus;
+
+    const char *pos = list.c_str();
+    while (*pos != '\0')
+    {
+      char *end   = nullptr;
+      long  first = strtol(pos, &end, 10);
+      if (end == pos)
+        break;
+
+      long last = first;
+      if (*end == '-')
+      {
+        pos  = end + 1;
+        last = strtol(pos, &end, 10);
+        if (end == pos)
+          break;
+      }
+
+      for (long cpu = first; cpu <= last; ++cpu)
+        cpus.push_back((int)cpu);
+
+      pos = end;
+      while (*pos == ',' || *pos == '\n' || *pos == ' ')
+        ++pos;
+    }
+
+    return cpus;
+  }
+
+  // cpus of the numa node. (/sys/devices/system/node/nodeN/cpulist) empty if unknown.
+  static std::vector<int> numa_node_cpus(const int &node)
+  {
+    return read_cpu_list("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+  }
+
+  // online numa nodes. (/sys/devices/system/node/online) {0} if unknown.
+  static std::vector<int> numa_nodes()
+  {
+    std::vector<int> nodes = read_cpu_list("/sys/devices/system/node/online");
+    if (nodes.size() == 0)
+      nodes.push_back(0);
+
+    return nodes;
+  }
+
+private:
+  static std::vector<int> read_cpu_list(const std::string &path)
+  {
+    FILE *file = fopen(path.c_str(), "r");
+    if (file == nullptr)
+      return std::vector<int>();
+
+    char line[4096] = {0};
+    bool result = fgets(line, sizeof(line), file) != nullptr;
+    fclose(file);
+
+    return result ? parse_cpu_list(line) : std::vector<int>();
+  }
+};
+
+}
+
+#endif /* IO_REACTOR_REACTOR_CPUAFFINITY_H_ */
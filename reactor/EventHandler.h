@@ -9,12 +9,38 @@
 #define IO_REACTOR_REACTOR_EVENTHANDLER_H_
 
 #include <reactor/DefinedType.h>
+#include <reactor/TimingWheel.h>
+#include <reactor/IdleList.h>
+#include <atomic>
 #include <string>
 
+#include <unistd.h>
+
 namespace reactor
 {
 
 class Reactor;
+class AdmissionControl;
+
+// std::atomic<T *> used like the pointer. (ptr->..., ptr == nullptr, ptr = ...)
+template<typename T>
+class AtomicPtr
+{
+public:
+  AtomicPtr(T *ptr = nullptr) : ptr_(ptr) {}
+
+  AtomicPtr(const AtomicPtr &) = delete;
+
+  AtomicPtr &operator=(T *ptr) { ptr_.store(ptr); return *this; }
+  AtomicPtr &operator=(const AtomicPtr &) = delete;
+
+  T *load      () const { return ptr_.load(); }
+  T *operator->() const { return ptr_.load(); }
+  operator T * () const { return ptr_.load(); }
+
+private:
+  std::atomic<T *> ptr_;
+};
 
 class EventHandler
 {
@@ -22,6 +48,45 @@ public:
   EventHandler() {}
   virtual ~EventHandler() {}
 
+  /**
+   * epoll trigger mode of this handler. it is resolved when the handler is registered.
+   * REACTOR_DEFAULT follows Reactor::set_edge_triggered.
+   * in edge-triggered mode the handler must read/write until EAGAIN,
+   * and the write interest stays armed.
+   */
+  enum TRIGGER_MODE
+  {
+    TRIGGER_REACTOR_DEFAULT = 0,
+    TRIGGER_LEVEL,
+    TRIGGER_EDGE
+  };
+
+  // call before the handler is registered to the reactor.
+  void set_trigger_mode(const TRIGGER_MODE &mode) { trigger_mode_ = mode; }
+  bool edge_triggered  () const { return edge_triggered_; }
+
+  /**
+   * io_uring engine only. the reactor receives the data by itself and
+   * calls handle_recv() instead of handle_input(). (no readiness round trip)
+   * the other engines ignore it, so handle_input() must be implemented anyway.
+   * call before the handler is registered to the reactor.
+   */
+  void set_recv_completion(const bool &value) { recv_completion_ = value; }
+  bool recv_completion    () const { return recv_completion_; }
+
+  // Reactor::set_idle_timeout
+  enum IDLE_TYPE
+  {
+    IDLE_TIMEOUT = 0, // no input and no output
+    IDLE_READ_TIMEOUT // no input
+  };
+
+  /**
+   * false: the reactor does not check the idle time of this handler. (default true)
+   * call before the handler is registered to the reactor.
+   */
+  void set_idle_tracking  (const bool &value) { idle_tracking_ = value; }
+
 protected:
   virtual void handle_registered() = 0;
 
@@ -39,9 +104,67 @@ protected:
 
   virtual void handle_shutdown  () = 0;
 
+  // set_recv_completion. data is valid only in this call, size is not 0.
+  virtual void handle_recv      (const uint8_t *data, const size_t &size) { (void)data; (void)size; }
+
+  // Reactor::register_acceptor. the accepted io handle is nonblocking.
+  virtual void handle_accept    (const io_handle_t &io_handle) { ::close(io_handle); }
+
+  /**
+   * Reactor::drain. the handler finishes its work and removes itself,
+   * the handlers left at the deadline get handle_shutdown(). default: nothing.
+   */
+  virtual void handle_drain     () {}
+
+  /**
+   * Reactor::set_idle_timeout. called once per idle period, the next input or
+   * output starts a new one. default: nothing.
+   */
+  virtual void handle_idle      (const IDLE_TYPE &type) { (void)type; }
+
+  /**
+   * Reactors::migrate. called on the new reactor, instead of handle_registered.
+   * the timer is kept, the queued output is written on the new reactor. default: nothing.
+   */
+  virtual void handle_migrated  () {}
+
+  // Reactors::migrate is in progress, reactor_ may not be the reactor of the handler.
+  bool migrating() const { return migrate_to_.load() != nullptr; }
+
 protected:
   io_handle_t io_handle_  = INVALID_IO_HANDLE;
-  Reactor     *reactor_   = nullptr;
+  /**
+   * set by the reactor thread when the handler is registered, on the new reactor by a migration.
+   * the other threads (send) read it, load it once per call.
+   * a send racing with a migration gets the old or the new reactor. the old one passes
+   * the write event on to the new one (Reactor::dispatch, moved_to), so the data is not lost.
+   */
+  AtomicPtr<Reactor> reactor_;
+
+private:
+  TRIGGER_MODE  trigger_mode_   = TRIGGER_REACTOR_DEFAULT;
+  bool          edge_triggered_ = false;
+  bool          recv_completion_= false;
+  bool          idle_tracking_  = true;
+  // resolved when the handler is registered.
+  bool          idle_tracked_   = false;
+
+  // Reactor::set_timeout
+  TimingWheel<EventHandler *>::Node timer_node_{this};
+
+  // Reactor::set_idle_timeout, the last activity.
+  IdleList<EventHandler *>::Node    idle_node_{this};
+  IdleList<EventHandler *>::Node    read_node_{this};
+
+  // Reactors::migrate, the reactor moving to. nullptr: not moving.
+  std::atomic<Reactor *>  migrate_to_{nullptr};
+  size_t                  migrate_index_    = 0;
+  // the timeout of the timer on the steady clock, msec. 0: none.
+  uint64_t                migrate_expire_   = 0;
+
+  // released when the handler is removed. see AdmissionControl::admit
+  AdmissionControl  *admission_     = nullptr;
+  uint64_t          admission_key_  = 0;
 
 protected:
   friend class Reactor;
@@ -17,6 +17,12 @@ class EventHandlerAttr
 {
 public:
   static io_handle_t &io_handle(EventHandler *handler) { return handler->io_handle_; }
+
+  static void admission(EventHandler *handler, AdmissionControl *admission, const uint64_t &key)
+  {
+    handler->admission_     = admission;
+    handler->admission_key_ = key;
+  }
 };
 
 }
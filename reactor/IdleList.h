@@ -0,0 +1,129 @@
+/*
+ * IdleList.h
+ *
+ *  Created on: 2026. 10. 17.
+ *      Author: tys
+ */
+
+#ifndef IO_REACTOR_REACTOR_IDLELIST_H_
+#define IO_REACTOR_REACTOR_IDLELIST_H_
+
+#include <reactor/DefinedType.h>
+
+#include <vector>
+
+namespace reactor
+{
+
+/**
+ * objects in the order of their last activity, for a single timeout. (LRU)
+ * intrusive like TimingWheel. touch moves the node to the tail, O(1),
+ * the expired nodes are at the head, a sweep costs O(1) + the expired.
+ * not thread-safe.
+ */
+template<typename T>
+class IdleList
+{
+public:
+  class Node
+  {
+  public:
+    Node(T value = T()) : value(value) {}
+    ~Node() { if (list_ != nullptr) list_->remove(*this); }
+
+    Node(const Node &) = delete;
+    Node &operator=(const Node &) = delete;
+
+    bool linked() const { return list_ != nullptr; }
+
+    T value;
+
+  private:
+    IdleList  *list_  = nullptr;
+    Node      *prev_  = nullptr;
+    Node      *next_  = nullptr;
+    // msec of the last touch
+    int64_t   time_   = 0;
+
+    friend class IdleList;
+  };
+
+  IdleList() { head_.prev_ = head_.next_ = &head_; }
+
+  IdleList(const IdleList &) = delete;
+  IdleList &operator=(const IdleList &) = delete;
+
+  // 0: disabled.
+  void      set_timeout (const uint32_t &msec) { timeout_msec_ = msec; }
+  uint32_t  timeout     () const { return timeout_msec_; }
+
+  // the activity at now_msec. nothing to do in the same msec.
+  void touch(Node &node, const int64_t &now_msec)
+  {
+    if (node.list_ == this && node.time_ == now_msec)
+      return;
+
+    if (node.list_ != nullptr)
+      node.list_->remove(node);
+
+    node.time_  = now_msec;
+    node.list_  = this;
+    node.prev_  = head_.prev_;
+    node.next_  = &head_;
+    head_.prev_->next_ = &node;
+    head_.prev_ = &node;
+    ++size_;
+  }
+
+  bool remove(Node &node)
+  {
+    if (node.list_ != this)
+      return false;
+
+    node.prev_->next_ = node.next_;
+    node.next_->prev_ = node.prev_;
+    node.prev_ = node.next_ = nullptr;
+    node.list_ = nullptr;
+    --size_;
+    return true;
+  }
+
+  // -1: nothing to expire, 0: expired already.
+  int32_t get_min_timeout_milliseconds(const int64_t &now_msec) const
+  {
+    if (head_.next_ == &head_)
+      return -1;
+
+    int64_t remain = head_.next_->time_ + timeout_msec_ - now_msec;
+    if (remain <= 0)
+      return 0;
+
+    return remain > INT32_MAX ? INT32_MAX : (int32_t)remain;
+  }
+
+  // appends the values of the expired nodes. the nodes are unlinked.
+  size_t extract_timeout_objects(const int64_t &now_msec, std::vector<T> &objects)
+  {
+    size_t count = 0;
+    while (head_.next_ != &head_ && head_.next_->time_ + timeout_msec_ <= now_msec)
+    {
+      Node &node = *head_.next_;
+      remove(node);
+      objects.push_back(node.value);
+      ++count;
+    }
+
+    return count;
+  }
+
+  size_t size() const { return size_; }
+
+private:
+  Node      head_;
+  uint32_t  timeout_msec_ = 0;
+  size_t    size_         = 0;
+};
+
+}
+
+#endif /* IO_REACTOR_REACTOR_IDLELIST_H_ */
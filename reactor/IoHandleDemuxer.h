@@ -9,9 +9,12 @@
 #define IO_REACTOR_REACTOR_IOHANDLEDEMUXER_H_
 
 #include <reactor/DefinedType.h>
+#include <reactor/MpscRing.h>
+#include <reactor/IoUring.h>
+#include <reactor/IoHandleTable.h>
 
-#include <unordered_map>
 #include <utility>
+#include <type_traits>
 #include <atomic>
 #include <vector>
 #include <mutex>
@@ -19,6 +22,7 @@
 
 #include <string.h>
 #include <sys/epoll.h>
+#include <sys/eventfd.h>
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <fcntl.h>
@@ -32,7 +36,20 @@ class IoHandleDemuxer
 {
 public:
   IoHandleDemuxer()  {}
-  ~IoHandleDemuxer() {}
+  ~IoHandleDemuxer()
+  {
+    uring_.close();
+    recv_buffers_.close();
+    if (ctrl_event_fd_ != INVALID_IO_HANDLE) ::close(ctrl_event_fd_);
+    if (epoll_fd_      != INVALID_IO_HANDLE) ::close(epoll_fd_);
+  }
+
+  typedef enum
+  {
+    ENGINE_EPOLL = 0,
+    // readiness by IORING_OP_POLL_ADD, plus multishot recv/accept completions.
+    ENGINE_IO_URING
+  } ENGINE;
 
   typedef enum
   {
@@ -41,20 +58,40 @@ public:
     EVENT_WRITE,
     EVENT_ERROR,
     EVENT_CLOSE,
+    // completion events. EventData::result, EventData::buffer
+    EVENT_RECV,
+    EVENT_ACCEPT,
 
     EVENT_REGISTER_ALL   = 10,
     EVENT_REGISTER_READ,
     EVENT_REGISTER_WRITE,
     EVENT_REGISTER_ERROR,
+    EVENT_REGISTER_ACCEPT,
 
     EVENT_REMOVE_READ  = 20,
     EVENT_REMOVE_WRITE,
     EVENT_REMOVE_ERROR,
     EVENT_REMOVE_ALL,
+    // detach_io_handle
+    EVENT_DETACH,
 
     EVENT_USER = 100
   } RECV_EVENT;
 
+  typedef enum
+  {
+    OPTION_NONE           = 0x00,
+    // register the io handle as EPOLLET. (register_read_event, register_all_events)
+    OPTION_EDGE_TRIGGERED = 0x01,
+    // edge-triggered only. EVENT_WRITE is not raised if EPOLLOUT is already armed,
+    // the next edge is waited instead. (register_write_event)
+    OPTION_WAIT_EDGE      = 0x02,
+    // io_uring engine only. the data is received by a multishot recv and raised
+    // as EVENT_RECV instead of EVENT_READ. ignored by the epoll engine. (register_read_event)
+    OPTION_RECV_COMPLETION= 0x04
+  } REGISTER_OPTION;
+
+  // POD record, the events of a wait() are a flat array.
   class EventData
   {
   public:
@@ -65,32 +102,84 @@ public:
     : recv_event(recv_event),
       io_handle (io_handle),
       data      (data) {}
-    virtual ~EventData() {}
 
     int32_t     recv_event= EVENT_WAIT_ERROR;
     io_handle_t io_handle = INVALID_IO_HANDLE;
+    // io events: the user data of the registration. no event of a removed
+    // registration follows its EVENT_REMOVE_* result.
     USER_DATA_T data;
+
+    // EVENT_RECV  : received bytes, the data is at buffer. valid until the next wait().
+    // EVENT_ACCEPT: accepted io handle. (nonblocking, cloexec)
+    // EVENT_ERROR : errno if it is known, otherwise 0.
+    int32_t     result    = 0;
+    uint8_t     *buffer   = nullptr;
   };
 
+  static_assert(std::is_trivially_copyable<EventData>::value, "EventData must be trivially copyable");
+
   bool init                 (const int32_t      &max_size         = 1024,
-                             const size_t       &epoll_max_events = 10);
+                             const size_t       &epoll_max_events = 10,
+                             const size_t       &ctrl_queue_size  = 16384,
+                             const ENGINE       &engine           = ENGINE_EPOLL);
+
+  ENGINE engine() const { return engine_; }
 
+  /**
+   * the user data of the registration which adds the io handle is kept,
+   * and carried by its io events (EventData::data). the later registrations
+   * of the same io handle do not change it.
+   */
   bool register_read_event  (const io_handle_t  &io_handle,
                              USER_DATA_T        user_data,
+                             const bool         &return_event,
+                             const int32_t      &option = OPTION_NONE);
+
+  /**
+   * register_read_event of a batch. (e.g. the connections of an accept loop)
+   * from another thread, the reactor thread is woken up once for the batch.
+   * get(index, io_handle, user_data, option) fills the registration of the index,
+   * an INVALID_IO_HANDLE is skipped.
+   */
+  template<typename GET>
+  bool register_read_events (const size_t       &count,
+                             GET                get,
                              const bool         &return_event);
 
+  /**
+   * edge-triggered io handle keeps EPOLLOUT armed. if it is already armed,
+   * the edge may have passed, so EVENT_WRITE is raised directly
+   * unless OPTION_WAIT_EDGE is given.
+   */
   bool register_write_event (const io_handle_t  &io_handle,
                              USER_DATA_T        user_data,
+                             const bool         &return_event,
+                             const int32_t      &option = OPTION_NONE);
+
+  // register_write_event of a batch, see register_read_events. (e.g. a broadcast)
+  template<typename GET>
+  bool register_write_events(const size_t       &count,
+                             GET                get,
                              const bool         &return_event);
 
   bool register_error_event (const io_handle_t  &io_handle,
                              USER_DATA_T        user_data,
                              const bool         &return_event);
 
-  bool register_all_events  (const io_handle_t  &io_handle,
+  /**
+   * listening io handle. the connections are accepted by the demuxer
+   * and raised as EVENT_ACCEPT. (io_uring: multishot accept, epoll: accept4 loop)
+   * removed by remove_read_event or remove_all_events.
+   */
+  bool register_accept_event(const io_handle_t  &io_handle,
                              USER_DATA_T        user_data,
                              const bool         &return_event);
 
+  bool register_all_events  (const io_handle_t  &io_handle,
+                             USER_DATA_T        user_data,
+                             const bool         &return_event,
+                             const int32_t      &option = OPTION_NONE);
+
   bool remove_read_event    (const io_handle_t  &io_handle,
                              USER_DATA_T        user_data,
                              const bool         &return_event);
@@ -111,6 +200,16 @@ public:
                              USER_DATA_T        user_data,
                              const bool         &return_event);
 
+  /**
+   * remove_all_events without losing data, the io handle is registered on another demuxer.
+   * EVENT_DETACH is raised when nothing is received for it any more.
+   * io_uring: the multishot recv in flight is cancelled, the data it has received
+   * is raised before EVENT_DETACH. a remove_all_events before it cancels the detach.
+   */
+  bool detach_io_handle     (const io_handle_t  &io_handle,
+                             USER_DATA_T        user_data,
+                             const bool         &return_event);
+
   bool raise_user_event     (const int32_t      &user_defined_event_type,
                              const io_handle_t  &io_handle = INVALID_IO_HANDLE,
                              USER_DATA_T        user_data = default_value);
@@ -122,6 +221,26 @@ public:
   wait(std::vector<EventData> &return_events,
        const int32_t          &timeout_msec = -1);
 
+  /**
+   * compatibility option. (default false)
+   * when true, EVENT_READ is raised only if recv(MSG_PEEK) returns data,
+   * so EOF arrives as EVENT_CLOSE alone. when false, EPOLLIN is passed
+   * straight to the handler and it detects EOF by its own recv() == 0.
+   * call before the reactor runs.
+   */
+  void set_peek_on_read(const bool &value) { peek_on_read_ = value; }
+  bool peek_on_read    () const { return peek_on_read_; }
+
+  /**
+   * provided buffers of the io_uring multishot recv. call before init().
+   * a buffer is lent to EVENT_RECV and given back at the next wait().
+   */
+  void set_recv_buffers(const uint32_t &count, const uint32_t &size)
+  {
+    recv_buffer_count_ = count;
+    recv_buffer_size_  = size;
+  }
+
 public:
   void direct_remove_all_events(const io_handle_t  &io_handle)
   {
@@ -130,89 +249,266 @@ public:
 
 
 private:
-  class CtrlEventData : public EventData
+  // POD record, it is copied through the lock-free ring.
+  class CtrlEventData
   {
   public:
     CtrlEventData() {}
     CtrlEventData(const int32_t     &type,
                   const io_handle_t &io_handle,
                   USER_DATA_T       data,
-                  const bool        &return_value)
-    : EventData   (type, io_handle, data),
-      return_value(return_value) {}
-
-    virtual ~CtrlEventData() {}
-    bool return_value = false;
+                  const bool        &return_value,
+                  const int32_t     &option = OPTION_NONE)
+    : recv_event  (type),
+      io_handle   (io_handle),
+      data        (data),
+      return_value(return_value),
+      option      (option) {}
+
+    int32_t     recv_event    = EVENT_WAIT_ERROR;
+    io_handle_t io_handle     = INVALID_IO_HANDLE;
+    USER_DATA_T data          = default_value;
+    bool        return_value  = false;
+    int32_t     option        = OPTION_NONE;
   };
 
-  int           pipe_ctrl_event_recv_ = INVALID_IO_HANDLE;
-  int           pipe_ctrl_event_send_ = INVALID_IO_HANDLE;
-  CtrlEventData pipe_ctrl_events_buffer[100000];
-  std::vector<CtrlEventData> wait_events_;
+  // events from other threads. ctrl_event_fd_ is signaled only when
+  // the ring goes from empty to non-empty.
+  MpscRing<CtrlEventData>     ctrl_events_;
+  std::atomic<bool>           ctrl_event_signaled_{false};
+  int                         ctrl_event_fd_ = INVALID_IO_HANDLE;
+  std::vector<CtrlEventData>  wait_events_;
 
 private:
   bool raise_event        (const int32_t     &event_type,
                            const io_handle_t &io_handle,
                            USER_DATA_T       user_data,
+                           const bool        &return_event,
+                           const int32_t     &option = OPTION_NONE);
+
+  // raise_event of a batch, the reactor thread is signaled once.
+  template<typename GET>
+  bool raise_events       (const int32_t     &event_type,
+                           const size_t      &count,
+                           GET               get,
                            const bool        &return_event);
 
+  // other thread. the ring is full, it wakes up the reactor thread and waits for it.
+  void push_ctrl_event    (const CtrlEventData &event_data);
+  void signal_ctrl_events ();
+
   void process_ctrl_events(std::vector<EventData>            &return_events,
                            const std::vector<CtrlEventData>  &ctrl_events);
 
   void process_ctrl_event (std::vector<EventData> &return_events,
                            const CtrlEventData    &event);
 
-  void add_epoll_event    (const int32_t &event_type, const io_handle_t &io_handle);
+  void process_ctrl_ring  (std::vector<EventData> &return_events);
+
+  void add_epoll_event    (const int32_t &event_type, const io_handle_t &io_handle,
+                           const int32_t &option = OPTION_NONE,
+                           USER_DATA_T   user_data = default_value);
+  bool is_edge_armed      (const int32_t &event_type, const io_handle_t &io_handle);
   void del_epoll_event    (const int32_t &event_type, const io_handle_t &io_handle);
   void del_epoll_events   (const io_handle_t &io_handle);
+  // false: the io_uring recv in flight is waited for.
+  bool detach_state       (const io_handle_t &io_handle, const bool &return_event);
+
+private:
+  enum
+  {
+    // internal register option of register_accept_event.
+    OPTION_ACCEPT = 0x80
+  };
+
+  // interest of an io handle. the io_uring engine keeps its requests in flight here too.
+  // epoll_event.data.ptr points at it, the io events carry its user data.
+  class IoHandleState
+  {
+  public:
+    // INVALID_IO_HANDLE: empty slot
+    io_handle_t io_handle = INVALID_IO_HANDLE;
+    USER_DATA_T data      = default_value;
+    // registration order. tells the reuse of the io handle in an epoll batch.
+    uint32_t    generation= 0;
+    struct epoll_event event;
+    int32_t   option      = OPTION_NONE;
+
+    // io_uring, sequence 0 is not armed.
+    uint32_t  poll_events = 0;
+    uint32_t  poll_seq    = 0;
+    uint32_t  recv_seq    = 0;
+    uint32_t  accept_seq  = 0;
+    bool      recv_eof    = false;
+    bool      dirty       = false;
+    // detach_io_handle, waiting for the end of the recv.
+    bool      detaching   = false;
+    bool      detach_return = false;
+  };
+
+  typedef IoHandleTable<IoHandleState> IoHandleStates;
+
+  IoHandleState *find_state(const io_handle_t &io_handle)
+  {
+    IoHandleState *state = io_handle_states_.find(io_handle);
+    if (state == nullptr || state->io_handle == INVALID_IO_HANDLE)
+      return nullptr;
+
+    return state;
+  }
+
+  // epoll_ctl() or the io_uring requests of the next wait().
+  bool ctl_io_handle      (const int &op, const io_handle_t &io_handle, IoHandleState &state);
+
+  void raise_io_events    (std::vector<EventData> &return_events,
+                           const IoHandleState    &state,
+                           const uint32_t         &events);
+  void accept_io_handle   (std::vector<EventData> &return_events,
+                           const IoHandleState    &state);
+
+  int  wait_epoll         (std::vector<EventData> &return_events, const int32_t &timeout_msec);
+
+private:
+  // io_uring engine
+  enum
+  {
+    URING_OP_POLL = 1,
+    URING_OP_RECV,
+    URING_OP_ACCEPT,
+    URING_OP_CANCEL
+  };
+
+  // [op 8][sequence 24][io handle 32]
+  static uint64_t uring_user_data(const uint32_t &op, const uint32_t &seq, const io_handle_t &io_handle)
+  {
+    return ((uint64_t)op << 56) | ((uint64_t)(seq & 0xFFFFFF) << 32) | (uint32_t)io_handle;
+  }
+
+  uint32_t next_uring_seq()
+  {
+    uring_seq_ = (uring_seq_ + 1) & 0xFFFFFF;
+    if (uring_seq_ == 0)
+      uring_seq_ = 1;
+    return uring_seq_;
+  }
+
+  void mark_uring_dirty   (const io_handle_t &io_handle, IoHandleState &state)
+  {
+    if (state.dirty == true)
+      return;
+
+    state.dirty = true;
+    uring_dirty_.push_back(io_handle);
+  }
+
+  void cancel_uring       (const uint32_t &op, uint32_t &seq, const io_handle_t &io_handle)
+  {
+    if (seq == 0)
+      return;
+
+    uring_cancels_.push_back(uring_user_data(op, seq, io_handle));
+    seq = 0;
+  }
+
+  void prepare_uring      ();
+  void prepare_uring      (const io_handle_t &io_handle, IoHandleState &state, std::vector<io_handle_t> &pending);
+  void complete_uring     (std::vector<EventData> &return_events, const struct io_uring_cqe &cqe);
+  void raise_uring_events (std::vector<EventData> &return_events, const uint32_t &op,
+                           IoHandleState &state, const struct io_uring_cqe &cqe, const int32_t &buffer_id);
+  int  wait_uring         (std::vector<EventData> &return_events, const int32_t &timeout_msec);
 
 private:
   std::thread::id     wait_thread_id_   = std::this_thread::get_id();
   size_t              epoll_max_events_ = 1000;
   int32_t             epoll_fd_         = -1;
+  bool                peek_on_read_     = false;
+  ENGINE              engine_           = ENGINE_EPOLL;
+  // IoHandleState::generation
+  uint32_t            generation_       = 0;
 
 private:
-  std::unordered_map<io_handle_t, struct epoll_event> epoll_events_by_io_handle_;
+  IoHandleStates                  io_handle_states_;
   std::vector<struct epoll_event> epoll_events_;
+
+private:
+  IoUring                   uring_;
+  IoUringBuffers            recv_buffers_;
+  uint32_t                  recv_buffer_count_  = 256;
+  uint32_t                  recv_buffer_size_   = 4096;
+  bool                      recv_completion_    = false;
+  uint32_t                  uring_seq_          = 0;
+  std::vector<io_handle_t>  uring_dirty_;
+  std::vector<uint64_t>     uring_cancels_;
 };
 
 template<typename USER_DATA_T, USER_DATA_T default_value> bool
 IoHandleDemuxer<USER_DATA_T, default_value>::init(const int32_t &max_size,
-                                                  const size_t  &epoll_max_events)
+                                                  const size_t  &epoll_max_events,
+                                                  const size_t  &ctrl_queue_size,
+                                                  const ENGINE  &engine)
 {
+  // re-initialization
+  uring_.close();
+  recv_buffers_.close();
+  if (ctrl_event_fd_ != INVALID_IO_HANDLE) ::close(ctrl_event_fd_);
+  if (epoll_fd_      != INVALID_IO_HANDLE) ::close(epoll_fd_);
+  ctrl_event_fd_ = INVALID_IO_HANDLE;
+  epoll_fd_      = INVALID_IO_HANDLE;
+  io_handle_states_.clear();
+  uring_dirty_.clear();
+  uring_cancels_.clear();
+  recv_completion_ = false;
+
+  engine_ = engine;
+  if (engine_ == ENGINE_IO_URING)
+  {
+    // the submission queue is flushed when it is full, the size is not a limit.
+    if (uring_.init(epoll_max_events < 256 ? 256 : epoll_max_events) == false)
+      return false;
+
+    // without the provided buffers, OPTION_RECV_COMPLETION falls back to EVENT_READ.
+    if (recv_buffer_count_ > 0 && recv_buffer_size_ > 0)
+      recv_completion_ = recv_buffers_.init(uring_, 0, recv_buffer_count_, recv_buffer_size_);
+  }
+  else
+  {
 //  epoll_fd_ = epoll_create(max_size+1);
-  epoll_fd_ = epoll_create1(0);
-  if (epoll_fd_ < 0)
-    return false;
+    epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+    if (epoll_fd_ < 0)
+      return false;
+  }
 
-  int pipe_ctrl_fd[2];
-  if (pipe(pipe_ctrl_fd) < 0)
+  ctrl_event_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (ctrl_event_fd_ < 0)
     return false;
 
-  pipe_ctrl_event_recv_ = pipe_ctrl_fd[0];
-  pipe_ctrl_event_send_ = pipe_ctrl_fd[1];
+  if (ctrl_events_.init(ctrl_queue_size) == false)
+    return false;
 
-  epoll_events_by_io_handle_.reserve(max_size);
+  if (io_handle_states_.reserve(max_size) == false)
+    return false;
 
   epoll_max_events_ = epoll_max_events;
   epoll_events_.resize(epoll_max_events);
 
   wait_events_.reserve(epoll_max_events);
 
-  add_epoll_event(EVENT_READ, pipe_ctrl_event_recv_);
+  // io_uring, multishot poll. process_ctrl_ring() reads the eventfd every time.
+  add_epoll_event(EVENT_READ, ctrl_event_fd_,
+                  engine_ == ENGINE_IO_URING ? OPTION_EDGE_TRIGGERED : OPTION_NONE);
   return true;
 }
 
 template<typename USER_DATA_T, USER_DATA_T default_value> bool
-IoHandleDemuxer<USER_DATA_T, default_value>::register_read_event(const io_handle_t &io_handle, USER_DATA_T user_data, const bool &return_event)
+IoHandleDemuxer<USER_DATA_T, default_value>::register_read_event(const io_handle_t &io_handle, USER_DATA_T user_data, const bool &return_event, const int32_t &option)
 {
-  return raise_event(EVENT_REGISTER_READ, io_handle, user_data, return_event);
+  return raise_event(EVENT_REGISTER_READ, io_handle, user_data, return_event, option);
 }
 
 template<typename USER_DATA_T, USER_DATA_T default_value> bool
-IoHandleDemuxer<USER_DATA_T, default_value>::register_write_event(const io_handle_t &io_handle, USER_DATA_T user_data, const bool &return_event)
+IoHandleDemuxer<USER_DATA_T, default_value>::register_write_event(const io_handle_t &io_handle, USER_DATA_T user_data, const bool &return_event, const int32_t &option)
 {
-  return raise_event(EVENT_REGISTER_WRITE, io_handle, user_data, return_event);
+  return raise_event(EVENT_REGISTER_WRITE, io_handle, user_data, return_event, option);
 }
 
 template<typename USER_DATA_T, USER_DATA_T default_value> bool
@@ -222,9 +518,15 @@ IoHandleDemuxer<USER_DATA_T, default_value>::register_error_event(const io_handl
 }
 
 template<typename USER_DATA_T, USER_DATA_T default_value> bool
-IoHandleDemuxer<USER_DATA_T, default_value>::register_all_events(const io_handle_t &io_handle, USER_DATA_T user_data, const bool &return_event)
+IoHandleDemuxer<USER_DATA_T, default_value>::register_accept_event(const io_handle_t &io_handle, USER_DATA_T user_data, const bool &return_event)
+{
+  return raise_event(EVENT_REGISTER_ACCEPT, io_handle, user_data, return_event);
+}
+
+template<typename USER_DATA_T, USER_DATA_T default_value> bool
+IoHandleDemuxer<USER_DATA_T, default_value>::register_all_events(const io_handle_t &io_handle, USER_DATA_T user_data, const bool &return_event, const int32_t &option)
 {
-  return raise_event(EVENT_REGISTER_ALL, io_handle, user_data, return_event);
+  return raise_event(EVENT_REGISTER_ALL, io_handle, user_data, return_event, option);
 }
 
 template<typename USER_DATA_T, USER_DATA_T default_value> bool
@@ -251,6 +553,12 @@ IoHandleDemuxer<USER_DATA_T, default_value>::remove_all_events(const io_handle_t
   return raise_event(EVENT_REMOVE_ALL, io_handle, user_data, return_event);
 }
 
+template<typename USER_DATA_T, USER_DATA_T default_value> bool
+IoHandleDemuxer<USER_DATA_T, default_value>::detach_io_handle(const io_handle_t &io_handle, USER_DATA_T user_data, const bool &return_event)
+{
+  return raise_event(EVENT_DETACH, io_handle, user_data, return_event);
+}
+
 template<typename USER_DATA_T, USER_DATA_T default_value> bool
 IoHandleDemuxer<USER_DATA_T, default_value>::raise_user_event(const int32_t     &user_defined_event_type,
                                                               const io_handle_t &io_handle,
@@ -276,26 +584,94 @@ template<typename USER_DATA_T, USER_DATA_T default_value> bool
 IoHandleDemuxer<USER_DATA_T, default_value>::raise_event(const int32_t     &event_type,
                                                          const io_handle_t &io_handle,
                                                          USER_DATA_T       user_data,
-                                                         const bool        &return_event)
+                                                         const bool        &return_event,
+                                                         const int32_t     &option)
 {
   if (event_type < EVENT_USER && io_handle == INVALID_IO_HANDLE)
     return false;
 
-  // if it is another thread, it sends an event to the pipe.
+  // if it is another thread, it puts an event into the ring.
   if (std::this_thread::get_id() != wait_thread_id_)
   {
-    CtrlEventData event_data(event_type, io_handle, user_data, return_event);
+    push_ctrl_event(CtrlEventData(event_type, io_handle, user_data, return_event, option));
+    signal_ctrl_events();
+    return true;
+  }
 
-    ssize_t ignored __attribute__((unused)) =
-        ::write(pipe_ctrl_event_send_, &event_data, sizeof(CtrlEventData));
+  wait_events_.emplace_back(event_type, io_handle, user_data, return_event, option);
+  return true;
+}
 
-    return true;
+template<typename USER_DATA_T, USER_DATA_T default_value> template<typename GET> bool
+IoHandleDemuxer<USER_DATA_T, default_value>::register_read_events(const size_t &count,
+                                                                  GET          get,
+                                                                  const bool   &return_event)
+{
+  return raise_events(EVENT_REGISTER_READ, count, get, return_event);
+}
+
+template<typename USER_DATA_T, USER_DATA_T default_value> template<typename GET> bool
+IoHandleDemuxer<USER_DATA_T, default_value>::register_write_events(const size_t &count,
+                                                                   GET          get,
+                                                                   const bool   &return_event)
+{
+  return raise_events(EVENT_REGISTER_WRITE, count, get, return_event);
+}
+
+template<typename USER_DATA_T, USER_DATA_T default_value> template<typename GET> bool
+IoHandleDemuxer<USER_DATA_T, default_value>::raise_events(const int32_t &event_type,
+                                                          const size_t  &count,
+                                                          GET           get,
+                                                          const bool    &return_event)
+{
+  bool other_thread = std::this_thread::get_id() != wait_thread_id_;
+
+  for (size_t index = 0; index < count; ++index)
+  {
+    io_handle_t io_handle = INVALID_IO_HANDLE;
+    USER_DATA_T user_data = default_value;
+    int32_t     option    = OPTION_NONE;
+
+    get(index, io_handle, user_data, option);
+    if (io_handle == INVALID_IO_HANDLE)
+      continue;
+
+    if (other_thread == true)
+      push_ctrl_event(CtrlEventData(event_type, io_handle, user_data, return_event, option));
+    else
+      wait_events_.emplace_back(event_type, io_handle, user_data, return_event, option);
   }
 
-  wait_events_.emplace_back(event_type, io_handle, user_data, return_event);
+  if (other_thread == true)
+    signal_ctrl_events();
+
   return true;
 }
 
+template<typename USER_DATA_T, USER_DATA_T default_value> void
+IoHandleDemuxer<USER_DATA_T, default_value>::push_ctrl_event(const CtrlEventData &event_data)
+{
+  while (ctrl_events_.push(event_data) == false)
+  {
+    // the ring is full. the events of the batch may not be signaled yet.
+    signal_ctrl_events();
+    std::this_thread::yield();
+  }
+}
+
+template<typename USER_DATA_T, USER_DATA_T default_value> void
+IoHandleDemuxer<USER_DATA_T, default_value>::signal_ctrl_events()
+{
+  // wake up only on the empty -> non-empty transition.
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (ctrl_event_signaled_.exchange(true, std::memory_order_seq_cst) == false)
+  {
+    uint64_t value = 1;
+    ssize_t ignored __attribute__((unused)) =
+        ::write(ctrl_event_fd_, &value, sizeof(value));
+  }
+}
+
 template<typename USER_DATA_T, USER_DATA_T default_value> void
 IoHandleDemuxer<USER_DATA_T, default_value>::process_ctrl_events(std::vector<EventData>           &return_events,
                                                                  const std::vector<CtrlEventData> &ctrl_events)
@@ -306,9 +682,32 @@ IoHandleDemuxer<USER_DATA_T, default_value>::process_ctrl_events(std::vector<Eve
 
 #define INIT_EPOLL_EVENT_VALUE (EPOLLHUP|EPOLLRDHUP)
 
+template<typename USER_DATA_T, USER_DATA_T default_value> bool
+IoHandleDemuxer<USER_DATA_T, default_value>::ctl_io_handle(const int         &op,
+                                                           const io_handle_t &io_handle,
+                                                           IoHandleState     &state)
+{
+  if (engine_ == ENGINE_EPOLL)
+    return epoll_ctl(epoll_fd_, op, io_handle, &state.event) == 0;
+
+  // io_uring. the requests are made at the next wait().
+  if (op == EPOLL_CTL_DEL)
+  {
+    cancel_uring(URING_OP_POLL,   state.poll_seq,   io_handle);
+    cancel_uring(URING_OP_RECV,   state.recv_seq,   io_handle);
+    cancel_uring(URING_OP_ACCEPT, state.accept_seq, io_handle);
+    return true;
+  }
+
+  mark_uring_dirty(io_handle, state);
+  return true;
+}
+
 template<typename USER_DATA_T, USER_DATA_T default_value> void
 IoHandleDemuxer<USER_DATA_T, default_value>::add_epoll_event(const int32_t     &event_type,
-                                                             const io_handle_t &io_handle)
+                                                             const io_handle_t &io_handle,
+                                                             const int32_t     &option,
+                                                             USER_DATA_T       user_data)
 {
   int32_t epoll_event = 0;
   switch (event_type)
@@ -319,17 +718,39 @@ IoHandleDemuxer<USER_DATA_T, default_value>::add_epoll_event(const int32_t     &
     default: (void)event_type; break;
   }
 
-  std::unordered_map<io_handle_t, struct epoll_event>::iterator it =
-      epoll_events_by_io_handle_.find(io_handle);
+  IoHandleState *found = find_state(io_handle);
 
-  if (it != epoll_events_by_io_handle_.end())
+  if (found != nullptr)
   {
-    struct epoll_event &event = it->second;
+    struct epoll_event &event = found->event;
+
+    // a slot of no handler or of another one, e.g. register_writable of a removed handler
+    // before its io handle is reused. the registering handler takes it over.
+    if (user_data != default_value && found->data != user_data)
+    {
+      found->data       = user_data;
+      found->generation = ++generation_;
+      found->option     = option;
+      if (recv_completion_ == false)
+        found->option &= ~OPTION_RECV_COMPLETION;
+
+      event.events = INIT_EPOLL_EVENT_VALUE | epoll_event;
+      if (option & OPTION_EDGE_TRIGGERED)
+        event.events |= EPOLLET;
+
+      // the closed io handle left the epoll set, the reused one is added.
+      if (ctl_io_handle(EPOLL_CTL_MOD, io_handle, *found) == false &&
+          (errno != ENOENT || ctl_io_handle(EPOLL_CTL_ADD, io_handle, *found) == false))
+        *found = IoHandleState();
+
+      return;
+    }
+
     if (event.events & epoll_event)
       return;
 
     event.events |= epoll_event;
-    if (epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, io_handle, &event) == -1)
+    if (ctl_io_handle(EPOLL_CTL_MOD, io_handle, *found) == false)
     {
       event.events ^= epoll_event;
       return;
@@ -338,14 +759,31 @@ IoHandleDemuxer<USER_DATA_T, default_value>::add_epoll_event(const int32_t     &
     return;
   }
 
-  struct epoll_event &event = epoll_events_by_io_handle_[io_handle];
+  IoHandleState *slot = io_handle_states_.get(io_handle);
+  if (slot == nullptr)
+    return;
+
+  IoHandleState &state = *slot;
+  state = IoHandleState();
+  state.io_handle = io_handle;
+  state.data      = user_data;
+  state.generation= ++generation_;
+
+  struct epoll_event &event = state.event;
   memset(&event, 0x00, sizeof(struct epoll_event));
 
-  event.data.fd = io_handle;
-  event.events  = INIT_EPOLL_EVENT_VALUE | epoll_event;
-  if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, io_handle, &event) == -1)
+  state.option = option;
+  if (recv_completion_ == false)
+    state.option &= ~OPTION_RECV_COMPLETION;
+
+  event.data.ptr = &state;
+  event.events   = INIT_EPOLL_EVENT_VALUE | epoll_event;
+  if (option & OPTION_EDGE_TRIGGERED)
+    event.events |= EPOLLET;
+
+  if (ctl_io_handle(EPOLL_CTL_ADD, io_handle, state) == false)
   {
-    epoll_events_by_io_handle_.erase(io_handle);
+    state = IoHandleState();
     return;
   }
 
@@ -356,10 +794,9 @@ template<typename USER_DATA_T, USER_DATA_T default_value> void
 IoHandleDemuxer<USER_DATA_T, default_value>::del_epoll_event(const int32_t     &event_type,
                                                              const io_handle_t &io_handle)
 {
-  std::unordered_map<io_handle_t, struct epoll_event>::iterator it =
-      epoll_events_by_io_handle_.find(io_handle);
+  IoHandleState *state = find_state(io_handle);
 
-  if (it == epoll_events_by_io_handle_.end())
+  if (state == nullptr)
     return;
 
   int32_t epoll_event = 0;
@@ -371,37 +808,79 @@ IoHandleDemuxer<USER_DATA_T, default_value>::del_epoll_event(const int32_t     &
     default: return;
   }
 
-  struct epoll_event &event = it->second;
+  struct epoll_event &event = state->event;
 
-  if ((event.events ^ epoll_event) == INIT_EPOLL_EVENT_VALUE)
+  if (((event.events & ~EPOLLET) ^ epoll_event) == INIT_EPOLL_EVENT_VALUE)
   {
-    epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, io_handle, &event);
-    epoll_events_by_io_handle_.erase(it);
+    ctl_io_handle(EPOLL_CTL_DEL, io_handle, *state);
+    *state = IoHandleState();
     return;
   }
 
   event.events ^= epoll_event;
-  epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, io_handle, &event);
+  ctl_io_handle(EPOLL_CTL_MOD, io_handle, *state);
 
   return;
 }
 
+template<typename USER_DATA_T, USER_DATA_T default_value> bool
+IoHandleDemuxer<USER_DATA_T, default_value>::is_edge_armed(const int32_t     &event_type,
+                                                           const io_handle_t &io_handle)
+{
+  IoHandleState *state = find_state(io_handle);
+
+  if (state == nullptr || !(state->event.events & EPOLLET))
+    return false;
+
+  switch (event_type)
+  {
+    case EVENT_READ : return state->event.events & EPOLLIN;
+    case EVENT_WRITE: return state->event.events & EPOLLOUT;
+    default: return false;
+  }
+}
+
 template<typename USER_DATA_T, USER_DATA_T default_value> void
 IoHandleDemuxer<USER_DATA_T, default_value>::del_epoll_events(const io_handle_t &io_handle)
 {
-  std::unordered_map<io_handle_t, struct epoll_event>::iterator it =
-      epoll_events_by_io_handle_.find(io_handle);
+  IoHandleState *state = find_state(io_handle);
 
-  if (it == epoll_events_by_io_handle_.end())
+  if (state == nullptr)
     return;
 
-  struct epoll_event &event = it->second;
-  epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, io_handle, &event);
+  ctl_io_handle(EPOLL_CTL_DEL, io_handle, *state);
 
-  epoll_events_by_io_handle_.erase(it);
+  *state = IoHandleState();
   return;
 }
 
+template<typename USER_DATA_T, USER_DATA_T default_value> bool
+IoHandleDemuxer<USER_DATA_T, default_value>::detach_state(const io_handle_t &io_handle, const bool &return_event)
+{
+  IoHandleState *state = find_state(io_handle);
+  if (state == nullptr)
+    return true;
+
+  if (state->detaching == true)
+    return false;
+
+  // the multishot recv may have taken data from the socket already,
+  // it is raised until the recv ends. see complete_uring
+  if (engine_ == ENGINE_IO_URING && state->recv_seq != 0)
+  {
+    cancel_uring(URING_OP_POLL,   state->poll_seq,   io_handle);
+    cancel_uring(URING_OP_ACCEPT, state->accept_seq, io_handle);
+    uring_cancels_.push_back(uring_user_data(URING_OP_RECV, state->recv_seq, io_handle));
+
+    state->detaching      = true;
+    state->detach_return  = return_event;
+    return false;
+  }
+
+  del_epoll_events(io_handle);
+  return true;
+}
+
 template<typename USER_DATA_T, USER_DATA_T default_value> void
 IoHandleDemuxer<USER_DATA_T, default_value>::process_ctrl_event(std::vector<EventData> &return_events,
                                                                 const CtrlEventData    &ctrl_events)
@@ -409,22 +888,107 @@ IoHandleDemuxer<USER_DATA_T, default_value>::process_ctrl_event(std::vector<Even
   switch (ctrl_events.recv_event)
   {
     case EVENT_REGISTER_ALL  :
-      add_epoll_event(EVENT_READ,   ctrl_events.io_handle);
-      add_epoll_event(EVENT_WRITE,  ctrl_events.io_handle);
-      add_epoll_event(EVENT_ERROR,  ctrl_events.io_handle);
+      add_epoll_event(EVENT_READ,   ctrl_events.io_handle, ctrl_events.option, ctrl_events.data);
+      add_epoll_event(EVENT_WRITE,  ctrl_events.io_handle, ctrl_events.option, ctrl_events.data);
+      add_epoll_event(EVENT_ERROR,  ctrl_events.io_handle, ctrl_events.option, ctrl_events.data);
       break;
-    case EVENT_REGISTER_READ  : add_epoll_event (EVENT_READ,  ctrl_events.io_handle); break;
-    case EVENT_REGISTER_WRITE : add_epoll_event (EVENT_WRITE, ctrl_events.io_handle); break;
-    case EVENT_REGISTER_ERROR : add_epoll_event (EVENT_ERROR, ctrl_events.io_handle); break;
+    case EVENT_REGISTER_READ  : add_epoll_event (EVENT_READ,  ctrl_events.io_handle, ctrl_events.option, ctrl_events.data); break;
+    case EVENT_REGISTER_WRITE :
+      // edge-triggered, EPOLLOUT is kept armed. the edge may have passed already.
+      if (is_edge_armed(EVENT_WRITE, ctrl_events.io_handle) == true)
+      {
+        if (!(ctrl_events.option & OPTION_WAIT_EDGE))
+          return_events.emplace_back(EVENT_WRITE, ctrl_events.io_handle, find_state(ctrl_events.io_handle)->data);
+        break;
+      }
+      add_epoll_event(EVENT_WRITE, ctrl_events.io_handle, ctrl_events.option, ctrl_events.data);
+      break;
+    case EVENT_REGISTER_ERROR : add_epoll_event (EVENT_ERROR, ctrl_events.io_handle, OPTION_NONE,   ctrl_events.data); break;
+    case EVENT_REGISTER_ACCEPT: add_epoll_event (EVENT_READ,  ctrl_events.io_handle, OPTION_ACCEPT, ctrl_events.data); break;
     case EVENT_REMOVE_READ    : del_epoll_event (EVENT_READ,  ctrl_events.io_handle); break;
     case EVENT_REMOVE_WRITE   : del_epoll_event (EVENT_WRITE, ctrl_events.io_handle); break;
     case EVENT_REMOVE_ERROR   : del_epoll_event (EVENT_ERROR, ctrl_events.io_handle); break;
     case EVENT_REMOVE_ALL     : del_epoll_events(ctrl_events.io_handle); break;
+    case EVENT_DETACH         :
+      if (detach_state(ctrl_events.io_handle, ctrl_events.return_value) == false)
+        return;
+      break;
     default: (void)ctrl_events.recv_event; break;
   }
 
   if (ctrl_events.return_value == true)
-    return_events.emplace_back(ctrl_events);
+    return_events.emplace_back(ctrl_events.recv_event,
+                               ctrl_events.io_handle,
+                               ctrl_events.data);
+}
+
+template<typename USER_DATA_T, USER_DATA_T default_value> void
+IoHandleDemuxer<USER_DATA_T, default_value>::process_ctrl_ring(std::vector<EventData> &return_events)
+{
+  uint64_t value = 0;
+  ssize_t ignored __attribute__((unused)) =
+      ::read(ctrl_event_fd_, &value, sizeof(value));
+
+  // clear the flag before draining. a producer that pushes after this point
+  // signals the eventfd again, so no event is left behind.
+  ctrl_event_signaled_.store(false, std::memory_order_seq_cst);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+
+  // bounded, the producers can not starve the io events.
+  CtrlEventData event;
+  for (size_t count = ctrl_events_.capacity(); count > 0 && ctrl_events_.pop(event); --count)
+    process_ctrl_event(return_events, event);
+}
+
+template<typename USER_DATA_T, USER_DATA_T default_value> void
+IoHandleDemuxer<USER_DATA_T, default_value>::raise_io_events(std::vector<EventData> &return_events,
+                                                             const IoHandleState    &state,
+                                                             const uint32_t         &events)
+{
+  const io_handle_t io_handle = state.io_handle;
+
+  // if recv() returns 0 bytes, epoll() returns EPOLLIN and EPOLLRDHUP together.
+  // the handler reads EOF itself, unless peek_on_read_ is set.
+  if (events & EPOLLIN)
+  {
+    char buff[1];
+    if (peek_on_read_ == false || ::recv(io_handle, &buff, 1, MSG_PEEK) > 0)
+      return_events.emplace_back(EVENT_READ,  io_handle, state.data);
+  }
+
+  if ((events & EPOLLOUT) && !(events & EPOLLERR))
+    return_events.emplace_back(EVENT_WRITE, io_handle, state.data);
+
+  if (events & EPOLLERR)
+    return_events.emplace_back(EVENT_ERROR, io_handle, state.data);
+
+  if ((events & EPOLLRDHUP) || (events & EPOLLHUP))
+    return_events.emplace_back(EVENT_CLOSE, io_handle, state.data);
+}
+
+template<typename USER_DATA_T, USER_DATA_T default_value> void
+IoHandleDemuxer<USER_DATA_T, default_value>::accept_io_handle(std::vector<EventData> &return_events,
+                                                              const IoHandleState    &state)
+{
+  const io_handle_t io_handle = state.io_handle;
+
+  // the epoll engine emulates the multishot accept. bounded per wakeup.
+  for (size_t count = 0; count < epoll_max_events_; ++count)
+  {
+    io_handle_t client = ::accept4(io_handle, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if (client < 0)
+    {
+      if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR || errno == ECONNABORTED)
+        return;
+
+      return_events.emplace_back(EVENT_ERROR, io_handle, state.data);
+      return_events.back().result = errno;
+      return;
+    }
+
+    return_events.emplace_back(EVENT_ACCEPT, io_handle, state.data);
+    return_events.back().result = client;
+  }
 }
 
 template<typename USER_DATA_T, USER_DATA_T default_value> int
@@ -433,63 +997,351 @@ IoHandleDemuxer<USER_DATA_T, default_value>::wait(std::vector<EventData> &return
 {
   wait_thread_id_ = std::this_thread::get_id();
 
-  while (true)
+  if (wait_events_.size() > 0)
+  {
+    process_ctrl_events(return_events, wait_events_);
+    wait_events_.clear();
+  }
+
+  if (engine_ == ENGINE_IO_URING)
+    return wait_uring(return_events, return_events.size() > 0 ? 0 : timeout_msec);
+
+  if (return_events.size() > 0)
+    return 0;
+
+  return wait_epoll(return_events, timeout_msec);
+}
+
+template<typename USER_DATA_T, USER_DATA_T default_value> int
+IoHandleDemuxer<USER_DATA_T, default_value>::wait_epoll(std::vector<EventData> &return_events,
+                                                        const int32_t          &timeout_msec)
+{
+  int32_t number_of_fd = epoll_wait(epoll_fd_, &(epoll_events_[0]), epoll_max_events_, timeout_msec);
+  if (number_of_fd < 0)
+    return -1;
+
+  // an io handle registered after this is not in this batch.
+  const uint32_t batch_generation = generation_;
+
+  for (int32_t index = 0; index < number_of_fd; ++index)
   {
-    if (wait_events_.size() > 0)
+    struct epoll_event  &event    = epoll_events_[index];
+    const IoHandleState &state    = *(IoHandleState *)event.data.ptr;
+    const io_handle_t   io_handle = state.io_handle;
+
+    // removed by a control event of this batch, or removed and registered again. (reused io handle)
+    if (io_handle == INVALID_IO_HANDLE || (int32_t)(state.generation - batch_generation) > 0)
+      continue;
+
+    if (io_handle == ctrl_event_fd_)
     {
-      process_ctrl_events(return_events, wait_events_);
-      wait_events_.clear();
+      process_ctrl_ring(return_events);
+      continue;
+    }
 
-      if (return_events.size() > 0)
-        return 0;
+    if (state.option & OPTION_ACCEPT)
+    {
+      if (event.events & EPOLLERR)
+        return_events.emplace_back(EVENT_ERROR, io_handle, state.data);
+      else if (event.events & EPOLLIN)
+        accept_io_handle(return_events, state);
+      continue;
     }
 
-    int32_t number_of_fd = epoll_wait(epoll_fd_, &(epoll_events_[0]), epoll_max_events_, timeout_msec);
-    if (number_of_fd < 0)
-      return -1;
+    raise_io_events(return_events, state, event.events);
+  }
+
+  return 0;
+}
+
+template<typename USER_DATA_T, USER_DATA_T default_value> void
+IoHandleDemuxer<USER_DATA_T, default_value>::prepare_uring()
+{
+  std::vector<io_handle_t> pending;
+  for (const io_handle_t &io_handle : uring_dirty_)
+  {
+    IoHandleState *state = find_state(io_handle);
+    if (state == nullptr || state->dirty == false)
+      continue;
+
+    prepare_uring(io_handle, *state, pending);
+  }
+
+  // the submission queue was full, try again at the next wait().
+  uring_dirty_.swap(pending);
+
+  // a stale completion is ignored by its sequence, the order does not matter.
+  size_t index = 0;
+  for (; index < uring_cancels_.size(); ++index)
+  {
+    struct io_uring_sqe *sqe = uring_.get_sqe();
+    if (sqe == nullptr)
+      break;
+
+    sqe->opcode     = IORING_OP_ASYNC_CANCEL;
+    sqe->addr       = uring_cancels_[index];
+    sqe->user_data  = uring_user_data(URING_OP_CANCEL, 0, (io_handle_t)(uint32_t)uring_cancels_[index]);
+  }
+  uring_cancels_.erase(uring_cancels_.begin(), uring_cancels_.begin() + index);
+}
+
+template<typename USER_DATA_T, USER_DATA_T default_value> void
+IoHandleDemuxer<USER_DATA_T, default_value>::prepare_uring(const io_handle_t        &io_handle,
+                                                           IoHandleState            &state,
+                                                           std::vector<io_handle_t> &pending)
+{
+  // detach_state, nothing is armed again.
+  if (state.detaching == true)
+  {
+    state.dirty = false;
+    return;
+  }
+
+  const uint32_t events = state.event.events;
+
+  // the readiness which the completions do not cover.
+  uint32_t poll_events = events & ~EPOLLET;
+  if (state.option & (OPTION_RECV_COMPLETION | OPTION_ACCEPT))
+    poll_events &= ~(EPOLLIN | EPOLLRDHUP);
+
+  bool want_poll = poll_events & (EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLERR);
 
-    for (int32_t index = 0; index < number_of_fd; ++index)
+  if (state.poll_seq != 0 && (want_poll == false || state.poll_events != poll_events))
+    cancel_uring(URING_OP_POLL, state.poll_seq, io_handle);
+
+  if (state.poll_seq == 0 && want_poll == true)
+  {
+    struct io_uring_sqe *sqe = uring_.get_sqe();
+    if (sqe == nullptr)
     {
-      struct epoll_event &event     = epoll_events_[index];
-      const io_handle_t  &io_handle = event.data.fd;
+      pending.push_back(io_handle);
+      return;
+    }
 
-      if (io_handle == pipe_ctrl_event_recv_)
-      {
-        int32_t read_bytes = ::read(pipe_ctrl_event_recv_,
-                                    pipe_ctrl_events_buffer,
-                                    sizeof(pipe_ctrl_events_buffer));
+    state.poll_seq    = next_uring_seq();
+    state.poll_events = poll_events;
 
-        if (read_bytes <= 0)
-          continue;
+    // level-triggered: one-shot, armed again at the next wait().
+    // edge-triggered : multishot.
+    sqe->opcode       = IORING_OP_POLL_ADD;
+    sqe->fd           = io_handle;
+    sqe->poll32_events= poll_events;
+    sqe->len          = (events & EPOLLET) ? IORING_POLL_ADD_MULTI : 0;
+    sqe->user_data    = uring_user_data(URING_OP_POLL, state.poll_seq, io_handle);
+  }
 
-        for (size_t index = 0; index < (read_bytes/sizeof(CtrlEventData)); ++index)
-          process_ctrl_event(return_events, pipe_ctrl_events_buffer[index]);
+  if ((state.option & OPTION_RECV_COMPLETION) && (events & EPOLLIN) &&
+      state.recv_seq == 0 && state.recv_eof == false)
+  {
+    struct io_uring_sqe *sqe = uring_.get_sqe();
+    if (sqe == nullptr)
+    {
+      pending.push_back(io_handle);
+      return;
+    }
+
+    state.recv_seq  = next_uring_seq();
+
+    sqe->opcode     = IORING_OP_RECV;
+    sqe->fd         = io_handle;
+    sqe->ioprio     = IORING_RECV_MULTISHOT;
+    sqe->flags      = IOSQE_BUFFER_SELECT;
+    sqe->buf_group  = recv_buffers_.group_id();
+    sqe->user_data  = uring_user_data(URING_OP_RECV, state.recv_seq, io_handle);
+  }
+
+  if ((state.option & OPTION_ACCEPT) && state.accept_seq == 0)
+  {
+    struct io_uring_sqe *sqe = uring_.get_sqe();
+    if (sqe == nullptr)
+    {
+      pending.push_back(io_handle);
+      return;
+    }
+
+    state.accept_seq  = next_uring_seq();
+
+    sqe->opcode       = IORING_OP_ACCEPT;
+    sqe->fd           = io_handle;
+    sqe->ioprio       = IORING_ACCEPT_MULTISHOT;
+    sqe->accept_flags = SOCK_NONBLOCK | SOCK_CLOEXEC;
+    sqe->user_data    = uring_user_data(URING_OP_ACCEPT, state.accept_seq, io_handle);
+  }
+
+  state.dirty = false;
+}
+
+template<typename USER_DATA_T, USER_DATA_T default_value> void
+IoHandleDemuxer<USER_DATA_T, default_value>::complete_uring(std::vector<EventData>    &return_events,
+                                                            const struct io_uring_cqe &cqe)
+{
+  const uint32_t    op        = (uint32_t)(cqe.user_data >> 56);
+  const uint32_t    seq       = (uint32_t)(cqe.user_data >> 32) & 0xFFFFFF;
+  const io_handle_t io_handle = (io_handle_t)(uint32_t)cqe.user_data;
+  const bool        more      = cqe.flags & IORING_CQE_F_MORE;
+
+  int32_t buffer_id = -1;
+  if (cqe.flags & IORING_CQE_F_BUFFER)
+    buffer_id = cqe.flags >> IORING_CQE_BUFFER_SHIFT;
 
-        continue;
+  // IoUringBuffers::publish
+  if (cqe.user_data == 0)
+    return;
+
+  if (op == URING_OP_CANCEL)
+    return;
+
+  // the request of a removed io handle, or of the previous interest.
+  IoHandleState *state = find_state(io_handle);
+  uint32_t *state_seq = nullptr;
+  if (state != nullptr)
+  {
+    switch (op)
+    {
+      case URING_OP_POLL  : state_seq = &state->poll_seq;   break;
+      case URING_OP_RECV  : state_seq = &state->recv_seq;   break;
+      case URING_OP_ACCEPT: state_seq = &state->accept_seq; break;
+      default: break;
+    }
+  }
+
+  if (state_seq == nullptr || *state_seq != seq)
+  {
+    if (buffer_id >= 0)
+      recv_buffers_.recycle(buffer_id);
+    if (op == URING_OP_ACCEPT && cqe.res >= 0)
+      ::close(cqe.res);
+    return;
+  }
+
+  // terminated. armed again at the next wait().
+  bool detached = false;
+  if (more == false)
+  {
+    *state_seq = 0;
+    if (state->detaching == true && op == URING_OP_RECV)
+      detached = true;
+    else
+      mark_uring_dirty(io_handle, *state);
+  }
+
+  raise_uring_events(return_events, op, *state, cqe, buffer_id);
+
+  // detach_state, the recv has ended. its data is before it.
+  if (detached == true)
+  {
+    USER_DATA_T data          = state->data;
+    bool        return_event  = state->detach_return;
+
+    *state = IoHandleState();
+    if (return_event == true)
+      return_events.emplace_back(EVENT_DETACH, io_handle, data);
+  }
+}
+
+template<typename USER_DATA_T, USER_DATA_T default_value> void
+IoHandleDemuxer<USER_DATA_T, default_value>::raise_uring_events(std::vector<EventData>    &return_events,
+                                                                const uint32_t            &op,
+                                                                IoHandleState             &state,
+                                                                const struct io_uring_cqe &cqe,
+                                                                const int32_t             &buffer_id)
+{
+  const io_handle_t io_handle = state.io_handle;
+
+  if (cqe.res == -ECANCELED)
+    return;
+
+  switch (op)
+  {
+    case URING_OP_POLL:
+    {
+      if (io_handle == ctrl_event_fd_)
+      {
+        process_ctrl_ring(return_events);
+        return;
       }
 
-      // impossible
-      // if (epoll_events_by_io_handle_.count(io_handle) == 0)
-      //   continue;
-      // if recv() returns 0 bytes, epoll() returns EPOLLIN and EPOLLRDHUP together.
-      char buff[1];
-      if ((event.events & EPOLLIN) && (::recv(io_handle, &buff, 1, MSG_PEEK) > 0))
-        return_events.emplace_back(EVENT_READ,  io_handle);
+      if (cqe.res < 0)
+      {
+        return_events.emplace_back(EVENT_ERROR, io_handle, state.data);
+        return_events.back().result = -cqe.res;
+        return;
+      }
 
-      if ((event.events & EPOLLOUT) && !(event.events & EPOLLERR))
-        return_events.emplace_back(EVENT_WRITE, io_handle);
+      raise_io_events(return_events, state, (uint32_t)cqe.res);
+      return;
+    }
+    case URING_OP_RECV:
+    {
+      if (cqe.res > 0 && buffer_id >= 0)
+      {
+        return_events.emplace_back(EVENT_RECV, io_handle, state.data);
+        return_events.back().result = cqe.res;
+        return_events.back().buffer = recv_buffers_.buffer(buffer_id);
+        // staged. the kernel gets it back at the next wait().
+        recv_buffers_.recycle(buffer_id);
+        return;
+      }
 
-      if (event.events & EPOLLERR)
-        return_events.emplace_back(EVENT_ERROR, io_handle);
+      if (buffer_id >= 0)
+        recv_buffers_.recycle(buffer_id);
 
-      if ((event.events & EPOLLRDHUP) || (event.events & EPOLLHUP))
-        return_events.emplace_back(EVENT_CLOSE, io_handle);
+      if (cqe.res == 0)
+      {
+        state.recv_eof = true;
+        return_events.emplace_back(EVENT_CLOSE, io_handle, state.data);
+        return;
+      }
+
+      // out of the provided buffers, armed again after they are given back.
+      if (cqe.res == -ENOBUFS)
+        return;
+
+      return_events.emplace_back(EVENT_ERROR, io_handle, state.data);
+      return_events.back().result = -cqe.res;
+      return;
     }
+    case URING_OP_ACCEPT:
+    {
+      if (cqe.res >= 0)
+      {
+        return_events.emplace_back(EVENT_ACCEPT, io_handle, state.data);
+        return_events.back().result = cqe.res;
+        return;
+      }
 
-    return 0;
+      if (cqe.res == -EAGAIN || cqe.res == -EINTR || cqe.res == -ECONNABORTED)
+        return;
+
+      return_events.emplace_back(EVENT_ERROR, io_handle, state.data);
+      return_events.back().result = -cqe.res;
+      return;
+    }
   }
 }
 
+template<typename USER_DATA_T, USER_DATA_T default_value> int
+IoHandleDemuxer<USER_DATA_T, default_value>::wait_uring(std::vector<EventData> &return_events,
+                                                        const int32_t          &timeout_msec)
+{
+  // the buffers lent by the previous wait() go back to the kernel.
+  if (recv_completion_ == true)
+    recv_buffers_.publish();
+
+  // every interest changed since the last wait() goes in one io_uring_enter().
+  prepare_uring();
+
+  if (uring_.submit_and_wait(timeout_msec) < 0)
+    return -1;
+
+  uring_.for_each_cqe([&](const struct io_uring_cqe &cqe)
+  {
+    complete_uring(return_events, cqe);
+  });
+
+  return 0;
+}
+
 }
 
 #endif /* IO_REACTOR_REACTOR_IOHANDLEDEMUXER_H_ */
@@ -0,0 +1,132 @@
+/*
+ * IoHandleTable.h
+ *
+ *  Created on: 2026. 10. 17.
+ *      Author: tys
+ */
+
+#ifndef IO_REACTOR_REACTOR_IOHANDLETABLE_H_
+#define IO_REACTOR_REACTOR_IOHANDLETABLE_H_
+
+#include <reactor/DefinedType.h>
+
+#include <vector>
+#include <memory>
+#include <new>
+
+namespace reactor
+{
+
+/**
+ * flat slot table indexed by the io handle. (fds are small dense integers)
+ * allocated by pages, a slot never moves, so its address can be kept.
+ * (e.g. epoll_event.data.ptr) the slots are not released until clear().
+ * T is default constructible, the default value means an empty slot.
+ * not thread-safe.
+ */
+template<typename T>
+class IoHandleTable
+{
+public:
+  IoHandleTable() {}
+  IoHandleTable(const IoHandleTable &) = delete;
+  IoHandleTable &operator=(const IoHandleTable &) = delete;
+
+  // allocates the pages of io handles [0, size).
+  bool  reserve (const size_t &size);
+
+  // nullptr if the page of the io handle is not allocated yet.
+  T     *find   (const io_handle_t &io_handle)
+  {
+    if (io_handle < 0 || ((size_t)io_handle >> PAGE_BITS) >= pages_.size())
+      return nullptr;
+
+    T *page = pages_[(size_t)io_handle >> PAGE_BITS].get();
+    if (page == nullptr)
+      return nullptr;
+
+    return &page[io_handle & PAGE_MASK];
+  }
+
+  // allocates the page if needed. nullptr only if io_handle is invalid or out of memory.
+  T     *get    (const io_handle_t &io_handle)
+  {
+    T *slot = find(io_handle);
+    if (slot != nullptr || io_handle < 0)
+      return slot;
+
+    if (alloc_page((size_t)io_handle >> PAGE_BITS) == false)
+      return nullptr;
+
+    return find(io_handle);
+  }
+
+  // resets every slot to the default value. the pages are kept.
+  void  clear   ();
+
+  // func(io_handle, slot), every allocated slot including the empty ones.
+  template<typename FUNC>
+  void  for_each(FUNC func);
+
+private:
+  enum { PAGE_BITS = 10, PAGE_SIZE = 1 << PAGE_BITS, PAGE_MASK = PAGE_SIZE - 1 };
+
+  bool  alloc_page(const size_t &page_index);
+
+private:
+  std::vector<std::unique_ptr<T[]>> pages_;
+};
+
+template<typename T> bool
+IoHandleTable<T>::alloc_page(const size_t &page_index)
+{
+  if (page_index >= pages_.size())
+    pages_.resize(page_index + 1);
+
+  if (pages_[page_index])
+    return true;
+
+  pages_[page_index].reset(new (std::nothrow) T[PAGE_SIZE]());
+  return (bool)pages_[page_index];
+}
+
+template<typename T> bool
+IoHandleTable<T>::reserve(const size_t &size)
+{
+  for (size_t page_index = 0; page_index < (size + PAGE_SIZE - 1) / PAGE_SIZE; ++page_index)
+    if (alloc_page(page_index) == false)
+      return false;
+
+  return true;
+}
+
+template<typename T> void
+IoHandleTable<T>::clear()
+{
+  for (std::unique_ptr<T[]> &page : pages_)
+  {
+    if (!page)
+      continue;
+
+    for (size_t index = 0; index < PAGE_SIZE; ++index)
+      page[index] = T();
+  }
+}
+
+template<typename T> template<typename FUNC> void
+IoHandleTable<T>::for_each(FUNC func)
+{
+  for (size_t page_index = 0; page_index < pages_.size(); ++page_index)
+  {
+    T *page = pages_[page_index].get();
+    if (page == nullptr)
+      continue;
+
+    for (size_t index = 0; index < PAGE_SIZE; ++index)
+      func((io_handle_t)((page_index << PAGE_BITS) | index), page[index]);
+  }
+}
+
+}
+
+#endif /* IO_REACTOR_REACTOR_IOHANDLETABLE_H_ */
@@ -0,0 +1,428 @@
+/*
+ * IoUring.h
+ *
+ *  Created on: 2026. 10. 17.
+ *      Author: tys
+ */
+
+#ifndef IO_REACTOR_REACTOR_IOURING_H_
+#define IO_REACTOR_REACTOR_IOURING_H_
+
+#include <reactor/DefinedType.h>
+
+#include <algorithm>
+#include <vector>
+#include <cerrno>
+
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+
+namespace reactor
+{
+
+/**
+ * minimal io_uring wrapper on raw syscalls. (liburing is not required)
+ * not thread-safe, it is used only by the reactor thread.
+ */
+class IoUring
+{
+public:
+  IoUring() {}
+  ~IoUring() { close(); }
+
+  IoUring(const IoUring &) = delete;
+  IoUring &operator=(const IoUring &) = delete;
+
+  bool  init    (const uint32_t &entries);
+  void  close   ();
+  int   fd      () const { return ring_fd_; }
+
+  // nullptr if the submission queue is full even after submit().
+  struct io_uring_sqe *get_sqe();
+
+  // submits the prepared sqes without waiting.
+  int   submit  ();
+
+  /**
+   * submits the prepared sqes and waits for one completion at least.
+   * @param timeout_msec -1: infinite, 0: no wait
+   * @return 0 or -errno. timeout and interrupt return 0.
+   */
+  int   submit_and_wait(const int32_t &timeout_msec);
+
+  bool  has_cqe () const;
+
+  // calls func(const io_uring_cqe &) for all completions and consumes them.
+  template<typename F>
+  size_t for_each_cqe(F func);
+
+private:
+  void  flush_sq();
+  int   enter   (const uint32_t &to_submit, const uint32_t &min_complete,
+                 const uint32_t &flags, void *arg = nullptr, const size_t &arg_size = 0);
+
+private:
+  int       ring_fd_    = INVALID_IO_HANDLE;
+
+  void      *sq_ptr_    = MAP_FAILED;
+  size_t    sq_size_    = 0;
+  void      *cq_ptr_    = MAP_FAILED;
+  size_t    cq_size_    = 0;
+  struct io_uring_sqe *sqes_ = (struct io_uring_sqe *)MAP_FAILED;
+  size_t    sqes_size_  = 0;
+
+  uint32_t  *sq_head_   = nullptr;
+  uint32_t  *sq_tail_   = nullptr;
+  uint32_t  *sq_array_  = nullptr;
+  uint32_t  sq_mask_    = 0;
+  uint32_t  sq_entries_ = 0;
+  uint32_t  sqe_head_   = 0;  // flushed to sq_tail_
+  uint32_t  sqe_tail_   = 0;  // prepared
+  uint32_t  to_submit_  = 0;
+
+  uint32_t  *cq_head_   = nullptr;
+  uint32_t  *cq_tail_   = nullptr;
+  uint32_t  cq_mask_    = 0;
+  struct io_uring_cqe *cqes_ = nullptr;
+};
+
+/**
+ * provided buffers of a buffer group. (IORING_OP_PROVIDE_BUFFERS)
+ * the kernel picks a buffer for a recv, it is given back by recycle() and publish().
+ * the buffers are handed over by sqes which go out with the next submit,
+ * so replenishing costs no extra syscall.
+ * close the IoUring first, the kernel may still write into the buffers.
+ */
+class IoUringBuffers
+{
+public:
+  IoUringBuffers() {}
+  ~IoUringBuffers() { close(); }
+
+  IoUringBuffers(const IoUringBuffers &) = delete;
+  IoUringBuffers &operator=(const IoUringBuffers &) = delete;
+
+  bool      init    (IoUring &ring, const uint16_t &group_id,
+                     const uint32_t &count, const uint32_t &size);
+  void      close   ();
+
+  uint16_t  group_id() const { return group_id_; }
+  uint8_t  *buffer  (const uint16_t &buffer_id) { return buffers_ + (size_t)buffer_id * size_; }
+
+  // staged, handed over to the kernel by publish().
+  void      recycle (const uint16_t &buffer_id) { recycled_.push_back(buffer_id); }
+  void      publish ();
+
+private:
+  IoUring               *ring_    = nullptr;
+  uint8_t               *buffers_ = nullptr;
+  uint32_t              count_    = 0;
+  uint32_t              size_     = 0;
+  uint16_t              group_id_ = 0;
+  std::vector<uint16_t> recycled_;
+};
+
+inline bool
+IoUring::init(const uint32_t &entries)
+{
+  close();
+
+  struct io_uring_params params;
+  memset(&params, 0x00, sizeof(params));
+
+  // cq overflow가 나지 않도록 여유있게 잡는다.
+  params.flags      = IORING_SETUP_CQSIZE;
+  params.cq_entries = entries * 4;
+
+  ring_fd_ = (int)syscall(__NR_io_uring_setup, entries, &params);
+  if (ring_fd_ < 0)
+    return false;
+
+  // wait의 timeout을 위해 필요함. (5.11+)
+  if (!(params.features & IORING_FEAT_EXT_ARG))
+  {
+    close();
+    errno = ENOSYS;
+    return false;
+  }
+
+  sq_size_ = params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+  cq_size_ = params.cq_off.cqes  + params.cq_entries * sizeof(struct io_uring_cqe);
+
+  if (params.features & IORING_FEAT_SINGLE_MMAP)
+  {
+    if (cq_size_ > sq_size_)
+      sq_size_ = cq_size_;
+    cq_size_ = sq_size_;
+  }
+
+  sq_ptr_ = mmap(0, sq_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                 ring_fd_, IORING_OFF_SQ_RING);
+  if (sq_ptr_ == MAP_FAILED)
+  {
+    close();
+    return false;
+  }
+
+  if (params.features & IORING_FEAT_SINGLE_MMAP)
+  {
+    cq_ptr_ = sq_ptr_;
+  }
+  else
+  {
+    cq_ptr_ = mmap(0, cq_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                   ring_fd_, IORING_OFF_CQ_RING);
+    if (cq_ptr_ == MAP_FAILED)
+    {
+      close();
+      return false;
+    }
+  }
+
+  sqes_size_ = params.sq_entries * sizeof(struct io_uring_sqe);
+  sqes_ = (struct io_uring_sqe *)mmap(0, sqes_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                                      ring_fd_, IORING_OFF_SQES);
+  if (sqes_ == MAP_FAILED)
+  {
+    close();
+    return false;
+  }
+
+  uint8_t *sq = (uint8_t *)sq_ptr_;
+  sq_head_    = (uint32_t *)(sq + params.sq_off.head);
+  sq_tail_    = (uint32_t *)(sq + params.sq_off.tail);
+  sq_array_   = (uint32_t *)(sq + params.sq_off.array);
+  sq_mask_    = *(uint32_t *)(sq + params.sq_off.ring_mask);
+  sq_entries_ = *(uint32_t *)(sq + params.sq_off.ring_entries);
+
+  uint8_t *cq = (uint8_t *)cq_ptr_;
+  cq_head_    = (uint32_t *)(cq + params.cq_off.head);
+  cq_tail_    = (uint32_t *)(cq + params.cq_off.tail);
+  cq_mask_    = *(uint32_t *)(cq + params.cq_off.ring_mask);
+  cqes_       = (struct io_uring_cqe *)(cq + params.cq_off.cqes);
+
+  sqe_head_   = 0;
+  sqe_tail_   = 0;
+  to_submit_  = 0;
+
+  return true;
+}
+
+inline void
+IoUring::close()
+{
+  if (sqes_ != MAP_FAILED)
+    munmap(sqes_, sqes_size_);
+
+  if (cq_ptr_ != MAP_FAILED && cq_ptr_ != sq_ptr_)
+    munmap(cq_ptr_, cq_size_);
+
+  if (sq_ptr_ != MAP_FAILED)
+    munmap(sq_ptr_, sq_size_);
+
+  if (ring_fd_ != INVALID_IO_HANDLE)
+    ::close(ring_fd_);
+
+  sqes_     = (struct io_uring_sqe *)MAP_FAILED;
+  cq_ptr_   = MAP_FAILED;
+  sq_ptr_   = MAP_FAILED;
+  ring_fd_  = INVALID_IO_HANDLE;
+}
+
+inline struct io_uring_sqe *
+IoUring::get_sqe()
+{
+  uint32_t head = __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE);
+  if (sqe_tail_ - head >= sq_entries_)
+  {
+    // full. submit what is prepared.
+    submit();
+    head = __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE);
+    if (sqe_tail_ - head >= sq_entries_)
+      return nullptr;
+  }
+
+  struct io_uring_sqe *sqe = &sqes_[sqe_tail_ & sq_mask_];
+  memset(sqe, 0x00, sizeof(struct io_uring_sqe));
+  ++sqe_tail_;
+
+  return sqe;
+}
+
+inline void
+IoUring::flush_sq()
+{
+  if (sqe_head_ == sqe_tail_)
+    return;
+
+  uint32_t tail = *sq_tail_;
+  while (sqe_head_ != sqe_tail_)
+  {
+    sq_array_[tail & sq_mask_] = sqe_head_ & sq_mask_;
+    ++tail;
+    ++sqe_head_;
+    ++to_submit_;
+  }
+
+  __atomic_store_n(sq_tail_, tail, __ATOMIC_RELEASE);
+}
+
+inline int
+IoUring::enter(const uint32_t &to_submit, const uint32_t &min_complete,
+               const uint32_t &flags, void *arg, const size_t &arg_size)
+{
+  int result = (int)syscall(__NR_io_uring_enter, ring_fd_, to_submit, min_complete, flags, arg, arg_size);
+  return result < 0 ? -errno : result;
+}
+
+inline int
+IoUring::submit()
+{
+  flush_sq();
+  if (to_submit_ == 0)
+    return 0;
+
+  int result = enter(to_submit_, 0, 0);
+  if (result > 0)
+    to_submit_ -= result;
+
+  return result < 0 ? result : 0;
+}
+
+inline int
+IoUring::submit_and_wait(const int32_t &timeout_msec)
+{
+  flush_sq();
+
+  uint32_t min_complete = (timeout_msec == 0 || has_cqe() == true) ? 0 : 1;
+  if (min_complete == 0 && to_submit_ == 0)
+    return 0;
+
+  uint32_t flags = (min_complete > 0) ? IORING_ENTER_GETEVENTS : 0;
+
+  struct __kernel_timespec      ts;
+  struct io_uring_getevents_arg arg;
+  memset(&arg, 0x00, sizeof(arg));
+
+  int result = 0;
+  if (min_complete > 0 && timeout_msec > 0)
+  {
+    ts.tv_sec   = timeout_msec / 1000;
+    ts.tv_nsec  = (timeout_msec % 1000) * 1000000LL;
+    arg.ts      = (uint64_t)&ts;
+    result = enter(to_submit_, min_complete, flags | IORING_ENTER_EXT_ARG, &arg, sizeof(arg));
+  }
+  else
+  {
+    result = enter(to_submit_, min_complete, flags);
+  }
+
+  if (result >= 0)
+  {
+    to_submit_ -= (uint32_t)result > to_submit_ ? to_submit_ : result;
+    return 0;
+  }
+
+  switch (-result)
+  {
+    case ETIME: case EINTR: case EBUSY: case EAGAIN: return 0;
+    default: return result;
+  }
+}
+
+inline bool
+IoUring::has_cqe() const
+{
+  return *cq_head_ != __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+}
+
+template<typename F> size_t
+IoUring::for_each_cqe(F func)
+{
+  uint32_t head = *cq_head_;
+  uint32_t tail = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+
+  for (uint32_t index = head; index != tail; ++index)
+    func(cqes_[index & cq_mask_]);
+
+  __atomic_store_n(cq_head_, tail, __ATOMIC_RELEASE);
+  return tail - head;
+}
+
+inline bool
+IoUringBuffers::init(IoUring &ring, const uint16_t &group_id,
+                     const uint32_t &count, const uint32_t &size)
+{
+  close();
+
+  // buffer id is 16 bits.
+  count_ = count > 65536 ? 65536 : count;
+  size_  = size;
+
+  buffers_ = (uint8_t *)malloc((size_t)count_ * size_);
+  if (buffers_ == nullptr)
+    return false;
+
+  ring_     = &ring;
+  group_id_ = group_id;
+
+  recycled_.reserve(count_);
+  for (uint32_t buffer_id = 0; buffer_id < count_; ++buffer_id)
+    recycle(buffer_id);
+  publish();
+
+  return true;
+}
+
+inline void
+IoUringBuffers::close()
+{
+  free(buffers_);
+
+  buffers_  = nullptr;
+  ring_     = nullptr;
+  recycled_.clear();
+}
+
+inline void
+IoUringBuffers::publish()
+{
+  if (recycled_.size() == 0)
+    return;
+
+  // the consecutive buffers go in one sqe.
+  std::sort(recycled_.begin(), recycled_.end());
+
+  size_t index = 0;
+  while (index < recycled_.size())
+  {
+    size_t end = index + 1;
+    while (end < recycled_.size() && recycled_[end] == recycled_[end-1] + 1)
+      ++end;
+
+    struct io_uring_sqe *sqe = ring_->get_sqe();
+    if (sqe == nullptr)
+      break;
+
+    sqe->opcode     = IORING_OP_PROVIDE_BUFFERS;
+    sqe->fd         = (int32_t)(end - index);
+    sqe->addr       = (uint64_t)buffer(recycled_[index]);
+    sqe->len        = size_;
+    sqe->off        = recycled_[index];
+    sqe->buf_group  = group_id_;
+    // not a request of the user.
+    sqe->user_data  = 0;
+
+    index = end;
+  }
+
+  recycled_.erase(recycled_.begin(), recycled_.begin() + index);
+}
+
+}
+
+#endif /* IO_REACTOR_REACTOR_IOURING_H_ */
@@ -0,0 +1,124 @@
+/*
+ * MpscRing.h
+ *
+ *  Created on: 2026. 10. 17.
+ *      Author: tys
+ */
+
+#ifndef IO_REACTOR_REACTOR_MPSCRING_H_
+#define IO_REACTOR_REACTOR_MPSCRING_H_
+
+#include <reactor/DefinedType.h>
+
+#include <type_traits>
+#include <atomic>
+#include <memory>
+
+namespace reactor
+{
+
+/**
+ * bounded lock-free multi producer / single consumer ring. (Vyukov)
+ * T must be trivially copyable. push() fails when the ring is full.
+ */
+template<typename T>
+class MpscRing
+{
+public:
+  static_assert(std::is_trivially_copyable<T>::value, "MpscRing requires trivially copyable type");
+
+  MpscRing() {}
+  MpscRing(const MpscRing &) = delete;
+  MpscRing &operator=(const MpscRing &) = delete;
+
+  // capacity is rounded up to a power of two.
+  bool    init    (const size_t &capacity);
+
+  bool    push    (const T &value);
+  bool    pop     (T &value);
+
+  size_t  capacity() const { return mask_ + 1; }
+
+private:
+  struct Cell
+  {
+    std::atomic<size_t> sequence;
+    T                   value;
+  };
+
+  std::unique_ptr<Cell[]> cells_;
+  size_t                  mask_ = 0;
+
+  alignas(64) std::atomic<size_t> enqueue_pos_{0};
+  alignas(64) size_t              dequeue_pos_ = 0;
+};
+
+template<typename T> bool
+MpscRing<T>::init(const size_t &capacity)
+{
+  size_t size = 2;
+  while (size < capacity)
+    size <<= 1;
+
+  cells_.reset(new (std::nothrow) Cell[size]);
+  if (!cells_)
+    return false;
+
+  for (size_t index = 0; index < size; ++index)
+    cells_[index].sequence.store(index, std::memory_order_relaxed);
+
+  mask_ = size - 1;
+  enqueue_pos_.store(0, std::memory_order_relaxed);
+  dequeue_pos_ = 0;
+  return true;
+}
+
+template<typename T> bool
+MpscRing<T>::push(const T &value)
+{
+  size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+
+  while (true)
+  {
+    Cell &cell = cells_[pos & mask_];
+    size_t seq = cell.sequence.load(std::memory_order_acquire);
+    intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+
+    if (diff == 0)
+    {
+      if (enqueue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+      {
+        cell.value = value;
+        cell.sequence.store(pos + 1, std::memory_order_release);
+        return true;
+      }
+      continue;
+    }
+
+    // full
+    if (diff < 0)
+      return false;
+
+    pos = enqueue_pos_.load(std::memory_order_relaxed);
+  }
+}
+
+template<typename T> bool
+MpscRing<T>::pop(T &value)
+{
+  Cell &cell = cells_[dequeue_pos_ & mask_];
+  size_t seq = cell.sequence.load(std::memory_order_acquire);
+
+  // empty, or the producer has not published the cell yet.
+  if ((intptr_t)seq - (intptr_t)(dequeue_pos_ + 1) < 0)
+    return false;
+
+  value = cell.value;
+  cell.sequence.store(dequeue_pos_ + mask_ + 1, std::memory_order_release);
+  ++dequeue_pos_;
+  return true;
+}
+
+}
+
+#endif /* IO_REACTOR_REACTOR_MPSCRING_H_ */
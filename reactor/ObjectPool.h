@@ -0,0 +1,116 @@
+/*
+ * ObjectPool.h
+ *
+ *  Created on: 2026. 10. 17.
+ *      Author: tys
+ */
+
+#ifndef IO_REACTOR_REACTOR_OBJECTPOOL_H_
+#define IO_REACTOR_REACTOR_OBJECTPOOL_H_
+
+#include <mutex>
+#include <vector>
+
+#include <sys/socket.h>
+
+namespace reactor
+{
+
+/**
+ * free list of the objects, the object is not destroyed and keeps its buffers.
+ * acquire and release can be called on different threads.
+ * (the acceptor thread acquires, the reactor or user thread releases)
+ */
+template<typename T>
+class ObjectPool
+{
+public:
+  explicit ObjectPool(const size_t &max_size = 1024) : max_size_(max_size) {}
+
+  ~ObjectPool()
+  {
+    for (T *object : objects_)
+      delete object;
+  }
+
+  ObjectPool(const ObjectPool &) = delete;
+  ObjectPool &operator=(const ObjectPool &) = delete;
+
+  // nullptr if empty.
+  T *acquire()
+  {
+    std::lock_guard<std::mutex> guard(lock_);
+    if (objects_.size() == 0)
+      return nullptr;
+
+    T *object = objects_.back();
+    objects_.pop_back();
+    return object;
+  }
+
+  // false if full, the caller deletes the object.
+  bool release(T *object)
+  {
+    std::lock_guard<std::mutex> guard(lock_);
+    if (objects_.size() >= max_size_)
+      return false;
+
+    objects_.push_back(object);
+    return true;
+  }
+
+  size_t size() const
+  {
+    std::lock_guard<std::mutex> guard(lock_);
+    return objects_.size();
+  }
+
+private:
+  mutable std::mutex  lock_;
+  std::vector<T *>    objects_;
+  size_t              max_size_ = 1024;
+};
+
+/**
+ * pool of TCPSessionHandler or SSLSessionHandler subclasses, for the session factory.
+ *
+ *   create : T *session = pool.acquire(client_addr);
+ *            if (session == nullptr) session = new T(client_addr);
+ *   handle_removed: pool.release(this); instead of delete this;
+ *
+ * a reused session gets handle_reused() to reset the state of the previous connection.
+ * its event handler goes back to the pool of the event handler factory on release.
+ */
+template<typename T>
+class SessionPool
+{
+public:
+  explicit SessionPool(const size_t &max_size = 1024) : pool_(max_size) {}
+
+  T *acquire(const sockaddr_storage &client_addr)
+  {
+    T *session = pool_.acquire();
+    if (session == nullptr)
+      return nullptr;
+
+    // calls handle_reused()
+    session->reuse_session(client_addr);
+    return session;
+  }
+
+  void release(T *session)
+  {
+    session->release_session();
+    if (pool_.release(session) == false)
+      delete session;
+  }
+
+  size_t size() const { return pool_.size(); }
+
+private:
+  ObjectPool<T> pool_;
+};
+
+}
+
+#endif /* IO_REACTOR_REACTOR_OBJECTPOOL_H_ */
@@ -11,16 +11,22 @@
 #include <reactor/DefinedType.h>
 #include <reactor/trace.h>
 
-#include <map>
 #include <unordered_set>
-#include <unordered_map>
+#include <algorithm>
 #include <chrono>
 #include <deque>
+#include <vector>
 #include <mutex>
 
 namespace reactor
 {
 
+/**
+ * keyed timer for a few objects. (per session timer keys)
+ * a flat vector sorted by the deadline, no allocation once the capacity is reached.
+ * the nearest deadline of a session is armed on the reactor wheel, no wheel per session.
+ * H is not used, the keys are compared by P. (compatibility)
+ */
 template< typename T,
           typename H = std::hash<T>,
           typename P = std::equal_to<T>>
@@ -35,16 +41,25 @@ public:
 
   bool    remove_timeout  (T object);
 
+  // appends the expired objects.
+  size_t  extract_timeout_objects(std::vector<T> &objects);
+
+  // the expired objects in a set. (compatibility)
   std::deque<std::unordered_set<T, H, P>>
           extract_timeout_objects();
 
   size_t  size() const;
 
+  // keeps the capacity.
+  void    clear();
+
 private:
   int32_t get_min_timeout_milliseconds_no_lock();
 
   bool    remove_timeout_no_lock(T object);
 
+  size_t  extract_timeout_objects_no_lock(std::vector<T> &objects);
+
   class LockGuard
   {
   public:
@@ -61,8 +76,14 @@ private:
   };
 
 private:
-  std::map<std::chrono::steady_clock::time_point, std::unordered_set<T, H, P>>  time_object_;
-  std::unordered_map<T, std::chrono::steady_clock::time_point, H, P>            object_time_;
+  struct Timer
+  {
+    std::chrono::steady_clock::time_point deadline;
+    T object;
+  };
+
+  // ascending by the deadline
+  std::vector<Timer> timers_;
 
   mutable std::mutex lock_;
   bool using_lock_ = false;
@@ -71,16 +92,19 @@ private:
 template<typename T, typename H, typename P> int32_t
 ObjectsTimer<T, H, P>::get_min_timeout_milliseconds_no_lock()
 {
-  if (time_object_.size() == 0)
+  if (timers_.size() == 0)
     return -1;
 
-  int32_t min = std::chrono::duration_cast<std::chrono::milliseconds>(
-      time_object_.begin()->first - std::chrono::steady_clock::now()).count();
-
-  if (min <= 0)
+  std::chrono::steady_clock::duration remain =
+      timers_.front().deadline - std::chrono::steady_clock::now();
+  if (remain <= std::chrono::steady_clock::duration::zero())
     return 0;
 
-  return min;
+  // rounded up, 0 only when extract_timeout_objects has something.
+  int64_t min = std::chrono::duration_cast<std::chrono::milliseconds>(
+      remain + std::chrono::milliseconds(1) - std::chrono::steady_clock::duration(1)).count();
+
+  return min > INT32_MAX ? INT32_MAX : (int32_t)min;
 }
 
 template<typename T, typename H, typename P> int32_t
@@ -96,8 +120,13 @@ ObjectsTimer<T, H, P>::register_timeout(const uint32_t &msec, T object)
   LockGuard guard(lock_, using_lock_);
   remove_timeout_no_lock(object);
 
-  object_time_[object] = std::chrono::steady_clock::now() + std::chrono::milliseconds(msec);
-  time_object_[object_time_[object]].insert(object);
+  Timer timer{std::chrono::steady_clock::now() + std::chrono::milliseconds(msec), object};
+
+  // after the same deadline, the order of registration.
+  timers_.insert(std::upper_bound(timers_.begin(), timers_.end(), timer,
+                                  [](const Timer &lhs, const Timer &rhs)
+                                  { return lhs.deadline < rhs.deadline; }),
+                 timer);
 
   return get_min_timeout_milliseconds_no_lock();
 }
@@ -109,59 +138,72 @@ ObjectsTimer<T, H, P>::remove_timeout(T object)
   return remove_timeout_no_lock(object);
 }
 
-template<typename T, typename H, typename P>
-std::deque<std::unordered_set<T, H, P>>
-ObjectsTimer<T, H, P>::extract_timeout_objects()
+template<typename T, typename H, typename P> bool
+ObjectsTimer<T, H, P>::remove_timeout_no_lock(T object)
 {
-  LockGuard guard(lock_, using_lock_);
-  std::deque<std::unordered_set<T, H, P>> timeout_objects;
-
-  if (time_object_.size() == 0)
-    return timeout_objects;
-
-  typename std::map<std::chrono::steady_clock::time_point,
-                    std::unordered_set<T, H, P>>::iterator it = time_object_.begin();
-
-  while (it != time_object_.end())
+  P equal;
+  for (typename std::vector<Timer>::iterator it = timers_.begin(); it != timers_.end(); ++it)
   {
-    if (std::chrono::duration_cast<std::chrono::milliseconds>(
-        time_object_.begin()->first - std::chrono::steady_clock::now()).count() > 0)
-      break;
-
-    for (T object : it->second)
-      object_time_.erase(object);
+    if (equal(it->object, object) == false)
+      continue;
 
-    timeout_objects.emplace_back(it->second);
-
-    it = time_object_.erase(it);
+    timers_.erase(it);
+    return true;
   }
 
-  return timeout_objects;
+  return false;
 }
 
+template<typename T, typename H, typename P> size_t
+ObjectsTimer<T, H, P>::extract_timeout_objects_no_lock(std::vector<T> &objects)
+{
+  std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+
+  size_t count = 0;
+  while (count < timers_.size() && timers_[count].deadline <= now)
+    objects.push_back(timers_[count++].object);
+
+  timers_.erase(timers_.begin(), timers_.begin() + count);
+  return count;
+}
 
 template<typename T, typename H, typename P> size_t
-ObjectsTimer<T, H, P>::size() const
+ObjectsTimer<T, H, P>::extract_timeout_objects(std::vector<T> &objects)
 {
   LockGuard guard(lock_, using_lock_);
-  return time_object_.size();
+  return extract_timeout_objects_no_lock(objects);
 }
 
-template<typename T, typename H, typename P> bool
-ObjectsTimer<T, H, P>::remove_timeout_no_lock(T object)
+template<typename T, typename H, typename P>
+std::deque<std::unordered_set<T, H, P>>
+ObjectsTimer<T, H, P>::extract_timeout_objects()
 {
-  if (object_time_.count(object) == 0)
-    return false;
+  LockGuard guard(lock_, using_lock_);
 
-  time_object_[object_time_[object]].erase(object);
+  std::deque<std::unordered_set<T, H, P>> result;
 
-  if (time_object_[object_time_[object]].size() == 0)
-    time_object_.erase(object_time_[object]);
+  std::vector<T> objects;
+  if (extract_timeout_objects_no_lock(objects) == 0)
+    return result;
 
-  return object_time_.erase(object) > 0;
+  result.emplace_back(objects.begin(), objects.end());
+  return result;
 }
 
+template<typename T, typename H, typename P> size_t
+ObjectsTimer<T, H, P>::size() const
+{
+  LockGuard guard(lock_, using_lock_);
+  return timers_.size();
 }
 
-#endif /* IO_REACTOR_REACTOR_OBJECTSTIMER_H_ */
+template<typename T, typename H, typename P> void
+ObjectsTimer<T, H, P>::clear()
+{
+  LockGuard guard(lock_, using_lock_);
+  timers_.clear();
+}
 
+}
+
+#endif /* IO_REACTOR_REACTOR_OBJECTSTIMER_H_ */
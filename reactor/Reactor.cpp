@@ -1,4 +1,8 @@
 #include "Reactor.h"
+#include <reactor/acceptor/AdmissionControl.h>
+#include <reactor/trace.h>
+#include <algorithm>
+#include <chrono>
 #include <assert.h>
 
 namespace reactor
@@ -8,33 +12,51 @@ void
 Reactor::dispatch_reactor_event(const IoDemuxer::EventData &event,
                                 bool &is_stop_event)
 {
-  if (event.recv_event < IoDemuxer::EVENT_USER)
-    return;
-
   if (event.recv_event == EVENT_STOP)
   {
     is_stop_event = true;
     return;
   }
 
-  std::unordered_map<io_handle_t, EventHandler *>::iterator it =
-      handlers_.find(event.io_handle);
+  if (event.recv_event == EVENT_DRAIN)
+  {
+    start_drain((uint32_t)((uint64_t)event.data));
+    return;
+  }
 
-  if (it == handlers_.end())
+  HandlerSlot *slot = handlers_.find(event.io_handle);
+  if (slot == nullptr)
     return;
 
+  // a request made to this reactor after the handler has migrated.
+  if (slot->handler == nullptr)
+  {
+    if (slot->moved_to != nullptr)
+      slot->moved_to->demuxer_.raise_user_event(event.recv_event, event.io_handle, event.data);
+    return;
+  }
+
+  EventHandler *handler = slot->handler;
+
   switch (event.recv_event)
   {
+    case EVENT_MIGRATE:
+    {
+      // removed and the io handle reused before it.
+      if (event.data == handler)
+        start_migrate(handler);
+      return;
+    }
     case EVENT_TIMEOUT_ADD:
     {
       uint32_t timeout_msec = (uint64_t)(event.data);
 
-      timer_.register_timeout(timeout_msec, it->second);
+      timer_.register_timeout(timeout_msec, handler->timer_node_);
       return;
     }
     case EVENT_TIMEOUT_DEL:
     {
-      timer_.remove_timeout(it->second);
+      timer_.remove_timeout(handler->timer_node_);
       return;
     }
   }
@@ -43,35 +65,50 @@ Reactor::dispatch_reactor_event(const IoDemuxer::EventData &event,
 void
 Reactor::dispatch_demuxer_event_io(const IoDemuxer::EventData &event)
 {
-  if (event.recv_event > IoDemuxer::EVENT_CLOSE)
-    return;
+  // the demuxer carries the registered handler, it is alive until its EVENT_REMOVE_ALL.
+  if (event.data == nullptr)
+  {
+    if (event.recv_event == IoDemuxer::EVENT_ACCEPT)
+      ::close(event.result);
 
-  std::unordered_map<io_handle_t, EventHandler *>::iterator it =
-      handlers_.find(event.io_handle);
+    // register_writable after the handler has migrated. (a stale reactor_ of another thread)
+    if (event.recv_event == IoDemuxer::EVENT_WRITE)
+    {
+      HandlerSlot *slot = handlers_.find(event.io_handle);
+      if (slot != nullptr && slot->handler == nullptr && slot->moved_to != nullptr)
+        slot->moved_to->demuxer_.register_write_event(event.io_handle, nullptr, false);
+    }
 
-  if (it == handlers_.end())
-  {
     demuxer_.remove_all_events(event.io_handle, nullptr, false);
     return;
   }
 
-  EventHandler &handler = *(it->second);
+  EventHandler &handler = *(event.data);
 
   switch (event.recv_event)
   {
     case IoDemuxer::EVENT_READ:
     {
+      touch_input(handler);
       handler.handle_input();
       return;
     }
     case IoDemuxer::EVENT_WRITE:
     {
-      demuxer_.remove_write_event(handler.io_handle_, nullptr, false);
+      // edge-triggered keeps EPOLLOUT armed.
+      if (handler.edge_triggered_ == false)
+        demuxer_.remove_write_event(handler.io_handle_, nullptr, false);
+      touch_output(handler);
       handler.handle_output();
       return;
     }
     case IoDemuxer::EVENT_ERROR:
     {
+      if (event.result != 0)
+      {
+        handler.handle_error(event.result, std::strerror(event.result));
+        return;
+      }
       if (errno == 0)
       {
         handler.handle_error(EPIPE, std::strerror(EPIPE));
@@ -82,22 +119,31 @@ Reactor::dispatch_demuxer_event_io(const IoDemuxer::EventData &event)
     }
     case IoDemuxer::EVENT_CLOSE:
     {
-      if (handle_close_call_.count(handler.io_handle_) > 0)
+      HandlerSlot *slot = handlers_.find(event.io_handle);
+      if (slot == nullptr || slot->handler != &handler || slot->close_called == true)
         return;
 
-      handle_close_call_.insert(handler.io_handle_);
+      slot->close_called = true;
       handler.handle_close();
       return;
     }
+    case IoDemuxer::EVENT_RECV:
+    {
+      touch_input(handler);
+      handler.handle_recv(event.buffer, event.result);
+      return;
+    }
+    case IoDemuxer::EVENT_ACCEPT:
+    {
+      handler.handle_accept(event.result);
+      return;
+    }
   }
 }
 
 void
 Reactor::dispatch_demuxer_event_result(const IoDemuxer::EventData &event)
 {
-  if (event.recv_event <= IoDemuxer::EVENT_CLOSE)
-    return;
-
   EventHandler *handler = event.data;
   if (handler == nullptr)
     return;
@@ -105,12 +151,32 @@ Reactor::dispatch_demuxer_event_result(const IoDemuxer::EventData &event)
   switch (event.recv_event)
   {
     case IoDemuxer::EVENT_REGISTER_READ:
+    case IoDemuxer::EVENT_REGISTER_ACCEPT:
     {
-      ++handler_count_;
-      handlers_.emplace(std::make_pair(event.io_handle, handler));
+      HandlerSlot *slot = handlers_.get(event.io_handle);
+      if (slot == nullptr)
+        return;
+
+      handler_count_.fetch_add(1, std::memory_order_relaxed);
+      if (slot->handler == nullptr)
+      {
+        *slot = HandlerSlot();
+        slot->handler       = handler;
+        slot->acceptor      = event.recv_event == IoDemuxer::EVENT_REGISTER_ACCEPT;
+      }
 
       handler->reactor_ = this;
-      handler->handle_registered();
+
+      // the sessions, not the acceptors nor the ReactorHandler.
+      handler->idle_tracked_ = event.recv_event     == IoDemuxer::EVENT_REGISTER_READ &&
+                               handler              != reactor_handler_ &&
+                               handler->idle_tracking_ == true;
+      touch_input(*handler);
+
+      if (handler->migrate_to_.load() == this)
+        arrive_migrate(handler);
+      else
+        handler->handle_registered();
 
       if (handler != reactor_handler_ && reactor_handler_ != nullptr)
         reactor_handler_->reactor_handle_registered_handler(handler);
@@ -119,14 +185,25 @@ Reactor::dispatch_demuxer_event_result(const IoDemuxer::EventData &event)
     }
     case IoDemuxer::EVENT_REMOVE_ALL:
     {
-      if (handlers_.count(event.io_handle) == 0)
+      HandlerSlot *slot = handlers_.find(event.io_handle);
+      if (slot == nullptr || slot->handler == nullptr)
         return;
 
-      timer_.remove_timeout(handler);
-      handlers_.erase(event.io_handle);
-      handle_close_call_.erase(event.io_handle);
+      timer_.remove_timeout(handler->timer_node_);
+      untrack(*handler);
+      *slot = HandlerSlot();
+
+      handler_count_.fetch_sub(1, std::memory_order_relaxed);
+
+      // a migration not started yet is cancelled.
+      handler->migrate_to_ = nullptr;
+
+      if (handler->admission_ != nullptr)
+      {
+        handler->admission_->release(handler->admission_key_);
+        handler->admission_ = nullptr;
+      }
 
-      --handler_count_;
       // User can delete in handle_removed.
       handler->handle_removed();
       // handler->reactor_ = nullptr;
@@ -136,18 +213,147 @@ Reactor::dispatch_demuxer_event_result(const IoDemuxer::EventData &event)
 
       return;
     }
+    case IoDemuxer::EVENT_DETACH:
+    {
+      finish_migrate(handler);
+      return;
+    }
+  }
+}
+
+void
+Reactor::start_migrate(EventHandler *handler)
+{
+  Reactor *to = handler->migrate_to_.load();
+  if (to == nullptr)
+    return;
+
+  HandlerSlot *slot = handlers_.find(handler->io_handle_);
+
+  // the sessions only, and not closing. the reactor moving to must be running.
+  if (slot->acceptor      == true ||
+      slot->close_called  == true ||
+      handler == reactor_handler_ ||
+      to->stop_.load() == true)
+  {
+    handler->migrate_to_ = nullptr;
+    return;
+  }
+
+  // the handler is served here until EVENT_DETACH.
+  demuxer_.detach_io_handle(handler->io_handle_, handler, true);
+}
+
+void
+Reactor::finish_migrate(EventHandler *handler)
+{
+  HandlerSlot *slot = handlers_.find(handler->io_handle_);
+  if (slot == nullptr || slot->handler != handler)
+    return;
+
+  Reactor *to = handler->migrate_to_.load();
+
+  // closed while detaching, handle_close has removed it. (or it removes it)
+  if (to == nullptr || slot->close_called == true)
+  {
+    handler->migrate_to_ = nullptr;
+    return;
   }
+
+  // stopped while detaching, it comes back here.
+  if (to->stop_.load() == true)
+    to = this;
+
+  handler->migrate_expire_ = timer_.expire_milliseconds(handler->timer_node_);
+  timer_.remove_timeout(handler->timer_node_);
+  untrack(*handler);
+
+  *slot = HandlerSlot();
+  if (to != this)
+    slot->moved_to = to;
+
+  handler_count_.fetch_sub(1, std::memory_order_relaxed);
+
+  if (to != this && handler->admission_ != nullptr)
+    handler->admission_->move(handler->admission_key_, handler->migrate_index_);
+
+  if (reactor_handler_ != nullptr)
+    reactor_handler_->reactor_handle_removed_handler(handler);
+
+  // the handler belongs to the other reactor from here.
+  handler->migrate_to_ = to;
+  if (to != this && to->register_event_handler(handler, handler->io_handle_) == true)
+    return;
+
+  slot->moved_to = nullptr;
+  handler->migrate_to_ = this;
+  register_event_handler(handler, handler->io_handle_);
+}
+
+void
+Reactor::arrive_migrate(EventHandler *handler)
+{
+  handler->migrate_to_ = nullptr;
+
+  if (handler->migrate_expire_ > 0)
+    timer_.register_expire(handler->migrate_expire_, handler->timer_node_);
+
+  // the output queued while it was moving, its writable requests went to the other reactor.
+  register_writable(handler);
+
+  handler->handle_migrated();
+}
+
+void
+Reactor::start_drain(const uint32_t &timeout_msec)
+{
+  if (draining_ == true)
+    return;
+
+  draining_       = true;
+  drain_deadline_ = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_msec);
+
+  // the removing is deferred to the demuxer, the slots are not changed in this loop.
+  handlers_.for_each([&](const io_handle_t &, HandlerSlot &slot)
+  {
+    if (slot.handler != nullptr && slot.handler != reactor_handler_)
+      slot.handler->handle_drain();
+  });
+}
+
+int32_t
+Reactor::drain_remaining_msec()
+{
+  if (draining_ == false)
+    return -1;
+
+  if (handler_count() == 0)
+    return 0;
+
+  int64_t remaining = std::chrono::duration_cast<std::chrono::milliseconds>(
+      drain_deadline_ - std::chrono::steady_clock::now()).count();
+
+  if (remaining <= 0)
+    return 0;
+
+  return remaining > INT32_MAX ? INT32_MAX : (int32_t)remaining;
 }
 
 void
 Reactor::run()
 {
   stop_ = false;
+  thread_id_ = std::this_thread::get_id();
+
+  if (CpuAffinity::set_current_thread(cpus_) == false)
+    reactor_trace << "cpu affinity failed" << std::endl;
 
+  // an epoll event raises up to 3 events. (read, write or error, close)
   std::vector<IoDemuxer::EventData> events;
-  events.reserve(10000);
+  events.reserve(max_events_ * 3);
 
   run_reactor_handler();
+  update_now();
 
   while (true)
   {
@@ -155,9 +361,24 @@ Reactor::run()
     while ((timeout = timer_.get_min_timeout_milliseconds()) == 0)
       run_timeout_handler();
 
+    int32_t idle_timeout = run_idle_handler();
+    if (idle_timeout >= 0 && (timeout < 0 || idle_timeout < timeout))
+      timeout = idle_timeout;
+
+    int32_t drain_timeout = drain_remaining_msec();
+    if (drain_timeout == 0)
+      break;
+
+    if (drain_timeout > 0 && (timeout < 0 || drain_timeout < timeout))
+      timeout = drain_timeout;
+
     events.clear();
     demuxer_.wait(events, timeout);
 
+    // the clock of this loop, see set_idle_timeout.
+    std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+    now_msec_ = std::chrono::duration_cast<std::chrono::milliseconds>(begin.time_since_epoch()).count();
+
     // timeout
     if (events.size() == 0)
     {
@@ -167,10 +388,21 @@ Reactor::run()
 
     if (dispatch(events) == true)
       break;
+
+    // 1/8 weight of the latest loop.
+    int64_t elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - begin).count();
+    uint32_t latency = loop_latency_usec_.load(std::memory_order_relaxed);
+    loop_latency_usec_.store(latency - latency / 8 + (uint32_t)std::min<int64_t>(elapsed, UINT32_MAX / 8) / 8,
+                             std::memory_order_relaxed);
   }
 
   run_shutdown();
 
+  // the next start initializes it again.
+  initialized_ = false;
+  draining_    = false;
+  thread_id_   = std::thread::id();
   stop_ = true;
 }
 }
@@ -10,12 +10,16 @@
 
 #include <reactor/ReactorHandlerFactory.h>
 #include <reactor/EventHandler.h>
-#include <reactor/ObjectsTimer.h>
+#include <reactor/TimingWheel.h>
+#include <reactor/IdleList.h>
 #include <reactor/IoHandleDemuxer.h>
+#include <reactor/IoHandleTable.h>
+#include <reactor/CpuAffinity.h>
 
-#include <unordered_map>
-#include <unordered_set>
+#include <algorithm>
 #include <atomic>
+#include <chrono>
+#include <thread>
 #include <cerrno>
 #include <cstring>
 
@@ -36,20 +40,118 @@ public:
 
   Reactor();
   bool  init(int32_t max_clients, size_t  max_events,
-             ReactorHandlerFactory *factory = nullptr);
+             ReactorHandlerFactory *factory = nullptr,
+             const IoDemuxer::ENGINE &engine = IoDemuxer::ENGINE_EPOLL);
+
+  bool  initialized() const { return initialized_; }
+  IoDemuxer::ENGINE engine() const { return demuxer_.engine(); }
 
   bool  register_event_handler(EventHandler *handler, const io_handle_t &io_handle);
+  /**
+   * register_event_handler of a batch, the io handle of each handler is set already.
+   * from another thread, the reactor is woken up once for the batch.
+   */
+  bool  register_event_handlers(EventHandler *const *handlers, const size_t &count);
+  /**
+   * listening io handle. the reactor accepts the connections and
+   * calls handler->handle_accept(). removed by remove_event_handler.
+   */
+  bool  register_acceptor     (EventHandler *handler, const io_handle_t &io_handle);
+  /**
+   * the listening io handle of register_acceptor is not read, the kernel backlog holds
+   * the clients. resume_acceptor reads it again, the handler is kept registered.
+   */
+  bool  pause_acceptor        (EventHandler *handler);
+  bool  resume_acceptor       (EventHandler *handler);
   bool  remove_event_handler  (EventHandler *handler);
   bool  register_writable     (EventHandler *handler);
+  /**
+   * register_writable of a batch. (e.g. a broadcast)
+   * from another thread, the reactor is woken up once for the batch.
+   */
+  bool  register_writables    (EventHandler *const *handlers, const size_t &count);
+  /**
+   * call when a write returned EAGAIN.
+   * level-triggered: same as register_writable.
+   * edge-triggered : arms EPOLLOUT if needed and waits for the next edge.
+   */
+  bool  wait_writable         (EventHandler *handler);
+  /**
+   * EVENT_ERROR is waited even if no read or write is armed. (the error queue of MSG_ZEROCOPY)
+   * the io_uring recv completion needs it, the other registrations report the errors by themselves.
+   */
+  bool  register_error_event  (EventHandler *handler);
 
   bool  set_timeout           (EventHandler *handler, const uint32_t &msec);
   bool  unset_timeout         (EventHandler *handler);
 
+  // tick of the timing wheel, the timeouts are rounded up to it. default 1 msec. call before run().
+  void  set_timer_resolution  (const uint32_t &msec) { timer_.set_resolution(msec); }
+
+  /**
+   * idle policy of the handlers, 0: disabled. (default)
+   * the reactor keeps the last activity of each handler from its events,
+   * no timer is armed per request. a handler gets handle_idle() when
+   *   idle_msec : no input and no output, (IDLE_TIMEOUT)
+   *   read_msec : no input. (IDLE_READ_TIMEOUT)
+   * the acceptors, the ReactorHandler and EventHandler::set_idle_tracking(false) are not checked.
+   * call before run().
+   */
+  void  set_idle_timeout      (const uint32_t &idle_msec, const uint32_t &read_msec = 0)
+  {
+    idle_list_.set_timeout(idle_msec);
+    read_list_.set_timeout(read_msec);
+  }
+
+  // see IoHandleDemuxer::set_peek_on_read. call before run().
+  void  set_peek_on_read      (const bool &value) { demuxer_.set_peek_on_read(value); }
+
+  /**
+   * capacity of the control event ring. (register/remove/timeout from the other threads)
+   * 0: max_clients, at least 1024. call before init().
+   */
+  void  set_ctrl_queue_size   (const size_t &size) { ctrl_queue_size_ = size; }
+
+  // io_uring engine, see IoHandleDemuxer::set_recv_buffers. call before init().
+  void  set_recv_buffers      (const uint32_t &count, const uint32_t &size)
+  { demuxer_.set_recv_buffers(count, size); }
+
+  // default trigger mode of the handlers. (EventHandler::TRIGGER_REACTOR_DEFAULT)
+  void  set_edge_triggered    (const bool &value) { edge_triggered_ = value; }
+  bool  edge_triggered        () const { return edge_triggered_; }
+
+  /**
+   * cpus of the thread running run(), it is pinned at the start of run().
+   * empty: not pinned. (default) call before run(), not changed while running.
+   */
+  void  set_cpu_affinity      (const std::vector<int> &cpus) { cpus_ = cpus; }
+  const std::vector<int> &
+        cpu_affinity          () const { return cpus_; }
+
   void  run ();
   void  stop();
 
+  /**
+   * graceful stop. the handlers get handle_drain() and remove themselves when they are idle.
+   * the reactor stops when no handler is left or after timeout_msec, like stop(). thread-safe.
+   */
+  void  drain(const uint32_t &timeout_msec);
+
+  // thread-safe
   size_t handler_count() const;
 
+  // true: called on the thread running run(). thread-safe
+  bool   in_reactor_thread() const
+  { return thread_id_.load(std::memory_order_relaxed) == std::this_thread::get_id(); }
+
+  // recent dispatch time of a loop with events. (moving average) thread-safe
+  uint32_t loop_latency_usec() const { return loop_latency_usec_.load(std::memory_order_relaxed); }
+
+  // bytes queued to send by the handlers of the reactor, not written yet. (gauge) thread-safe
+  int64_t  queued_bytes     () const { return queued_bytes_.load(std::memory_order_relaxed); }
+  // the handlers report the change of their queued bytes. thread-safe
+  void     add_queued_bytes (const int64_t &bytes) { queued_bytes_.fetch_add(bytes, std::memory_order_relaxed); }
+
   ReactorHandler *reactor_handler();
 
 private:
@@ -57,7 +159,9 @@ private:
   {
     EVENT_TIMEOUT_ADD = IoDemuxer::EVENT_USER,
     EVENT_TIMEOUT_DEL,
-    EVENT_STOP
+    EVENT_STOP,
+    EVENT_DRAIN,
+    EVENT_MIGRATE
   };
 
   bool dispatch                     (const std::vector<IoDemuxer::EventData> &events);
@@ -65,24 +169,115 @@ private:
   void dispatch_demuxer_event_io    (const IoDemuxer::EventData &event);
   void dispatch_demuxer_event_result(const IoDemuxer::EventData &event);
 
+  // trigger mode of the registration, see set_edge_triggered.
+  int32_t register_option(EventHandler *handler);
+
   void run_timeout_handler();
+  // -1: nothing is tracked, or the msec to the next idle check.
+  int32_t run_idle_handler();
+  // the idle checks are coarse, a handler is closed up to this late.
+  enum { IDLE_SWEEP_MSEC = 100 };
   void run_reactor_handler();
   void run_shutdown();
 
+  /**
+   * see Reactors::migrate. thread-safe.
+   * to_index: the index of to in Reactors, for the admission counts.
+   */
+  static bool migrate   (EventHandler *handler, Reactor *to, const size_t &to_index);
+  // EVENT_MIGRATE, the io handle is detached from the demuxer.
+  void    start_migrate (EventHandler *handler);
+  // EVENT_DETACH, the handler is registered on the new reactor.
+  void    finish_migrate(EventHandler *handler);
+  // EVENT_REGISTER_READ of a migrated handler.
+  void    arrive_migrate(EventHandler *handler);
+
+  void    start_drain(const uint32_t &timeout_msec);
+  // -1: not draining, 0: done. (no handler or the deadline)
+  int32_t drain_remaining_msec();
+
 private:
   // 추후 reactor의 오류 메세지등 처리하기 위해 이거 함.
   ReactorHandler        *reactor_handler_         = nullptr;
   ReactorHandlerFactory *reactor_handler_factory_ = nullptr;
 
 private:
-  std::unordered_map<io_handle_t, EventHandler *> handlers_;
-  std::unordered_set<io_handle_t>                 handle_close_call_;
+  // registered handler of an io handle. the interest is kept by the demuxer,
+  // the timer node by the handler itself.
+  struct HandlerSlot
+  {
+    EventHandler  *handler      = nullptr;
+    // handle_close() is called once.
+    bool          close_called  = false;
+    bool          acceptor      = false;
+    // the handler has migrated to, the requests made to this reactor
+    // after it has left are passed on. (writable, timeout, migrate)
+    Reactor       *moved_to     = nullptr;
+  };
+
+  EventHandler *find_handler(const io_handle_t &io_handle)
+  {
+    HandlerSlot *slot = handlers_.find(io_handle);
+    return slot == nullptr ? nullptr : slot->handler;
+  }
+
+  IoHandleTable<HandlerSlot> handlers_;
 
 private:
-  size_t                        handler_count_ = 0;
-  ObjectsTimer<EventHandler *>  timer_;
+  // read by the other threads. (ReactorBalancer)
+  std::atomic<size_t>           handler_count_;
+  std::atomic<uint32_t>         loop_latency_usec_{0};
+  std::atomic<int64_t>          queued_bytes_{0};
+  TimingWheel<EventHandler *>   timer_;
+  std::vector<EventHandler *>   timeouts_;
+
+  // set_idle_timeout. the clock of the loop, read once per wait.
+  IdleList<EventHandler *>      idle_list_;
+  IdleList<EventHandler *>      read_list_;
+  std::vector<EventHandler *>   idles_;
+  int64_t                       now_msec_ = 0;
+
+  void  update_now()
+  {
+    now_msec_ = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+  }
+
+  void  touch_input (EventHandler &handler)
+  {
+    if (handler.idle_tracked_ == false)
+      return;
+
+    if (idle_list_.timeout() > 0) idle_list_.touch(handler.idle_node_, now_msec_);
+    if (read_list_.timeout() > 0) read_list_.touch(handler.read_node_, now_msec_);
+  }
+
+  void  touch_output(EventHandler &handler)
+  {
+    if (handler.idle_tracked_ == true && idle_list_.timeout() > 0)
+      idle_list_.touch(handler.idle_node_, now_msec_);
+  }
+
+  void  untrack     (EventHandler &handler)
+  {
+    handler.idle_tracked_ = false;
+    idle_list_.remove(handler.idle_node_);
+    read_list_.remove(handler.read_node_);
+  }
   IoDemuxer                     demuxer_;
   std::atomic<bool>             stop_;
+  // the thread running run(), see in_reactor_thread.
+  std::atomic<std::thread::id>  thread_id_{std::thread::id()};
+  bool                          edge_triggered_ = false;
+  bool                          initialized_    = false;
+  size_t                        max_events_     = 100;
+  size_t                        ctrl_queue_size_= 0;
+  std::vector<int>              cpus_;
+
+  bool                                  draining_ = false;
+  std::chrono::steady_clock::time_point drain_deadline_;
+
+  friend class Reactors;
 };
 
 inline
@@ -92,16 +287,46 @@ Reactor::Reactor()
 inline bool
 Reactor::init(int32_t max_clients,
               size_t  max_events,
-              ReactorHandlerFactory *factory)
+              ReactorHandlerFactory *factory,
+              const IoDemuxer::ENGINE &engine)
 {
   handler_count_ = 0;
+  loop_latency_usec_ = 0;
   stop_ = false;
 
   reactor_handler_factory_ = factory;
   if (reactor_handler_factory_ != nullptr)
     ++max_clients;
 
-  return demuxer_.init(max_clients, max_events);
+  handlers_.clear();
+  if (handlers_.reserve(max_clients) == false)
+    return false;
+
+  max_events_ = max_events > 0 ? max_events : 1;
+
+  size_t ctrl_queue_size = ctrl_queue_size_;
+  if (ctrl_queue_size == 0)
+    ctrl_queue_size = max_clients > 1024 ? max_clients : 1024;
+
+  initialized_ = demuxer_.init(max_clients, max_events_, ctrl_queue_size, engine);
+  return initialized_;
+}
+
+inline int32_t
+Reactor::register_option(EventHandler *handler)
+{
+  switch (handler->trigger_mode_)
+  {
+    case EventHandler::TRIGGER_LEVEL: handler->edge_triggered_ = false; break;
+    case EventHandler::TRIGGER_EDGE : handler->edge_triggered_ = true;  break;
+    default: handler->edge_triggered_ = edge_triggered_; break;
+  }
+
+  int32_t option = IoDemuxer::OPTION_NONE;
+  if (handler->edge_triggered_  == true) option |= IoDemuxer::OPTION_EDGE_TRIGGERED;
+  if (handler->recv_completion_ == true) option |= IoDemuxer::OPTION_RECV_COMPLETION;
+
+  return option;
 }
 
 inline bool
@@ -110,7 +335,54 @@ Reactor::register_event_handler(EventHandler *handler, const io_handle_t &io_han
   if (stop_.load() == true)
     return false;
 
-  return demuxer_.register_read_event(io_handle, handler, true);
+  return demuxer_.register_read_event(io_handle, handler, true, register_option(handler));
+}
+
+inline bool
+Reactor::register_event_handlers(EventHandler *const *handlers, const size_t &count)
+{
+  if (stop_.load() == true)
+    return false;
+
+  return demuxer_.register_read_events(count,
+                                       [&](const size_t  &index,
+                                           io_handle_t   &io_handle,
+                                           EventHandler *&user_data,
+                                           int32_t       &option)
+                                       {
+                                         user_data = handlers[index];
+                                         io_handle = user_data->io_handle_;
+                                         option    = register_option(user_data);
+                                       },
+                                       true);
+}
+
+inline bool
+Reactor::register_acceptor(EventHandler *handler, const io_handle_t &io_handle)
+{
+  if (stop_.load() == true)
+    return false;
+
+  handler->edge_triggered_ = false;
+  return demuxer_.register_accept_event(io_handle, handler, true);
+}
+
+inline bool
+Reactor::pause_acceptor(EventHandler *handler)
+{
+  if (stop_.load() == true)
+    return false;
+
+  return demuxer_.remove_read_event(handler->io_handle_, nullptr, false);
+}
+
+inline bool
+Reactor::resume_acceptor(EventHandler *handler)
+{
+  if (stop_.load() == true)
+    return false;
+
+  return demuxer_.register_accept_event(handler->io_handle_, handler, false);
 }
 
 inline bool
@@ -128,8 +400,51 @@ Reactor::register_writable(EventHandler *handler)
   if (stop_.load() == true)
     return false;
 
+  // the handler is taken from the read registration. a late call after
+  // remove_event_handler creates no slot with the handler.
   return demuxer_.register_write_event(handler->io_handle_,
-                                       handler,
+                                       nullptr,
+                                       false);
+}
+
+inline bool
+Reactor::register_writables(EventHandler *const *handlers, const size_t &count)
+{
+  if (stop_.load() == true)
+    return false;
+
+  return demuxer_.register_write_events(count,
+                                        [&](const size_t  &index,
+                                            io_handle_t   &io_handle,
+                                            EventHandler *&user_data,
+                                            int32_t       &option)
+                                        {
+                                          (void)user_data; (void)option;
+                                          io_handle = handlers[index]->io_handle_;
+                                        },
+                                        false);
+}
+
+inline bool
+Reactor::wait_writable(EventHandler *handler)
+{
+  if (stop_.load() == true)
+    return false;
+
+  return demuxer_.register_write_event(handler->io_handle_,
+                                       nullptr,
+                                       false,
+                                       IoDemuxer::OPTION_WAIT_EDGE);
+}
+
+inline bool
+Reactor::register_error_event(EventHandler *handler)
+{
+  if (stop_.load() == true)
+    return false;
+
+  return demuxer_.register_error_event(handler->io_handle_,
+                                       nullptr,
                                        false);
 }
 
@@ -155,13 +470,30 @@ Reactor::unset_timeout(EventHandler *handler)
                                    handler->io_handle_);
 }
 
+inline bool
+Reactor::migrate(EventHandler *handler, Reactor *to, const size_t &to_index)
+{
+  Reactor *from = handler->reactor_;
+  if (from == nullptr || from->stop_.load() == true || to == nullptr || to == from)
+    return false;
+
+  // one move at a time.
+  Reactor *expected = nullptr;
+  if (handler->migrate_to_.compare_exchange_strong(expected, to) == false)
+    return false;
+
+  handler->migrate_index_ = to_index;
+  return from->demuxer_.raise_user_event(EVENT_MIGRATE, handler->io_handle_, handler);
+}
+
 inline size_t
 Reactor::handler_count() const
 {
-  if (reactor_handler_ == nullptr)
-    return handler_count_;
+  size_t count = handler_count_.load(std::memory_order_relaxed);
+  if (reactor_handler_ == nullptr || count == 0)
+    return count;
 
-  return handler_count_ - 1;
+  return count - 1;
 }
 
 inline ReactorHandler *
@@ -176,15 +508,24 @@ Reactor::stop()
   demuxer_.raise_user_event(EVENT_STOP);
 }
 
+inline void
+Reactor::drain(const uint32_t &timeout_msec)
+{
+  demuxer_.raise_user_event(EVENT_DRAIN, INVALID_IO_HANDLE, (EventHandler *)((uint64_t)timeout_msec));
+}
+
 inline bool
 Reactor::dispatch(const std::vector<IoDemuxer::EventData> &events)
 {
   bool is_stop_event = false;
   for (const IoDemuxer::EventData &event : events)
   {
-    dispatch_reactor_event       (event, is_stop_event);
-    dispatch_demuxer_event_io    (event);
-    dispatch_demuxer_event_result(event);
+    if (event.recv_event <= IoDemuxer::EVENT_ACCEPT)
+      dispatch_demuxer_event_io    (event);
+    else if (event.recv_event < IoDemuxer::EVENT_USER)
+      dispatch_demuxer_event_result(event);
+    else
+      dispatch_reactor_event       (event, is_stop_event);
   }
 
   return is_stop_event;
@@ -193,12 +534,43 @@ Reactor::dispatch(const std::vector<IoDemuxer::EventData> &events)
 inline void
 Reactor::run_timeout_handler()
 {
-  std::deque<std::unordered_set<EventHandler *>> objects =
-      timer_.extract_timeout_objects();
+  timeouts_.clear();
+  timer_.extract_timeout_objects(timeouts_);
+
+  // removing is deferred to the demuxer, the handlers are alive in this batch.
+  for (EventHandler *handler : timeouts_)
+    handler->handle_timeout();
+}
+
+inline int32_t
+Reactor::run_idle_handler()
+{
+  if (idle_list_.size() == 0 && read_list_.size() == 0)
+    return -1;
+
+  idles_.clear();
+  size_t idle_count = 0;
+  if (idle_list_.timeout() > 0)
+    idle_count = idle_list_.extract_timeout_objects(now_msec_, idles_);
+  if (read_list_.timeout() > 0)
+    read_list_.extract_timeout_objects(now_msec_, idles_);
+
+  // removing is deferred to the demuxer, the handlers are alive in this batch.
+  for (size_t index = 0; index < idles_.size(); ++index)
+    idles_[index]->handle_idle(index < idle_count ? EventHandler::IDLE_TIMEOUT
+                                                  : EventHandler::IDLE_READ_TIMEOUT);
+
+  int32_t idle_timeout = idle_list_.timeout() > 0 ? idle_list_.get_min_timeout_milliseconds(now_msec_) : -1;
+  int32_t read_timeout = read_list_.timeout() > 0 ? read_list_.get_min_timeout_milliseconds(now_msec_) : -1;
 
-  for (std::unordered_set<EventHandler *> handlers : objects)
-    for (EventHandler *handler : handlers)
-      handler->handle_timeout();
+  int32_t timeout = idle_timeout < 0 ? read_timeout
+                  : read_timeout < 0 ? idle_timeout
+                  : std::min(idle_timeout, read_timeout);
+
+  if (timeout >= 0 && timeout < IDLE_SWEEP_MSEC)
+    timeout = IDLE_SWEEP_MSEC;
+
+  return timeout;
 }
 
 inline void
@@ -228,12 +600,16 @@ Reactor::run_reactor_handler()
 inline void
 Reactor::run_shutdown()
 {
-  for (std::pair<const io_handle_t, EventHandler *> &item : handlers_)
+  handlers_.for_each([&](const io_handle_t &, HandlerSlot &slot)
   {
-    timer_.remove_timeout(item.second);
-    item.second->handle_shutdown();
-    demuxer_.remove_all_events(item.second->io_handle_, nullptr, false);
-  }
+    if (slot.handler == nullptr)
+      return;
+
+    timer_.remove_timeout(slot.handler->timer_node_);
+    untrack(*slot.handler);
+    slot.handler->handle_shutdown();
+    demuxer_.remove_all_events(slot.handler->io_handle_, nullptr, false);
+  });
 
   if (reactor_handler_          != nullptr &&
       reactor_handler_factory_  != nullptr)
@@ -0,0 +1,238 @@
+/*
+ * ReactorBalancer.h
+ *
+ *  Created on: 2026. 10. 17.
+ *      Author: tys
+ */
+
+#ifndef IO_REACTOR_REACTOR_REACTORBALANCER_H_
+#define IO_REACTOR_REACTOR_REACTORBALANCER_H_
+
+#include <reactor/Reactor.h>
+#include <reactor/CpuAffinity.h>
+
+#include <algorithm>
+#include <atomic>
+#include <vector>
+
+#include <sys/socket.h>
+#include <netinet/in.h>
+
+namespace reactor
+{
+
+/**
+ * selects the reactor of a new connection. (Reactors::set_balancer)
+ * called by the acceptor threads concurrently, select() must be thread-safe.
+ * reactors is not empty. io_handle is the accepted socket, INVALID_IO_HANDLE
+ * and addr nullptr if unknown.
+ */
+class ReactorBalancer
+{
+public:
+  virtual ~ReactorBalancer() {}
+  virtual size_t select(const std::vector<Reactor *> &reactors,
+                        const io_handle_t            &io_handle,
+                        const sockaddr_storage       *addr) = 0;
+};
+
+class RoundRobinBalancer : public ReactorBalancer
+{
+public:
+  size_t select(const std::vector<Reactor *> &reactors, const io_handle_t &, const sockaddr_storage *) override
+  {
+    return index_.fetch_add(1, std::memory_order_relaxed) % reactors.size();
+  }
+
+private:
+  std::atomic<size_t> index_{0};
+};
+
+/**
+ * fewest registered handlers. (Reactor::handler_count)
+ * the scan starts at a rotating index, so a burst of accepts is spread
+ * over the reactors of the same count before their registrations are counted.
+ */
+class LeastConnectionsBalancer : public ReactorBalancer
+{
+public:
+  size_t select(const std::vector<Reactor *> &reactors, const io_handle_t &, const sockaddr_storage *) override
+  {
+    size_t size  = reactors.size();
+    size_t start = index_.fetch_add(1, std::memory_order_relaxed) % size;
+    size_t found = start;
+    size_t min   = reactors[start]->handler_count();
+
+    for (size_t count = 1; count < size && min > 0; ++count)
+    {
+      size_t index = (start + count) % size;
+      size_t value = reactors[index]->handler_count();
+      if (value < min)
+      {
+        min   = value;
+        found = index;
+      }
+    }
+
+    return found;
+  }
+
+private:
+  std::atomic<size_t> index_{0};
+};
+
+/**
+ * power of two choices. two random reactors, the one with fewer handlers.
+ * O(1), and it does not herd on the same reactor like least connections.
+ */
+class PowerOfTwoBalancer : public ReactorBalancer
+{
+public:
+  size_t select(const std::vector<Reactor *> &reactors, const io_handle_t &, const sockaddr_storage *) override
+  {
+    size_t size = reactors.size();
+    if (size == 1)
+      return 0;
+
+    uint64_t value = next_random();
+    size_t first  = value % size;
+    size_t second = (first + 1 + (value >> 32) % (size - 1)) % size;
+
+    return reactors[second]->handler_count() < reactors[first]->handler_count() ? second : first;
+  }
+
+private:
+  // xorshift64*, per thread.
+  static uint64_t next_random()
+  {
+    static std::atomic<uint64_t> seed{0x9E3779B97F4A7C15ULL};
+    thread_local uint64_t state = seed.fetch_add(0x9E3779B97F4A7C15ULL, std::memory_order_relaxed) | 1;
+
+    state ^= state >> 12;
+    state ^= state << 25;
+    state ^= state >> 27;
+    return state * 0x2545F4914F6CDD1DULL;
+  }
+};
+
+/**
+ * the shortest recent dispatch time of a loop. (Reactor::loop_latency_usec)
+ * ties go to the fewer handlers.
+ */
+class LeastLatencyBalancer : public ReactorBalancer
+{
+public:
+  size_t select(const std::vector<Reactor *> &reactors, const io_handle_t &, const sockaddr_storage *) override
+  {
+    size_t size  = reactors.size();
+    size_t start = index_.fetch_add(1, std::memory_order_relaxed) % size;
+    size_t found = start;
+
+    uint32_t min_latency = reactors[start]->loop_latency_usec();
+    size_t   min_count   = reactors[start]->handler_count();
+
+    for (size_t count = 1; count < size; ++count)
+    {
+      size_t   index   = (start + count) % size;
+      uint32_t latency = reactors[index]->loop_latency_usec();
+      size_t   handlers= reactors[index]->handler_count();
+
+      if (latency < min_latency || (latency == min_latency && handlers < min_count))
+      {
+        min_latency = latency;
+        min_count   = handlers;
+        found       = index;
+      }
+    }
+
+    return found;
+  }
+
+private:
+  std::atomic<size_t> index_{0};
+};
+
+/**
+ * hash of the peer ip address, the same client goes to the same reactor.
+ * the port is not hashed. round robin if the peer is unknown or not ip.
+ */
+class PeerHashBalancer : public ReactorBalancer
+{
+public:
+  size_t select(const std::vector<Reactor *> &reactors, const io_handle_t &io_handle, const sockaddr_storage *addr) override
+  {
+    const uint8_t *data = nullptr;
+    size_t        size  = 0;
+
+    if (addr != nullptr && addr->ss_family == AF_INET)
+    {
+      data = (const uint8_t *)&((const sockaddr_in *)addr)->sin_addr;
+      size = sizeof(in_addr);
+    }
+    else if (addr != nullptr && addr->ss_family == AF_INET6)
+    {
+      data = (const uint8_t *)&((const sockaddr_in6 *)addr)->sin6_addr;
+      size = sizeof(in6_addr);
+    }
+
+    if (data == nullptr)
+      return round_robin_.select(reactors, io_handle, addr);
+
+    // FNV-1a
+    uint64_t hash = 0xCBF29CE484222325ULL;
+    for (size_t index = 0; index < size; ++index)
+    {
+      hash ^= data[index];
+      hash *= 0x100000001B3ULL;
+    }
+
+    // the low bits of FNV follow the last byte, mix them. (murmur3 finalizer)
+    hash ^= hash >> 33;
+    hash *= 0xFF51AFD7ED558CCDULL;
+    hash ^= hash >> 33;
+
+    return hash % reactors.size();
+  }
+
+private:
+  RoundRobinBalancer round_robin_;
+};
+
+/**
+ * the reactor pinned on the cpu that received the packets of the connection. (SO_INCOMING_CPU)
+ * with the rx queues of the nic steered to the cpus of the reactors (RSS/RPS, irq affinity),
+ * a connection is served on the cpu, and the numa node, its packets arrive.
+ * the fallback (not owned, nullptr: round robin) if the cpu is unknown or no reactor is pinned on it.
+ * see Reactor::set_cpu_affinity.
+ */
+class IncomingCpuBalancer : public ReactorBalancer
+{
+public:
+  IncomingCpuBalancer(ReactorBalancer *fallback = nullptr)
+  : fallback_(fallback != nullptr ? fallback : &round_robin_) {}
+
+  size_t select(const std::vector<Reactor *> &reactors, const io_handle_t &io_handle, const sockaddr_storage *addr) override
+  {
+    int cpu = io_handle >= 0 ? CpuAffinity::incoming_cpu(io_handle) : -1;
+    if (cpu < 0)
+      return fallback_->select(reactors, io_handle, addr);
+
+    // the affinity is not changed while running.
+    for (size_t index = 0; index < reactors.size(); ++index)
+    {
+      const std::vector<int> &cpus = reactors[index]->cpu_affinity();
+      if (std::find(cpus.begin(), cpus.end(), cpu) != cpus.end())
+        return index;
+    }
+
+    return fallback_->select(reactors, io_handle, addr);
+  }
+
+private:
+  RoundRobinBalancer  round_robin_;
+  ReactorBalancer     *fallback_;
+};
+
+}
+
+#endif /* IO_REACTOR_REACTOR_REACTORBALANCER_H_ */
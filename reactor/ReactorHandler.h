@@ -23,7 +23,8 @@ class Reactor;
 class ReactorHandler : public EventHandler
 {
 public:
-  ReactorHandler() {}
+  // the pipe is read once per event.
+  ReactorHandler() { set_trigger_mode(TRIGGER_LEVEL); }
 
 protected:
   virtual void reactor_handle_registered() = 0;
@@ -27,23 +27,39 @@ public:
       delete thread_;
   }
 
-  void start(int32_t max_clients = 1024,
-             size_t  max_events  = 10240,
-             ReactorHandlerFactory *factory = nullptr)
+  // keeps the configuration of reactor.init() if it is already initialized.
+  void start()
   {
-    reactor.init(max_clients, max_events, factory);
+    if (reactor.initialized() == false)
+      reactor.init(1024, 10240);
 
-    thread_ = new std::thread{&ReactorThread::run, this};
-    std::unique_lock<std::mutex> lock(condition_lock_);
-    if (is_run_ == true)
-      return;
+    run_thread();
+  }
 
-    condition_.wait(lock);
+  void start(int32_t max_clients,
+             size_t  max_events  = 10240,
+             ReactorHandlerFactory *factory = nullptr,
+             const Reactor::IoDemuxer::ENGINE &engine = Reactor::IoDemuxer::ENGINE_EPOLL)
+  {
+    reactor.init(max_clients, max_events, factory, engine);
+    run_thread();
   }
 
   void stop()
   {
     reactor.stop();
+    join();
+  }
+
+  // see Reactor::drain. returns when the reactor is stopped.
+  void drain(const uint32_t &timeout_msec)
+  {
+    reactor.drain(timeout_msec);
+    join();
+  }
+
+  void join()
+  {
     if (thread_ == nullptr)
       return;
 
@@ -58,6 +74,16 @@ public:
   }
 
 protected:
+  void run_thread()
+  {
+    thread_ = new std::thread{&ReactorThread::run, this};
+    std::unique_lock<std::mutex> lock(condition_lock_);
+    if (is_run_ == true)
+      return;
+
+    condition_.wait(lock);
+  }
+
   void run()
   {
     {
@@ -12,29 +12,67 @@ bool
 Reactors::init(const size_t           &thread_num,
                const size_t           &max_clients_per_reactor,
                const size_t           &max_events_per_reactor,
-               ReactorHandlerFactory  *factory)
+               ReactorHandlerFactory  *factory,
+               const Reactor::IoDemuxer::ENGINE &engine)
 {
+  bool result = true;
   for (size_t index = 0; index < thread_num; ++index)
   {
     ReactorThread  *reactor_thread  = new ReactorThread;
-    reactor_thread->reactor.init(max_clients_per_reactor,
-                                 max_events_per_reactor,
-                                 factory);
+    reactor_thread->reactor.set_ctrl_queue_size(ctrl_queue_size_);
+    reactor_thread->reactor.set_recv_buffers(recv_buffer_count_, recv_buffer_size_);
+    reactor_thread->reactor.set_idle_timeout(idle_timeout_msec_, read_timeout_msec_);
+    reactor_thread->reactor.set_edge_triggered(edge_triggered_);
+    reactor_thread->reactor.set_peek_on_read(peek_on_read_);
+    if (timer_resolution_msec_ > 0)
+      reactor_thread->reactor.set_timer_resolution(timer_resolution_msec_);
+
+    auto init = [&]()
+    {
+      return reactor_thread->reactor.init(max_clients_per_reactor,
+                                          max_events_per_reactor,
+                                          factory,
+                                          engine);
+    };
+
+    if (cpus_.size() == 0)
+    {
+      if (init() == false)
+        result = false;
+    }
+    else
+    {
+      // the pages are placed on the numa node of the thread touching them first.
+      const std::vector<int> &cpus = cpus_[index % cpus_.size()];
+      reactor_thread->reactor.set_cpu_affinity(cpus);
+
+      bool initialized = false;
+      std::thread thread([&]()
+      {
+        CpuAffinity::set_current_thread(cpus);
+        initialized = init();
+      });
+      thread.join();
+
+      if (initialized == false)
+        result = false;
+    }
 
     reactor_threads_.push_back(reactor_thread);
     reactors_       .push_back(&reactor_thread->reactor);
   }
 
-  return true;
+  return result;
 }
 
 bool
 Reactors::init(const size_t           &thread_num,
                ReactorHandlerFactory  *factory,
                const size_t           &max_clients_per_reactor,
-               const size_t           &max_events_per_reactor)
+               const size_t           &max_events_per_reactor,
+               const Reactor::IoDemuxer::ENGINE &engine)
 {
-  return this->init(thread_num, max_clients_per_reactor, max_events_per_reactor, factory);
+  return this->init(thread_num, max_clients_per_reactor, max_events_per_reactor, factory, engine);
 }
 
 bool
@@ -53,6 +91,16 @@ Reactors::stop()
     reactor_thread->stop();
 }
 
+void
+Reactors::drain(const uint32_t &timeout_msec)
+{
+  for (ReactorThread *reactor_thread : reactor_threads_)
+    reactor_thread->reactor.drain(timeout_msec);
+
+  for (ReactorThread *reactor_thread : reactor_threads_)
+    reactor_thread->join();
+}
+
 size_t
 Reactors::handler_count() const
 {
@@ -64,3 +112,14 @@ Reactors::handler_count() const
   return count;
 }
 
+int64_t
+Reactors::queued_bytes() const
+{
+  int64_t bytes = 0;
+
+  for (Reactor *reactor : reactors_)
+    bytes += reactor->queued_bytes();
+
+  return bytes;
+}
+
@@ -10,6 +10,7 @@
 
 #include <reactor/ReactorHandlerFactory.h>
 #include <reactor/ReactorThread.h>
+#include <reactor/ReactorBalancer.h>
 
 #include <mutex>
 #include <condition_variable>
@@ -24,27 +25,145 @@ public:
   bool      init  (const size_t           &thread_num,
                    const size_t           &max_clients_per_reactor = 1000,
                    const size_t           &max_events_per_reactor  = 100,
-                   ReactorHandlerFactory  *factory = nullptr);
+                   ReactorHandlerFactory  *factory = nullptr,
+                   const Reactor::IoDemuxer::ENGINE &engine = Reactor::IoDemuxer::ENGINE_EPOLL);
 
   bool      init  (const size_t           &thread_num,
                    ReactorHandlerFactory  *factory,
                    const size_t           &max_clients_per_reactor = 1000,
-                   const size_t           &max_events_per_reactor  = 100);
+                   const size_t           &max_events_per_reactor  = 100,
+                   const Reactor::IoDemuxer::ENGINE &engine = Reactor::IoDemuxer::ENGINE_EPOLL);
 
   bool      start ();
   void      stop  ();
+  // see Reactor::drain. the reactors drain at once, returns when all of them are stopped.
+  void      drain (const uint32_t &timeout_msec);
   size_t    handler_count() const;
+  // see Reactor::queued_bytes, the sum of the reactors.
+  int64_t   queued_bytes () const;
+
+  // compatibility option, see IoHandleDemuxer::set_peek_on_read. call before start().
+  void      set_peek_on_read(const bool &value)
+  {
+    peek_on_read_ = value;
+    for (Reactor *reactor : reactors_)
+      reactor->set_peek_on_read(value);
+  }
+
+  // see Reactor::set_ctrl_queue_size. call before init().
+  void      set_ctrl_queue_size(const size_t &size) { ctrl_queue_size_ = size; }
+
+  // io_uring engine, see IoHandleDemuxer::set_recv_buffers. call before init().
+  void      set_recv_buffers(const uint32_t &count, const uint32_t &size)
+  {
+    recv_buffer_count_ = count;
+    recv_buffer_size_  = size;
+  }
+
+  // the options below are kept for the reactors of init(). call before start().
+
+  // see Reactor::set_timer_resolution.
+  void      set_timer_resolution(const uint32_t &msec)
+  {
+    timer_resolution_msec_ = msec;
+    for (Reactor *reactor : reactors_)
+      reactor->set_timer_resolution(msec);
+  }
+
+  // see Reactor::set_idle_timeout.
+  void      set_idle_timeout(const uint32_t &idle_msec, const uint32_t &read_msec = 0)
+  {
+    idle_timeout_msec_ = idle_msec;
+    read_timeout_msec_ = read_msec;
+    for (Reactor *reactor : reactors_)
+      reactor->set_idle_timeout(idle_msec, read_msec);
+  }
+
+  // default trigger mode of the handlers, see Reactor::set_edge_triggered.
+  void      set_edge_triggered(const bool &value)
+  {
+    edge_triggered_ = value;
+    for (Reactor *reactor : reactors_)
+      reactor->set_edge_triggered(value);
+  }
 
   const std::vector<Reactor *> &
             get_reactors() { return reactors_; }
 
-  // round robin
-  Reactor*  get_reactor () { return reactors_[selector_index_++ % reactors_.size()]; }
+  /**
+   * reactor selection of the new connections. nullptr: round robin. (default)
+   * the balancer is not owned. call before start().
+   */
+  void      set_balancer(ReactorBalancer *balancer)
+  { balancer_ = balancer != nullptr ? balancer : &round_robin_; }
+
+  // index of the selected reactor. thread-safe.
+  size_t    select_reactor(const io_handle_t      &io_handle = INVALID_IO_HANDLE,
+                           const sockaddr_storage *addr      = nullptr)
+  { return balancer_->select(reactors_, io_handle, addr); }
+
+  /**
+   * moves a registered handler to reactor_index, the connection is not closed.
+   * (TCPEventHandler, SSLEventHandler. not the acceptors)
+   * the handler is served on its reactor until it is detached, then it gets
+   * handle_migrated() on the new one. no close/removed/registered callback is raised.
+   * the timer and the queued output go with it, the idle time starts again.
+   * false: not registered, moving already, or the same reactor.
+   * it is not moved if it is closed or the new reactor stops meanwhile. thread-safe.
+   */
+  bool      migrate     (EventHandler *handler, const size_t &reactor_index)
+  {
+    if (handler == nullptr || reactor_index >= reactors_.size())
+      return false;
+
+    return Reactor::migrate(handler, reactors_[reactor_index], reactor_index);
+  }
+
+  // index of reactor, -1: not one of them.
+  int32_t   reactor_index(const Reactor *reactor) const
+  {
+    for (size_t index = 0; index < reactors_.size(); ++index)
+      if (reactors_[index] == reactor)
+        return (int32_t)index;
+
+    return -1;
+  }
+
+  Reactor*  get_reactor () { return reactors_[select_reactor()]; }
+  Reactor*  get_reactor (const sockaddr_storage &addr) { return reactors_[select_reactor(INVALID_IO_HANDLE, &addr)]; }
+  Reactor*  get_reactor (const io_handle_t &io_handle, const sockaddr_storage &addr)
+  { return reactors_[select_reactor(io_handle, &addr)]; }
+
+  /**
+   * cpus of each reactor thread, reactor i is pinned on cpus[i % cpus.size()].
+   * the reactor is initialized on a thread pinned on the same cpus, so its tables
+   * and event buffers are placed on the local numa node. (first touch)
+   * see CpuAffinity::numa_node_cpus. call before init().
+   */
+  void      set_cpu_affinity(const std::vector<std::vector<int>> &cpus) { cpus_ = cpus; }
+
+  // a cpu per reactor, reactor i is pinned on cpus[i % cpus.size()]. call before init().
+  void      set_cpu_list    (const std::vector<int> &cpus)
+  {
+    cpus_.clear();
+    for (const int &cpu : cpus)
+      cpus_.push_back(std::vector<int>{cpu});
+  }
 
 private:
-  size_t                        selector_index_ = 0;
+  RoundRobinBalancer            round_robin_;
+  ReactorBalancer               *balancer_ = &round_robin_;
   std::vector<ReactorThread *>  reactor_threads_;
   std::vector<Reactor *>        reactors_;
+  std::vector<std::vector<int>> cpus_;
+  size_t                        ctrl_queue_size_   = 0;
+  uint32_t                      recv_buffer_count_ = 256;
+  uint32_t                      recv_buffer_size_  = 4096;
+  uint32_t                      timer_resolution_msec_ = 0;   // 0: the reactor default
+  uint32_t                      idle_timeout_msec_     = 0;
+  uint32_t                      read_timeout_msec_     = 0;
+  bool                          edge_triggered_        = false;
+  bool                          peek_on_read_          = false;
 
 private:
   std::condition_variable condition_;
@@ -0,0 +1,478 @@
+/*
+ * SendQueue.h
+ *
+ *  Created on: 2026. 10. 17.
+ *      Author: tys
+ */
+
+#ifndef IO_REACTOR_REACTOR_SENDQUEUE_H_
+#define IO_REACTOR_REACTOR_SENDQUEUE_H_
+
+#include <deque>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+
+namespace reactor
+{
+
+/**
+ * output of a connection, a chain of segments written by writev.
+ * a segment is a send() of a stream id. the small ones are copied into a chunk shared
+ * by the segments, the others are moved in or shared (refcounted) without a copy.
+ * a partial write advances the cursor of the head segment, no memory is moved.
+ *
+ * MSG_ZEROCOPY: the segments of their own buffer over zerocopy_size are written
+ * by a call of their own. a segment written so is kept until the kernel completes it,
+ * (complete_zerocopy) the segments after it wait for it, handle_sent keeps the order.
+ *
+ * file: a region of a regular file is a segment of its own, written by sendfile()
+ * from the kernel page cache. the segments before it are written first, the order is kept.
+ * not thread-safe.
+ */
+class SendQueue
+{
+public:
+  using Bytes     = std::vector<uint8_t>;
+  using BytesPtr  = std::shared_ptr<const Bytes>;
+
+  /**
+   * an open file, the fd is closed with the last reference.
+   * the regular files only are sent: sendfile() of a pipe or a device may have nothing
+   * to read while the socket is writable, the reactor would wait on the socket for it.
+   */
+  class File
+  {
+  public:
+    File(const int &fd) : fd_(fd)
+    {
+      struct stat st;
+      regular_ = ::fstat(fd_, &st) == 0 && S_ISREG(st.st_mode);
+    }
+    ~File() { if (fd_ >= 0) ::close(fd_); }
+
+    File(const File &) = delete;
+    File &operator=(const File &) = delete;
+
+    // O_RDONLY | O_NONBLOCK, nullptr: errno is set. any type, see regular().
+    static std::shared_ptr<const File> open(const std::string &path);
+
+    const int  &fd     () const { return fd_; }
+    // S_ISREG, the others are refused by send.
+    const bool &regular() const { return regular_; }
+    // size of the file, -1: error. (fstat)
+    int64_t     size() const;
+    // length bytes at offset are appended to data, false: errno is set. (TLS, no sendfile)
+    bool        read(const size_t &offset, const size_t &length, std::string &data) const;
+
+  private:
+    int   fd_       = -1;
+    bool  regular_  = false;
+  };
+  using FilePtr   = std::shared_ptr<const File>;
+
+  enum
+  {
+    MAX_IOV         = IOV_MAX,
+    // push(data, size) up to COPY_SIZE is copied into the chunk, the others get their own buffer.
+    COPY_SIZE       = 4096,
+    // the next chunk is started over CHUNK_CAPACITY.
+    CHUNK_CAPACITY  = 65536
+  };
+
+  struct Segment
+  {
+    int32_t   stream_id = -1;
+    BytesPtr  buffer;
+    size_t    begin     = 0;
+    size_t    length    = 0;
+    // the cursor, bytes of the segment written.
+    size_t    sent      = 0;
+    // a part of a chunk, it is reused. (not for MSG_ZEROCOPY)
+    bool      chunk     = false;
+    // written by the MSG_ZEROCOPY call of zerocopy_seq, not completed yet.
+    bool      zerocopy      = false;
+    uint32_t  zerocopy_seq  = 0;
+    // a region of the file from begin, buffer is nullptr.
+    FilePtr   file;
+    // a part of a send, the last part reports it. (handle_sent once)
+    bool      part      = false;
+
+    // nullptr: a region of a file.
+    const uint8_t *data() const { return buffer != nullptr ? buffer->data() + begin : nullptr; }
+  };
+
+  void push(const int32_t &stream_id, const void *data, const size_t &size);
+  void push(const int32_t &stream_id, Bytes &&data);
+  void push(const int32_t &stream_id, const BytesPtr &data);
+  // head (e.g. the http header) and the region of file, a send of stream_id.
+  void push(const int32_t &stream_id,
+            const void    *head, const size_t &head_size,
+            const FilePtr &file, const size_t &offset, const size_t &length);
+
+  // nothing to write, the segments waiting for the zerocopy completion are not counted.
+  bool    empty () const { return segments_.empty(); }
+  // bytes not written yet.
+  size_t  bytes () const { return bytes_; }
+  // the segments written, waiting for the zerocopy completion.
+  bool    zerocopy_pending() const { return pending_.size() > 0; }
+
+  /**
+   * the bytes to write from the cursor, up to max entries.
+   * the adjacent segments of a chunk are merged into an entry. returns the count.
+   * zerocopy_size: stops at a segment of zerocopy_iovecs.
+   */
+  int     iovecs(struct iovec *iov, const int &max, const size_t &zerocopy_size = 0) const;
+  // the segments from the head to write by MSG_ZEROCOPY, 0: the head is not.
+  int     zerocopy_iovecs(struct iovec *iov, const int &max, const size_t &zerocopy_size) const;
+  // the head to write by sendfile(), nullptr: it is not a file.
+  const Segment *
+          file_segment() const
+  { return segments_.size() > 0 && segments_.front().file != nullptr ? &segments_.front() : nullptr; }
+
+  /**
+   * size bytes were written. on_sent(const Segment &) for each segment completed.
+   * zerocopy_seq: the id of the MSG_ZEROCOPY call, -1: copied.
+   */
+  template<typename ON_SENT>
+  void    consume(size_t size, ON_SENT on_sent, const int64_t &zerocopy_seq = -1);
+
+  // the kernel completed the MSG_ZEROCOPY calls of [first, last].
+  template<typename ON_SENT>
+  void    complete_zerocopy(const uint32_t &first, const uint32_t &last, ON_SENT on_sent);
+
+  // on_drop(const Segment &) for each segment left, the pending ones too.
+  template<typename ON_DROP>
+  void    clear (ON_DROP on_drop);
+  void    clear () { clear([](const Segment &) {}); }
+
+  // the chunk is allocated by the caller. (the numa node of the reactor thread)
+  void    reserve(const size_t &capacity);
+  // the chunk over capacity is freed. (pooled handler)
+  void    shrink (const size_t &capacity);
+
+  // the segments to write, the pending ones stay.
+  void    swap  (SendQueue &other)
+  {
+    segments_.swap(other.segments_);
+    chunk_   .swap(other.chunk_);
+    std::swap(bytes_, other.bytes_);
+
+    // the pending segments refer the chunk, the other starts a new one.
+    if (other.chunk_ != nullptr && other.chunk_.use_count() > 1)
+      other.chunk_.reset();
+  }
+
+private:
+  void    push  (Segment &&segment)
+  {
+    bytes_ += segment.length;
+    segments_.push_back(std::move(segment));
+  }
+
+  bool    zerocopy_segment(const Segment &segment, const size_t &zerocopy_size) const
+  {
+    return segment.chunk == false && segment.file == nullptr &&
+           segment.length - segment.sent >= zerocopy_size;
+  }
+
+  template<typename ON_SENT>
+  void    release_pending (ON_SENT on_sent);
+
+private:
+  std::deque<Segment>     segments_;
+  std::deque<Segment>     pending_;
+  std::shared_ptr<Bytes>  chunk_;
+  size_t                  bytes_ = 0;
+};
+
+inline void
+SendQueue::push(const int32_t &stream_id, const void *data, const size_t &size)
+{
+  if (size > COPY_SIZE)
+  {
+    push(stream_id, Bytes((const uint8_t *)data, (const uint8_t *)data + size));
+    return;
+  }
+
+  // the segments keep the full chunk, a new one is started.
+  if (chunk_ == nullptr || chunk_->size() >= CHUNK_CAPACITY)
+    chunk_ = std::make_shared<Bytes>();
+
+  Segment segment;
+  segment.stream_id = stream_id;
+  segment.buffer    = chunk_;
+  segment.begin     = chunk_->size();
+  segment.length    = size;
+  segment.chunk     = true;
+
+  // the segments refer the chunk by offset, growing it is safe.
+  chunk_->insert(chunk_->end(), (const uint8_t *)data, (const uint8_t *)data + size);
+  push(std::move(segment));
+}
+
+inline void
+SendQueue::push(const int32_t &stream_id, Bytes &&data)
+{
+  push(stream_id, std::make_shared<const Bytes>(std::move(data)));
+}
+
+inline void
+SendQueue::push(const int32_t &stream_id, const BytesPtr &data)
+{
+  Segment segment;
+  segment.stream_id = stream_id;
+  segment.buffer    = data;
+  segment.length    = data->size();
+  push(std::move(segment));
+}
+
+inline void
+SendQueue::push(const int32_t &stream_id,
+                const void    *head, const size_t &head_size,
+                const FilePtr &file, const size_t &offset, const size_t &length)
+{
+  if (head_size > 0)
+  {
+    push(stream_id, head, head_size);
+    segments_.back().part = length > 0;
+  }
+
+  if (length == 0)
+    return;
+
+  Segment segment;
+  segment.stream_id = stream_id;
+  segment.file      = file;
+  segment.begin     = offset;
+  segment.length    = length;
+  push(std::move(segment));
+}
+
+inline int
+SendQueue::iovecs(struct iovec *iov, const int &max, const size_t &zerocopy_size) const
+{
+  int count = 0;
+  const Segment *prev = nullptr;
+
+  for (const Segment &segment : segments_)
+  {
+    size_t length = segment.length - segment.sent;
+    if (length == 0)
+      continue;
+
+    // sendfile()
+    if (segment.file != nullptr)
+      break;
+
+    if (zerocopy_size > 0 && zerocopy_segment(segment, zerocopy_size) == true)
+      break;
+
+    const uint8_t *data = segment.data() + segment.sent;
+
+    // the next segment of the same chunk.
+    if (prev != nullptr && prev->buffer == segment.buffer &&
+        (const uint8_t *)iov[count - 1].iov_base + iov[count - 1].iov_len == data)
+    {
+      iov[count - 1].iov_len += length;
+      prev = &segment;
+      continue;
+    }
+
+    if (count == max)
+      break;
+
+    iov[count].iov_base = (void *)data;
+    iov[count].iov_len  = length;
+    ++count;
+    prev = &segment;
+  }
+
+  return count;
+}
+
+inline int
+SendQueue::zerocopy_iovecs(struct iovec *iov, const int &max, const size_t &zerocopy_size) const
+{
+  int count = 0;
+  for (const Segment &segment : segments_)
+  {
+    if (count == max || zerocopy_segment(segment, zerocopy_size) == false)
+      break;
+
+    iov[count].iov_base = (void *)(segment.data() + segment.sent);
+    iov[count].iov_len  = segment.length - segment.sent;
+    ++count;
+  }
+
+  return count;
+}
+
+template<typename ON_SENT> void
+SendQueue::consume(size_t size, ON_SENT on_sent, const int64_t &zerocopy_seq)
+{
+  while (segments_.size() > 0)
+  {
+    Segment &segment = segments_.front();
+
+    size_t remain = segment.length - segment.sent;
+    if (zerocopy_seq >= 0 && size > 0)
+    {
+      segment.zerocopy     = true;
+      segment.zerocopy_seq = (uint32_t)zerocopy_seq;
+    }
+
+    if (size < remain)
+    {
+      segment.sent += size;
+      bytes_       -= size;
+      return;
+    }
+
+    size   -= remain;
+    bytes_ -= remain;
+    segment.sent = segment.length;
+
+    if (segment.zerocopy == true || pending_.size() > 0)
+      pending_.push_back(std::move(segment));
+    else if (segment.part == false)
+      on_sent(segment);
+
+    segments_.pop_front();
+  }
+
+  // nothing refers the chunk, it is reused from the beginning.
+  if (chunk_ != nullptr && chunk_.use_count() == 1)
+    chunk_->clear();
+}
+
+template<typename ON_SENT> void
+SendQueue::complete_zerocopy(const uint32_t &first, const uint32_t &last, ON_SENT on_sent)
+{
+  // the ids wrap around.
+  auto completed = [&](Segment &segment)
+  {
+    if (segment.zerocopy == true && (uint32_t)(segment.zerocopy_seq - first) <= (uint32_t)(last - first))
+      segment.zerocopy = false;
+  };
+
+  for (Segment &segment : pending_)
+    completed(segment);
+
+  // the head is written partially.
+  if (segments_.size() > 0)
+    completed(segments_.front());
+
+  release_pending(on_sent);
+}
+
+template<typename ON_SENT> void
+SendQueue::release_pending(ON_SENT on_sent)
+{
+  while (pending_.size() > 0 && pending_.front().zerocopy == false)
+  {
+    if (pending_.front().part == false)
+      on_sent(pending_.front());
+    pending_.pop_front();
+  }
+}
+
+template<typename ON_DROP> void
+SendQueue::clear(ON_DROP on_drop)
+{
+  while (pending_.size() > 0)
+  {
+    if (pending_.front().part == false)
+      on_drop(pending_.front());
+    pending_.pop_front();
+  }
+
+  while (segments_.size() > 0)
+  {
+    if (segments_.front().part == false)
+      on_drop(segments_.front());
+    segments_.pop_front();
+  }
+
+  bytes_ = 0;
+  if (chunk_ != nullptr && chunk_.use_count() == 1)
+    chunk_->clear();
+}
+
+inline SendQueue::FilePtr
+SendQueue::File::open(const std::string &path)
+{
+  // a fifo would block the open until a writer comes.
+  int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC | O_NONBLOCK);
+  if (fd < 0)
+    return nullptr;
+
+  return std::make_shared<const File>(fd);
+}
+
+inline int64_t
+SendQueue::File::size() const
+{
+  struct stat st;
+  if (::fstat(fd_, &st) != 0)
+    return -1;
+
+  return st.st_size;
+}
+
+inline bool
+SendQueue::File::read(const size_t &offset, const size_t &length, std::string &data) const
+{
+  size_t begin = data.size();
+  data.resize(begin + length);
+
+  for (size_t done = 0; done < length;)
+  {
+    ssize_t size = ::pread(fd_, &data[begin + done], length - done, offset + done);
+    if (size < 0 && errno == EINTR)
+      continue;
+
+    if (size <= 0)
+    {
+      // EOF, the file is shorter than the region.
+      if (size == 0)
+        errno = ENODATA;
+
+      data.resize(begin + done);
+      return false;
+    }
+
+    done += size;
+  }
+
+  return true;
+}
+
+inline void
+SendQueue::reserve(const size_t &capacity)
+{
+  if (chunk_ == nullptr)
+    chunk_ = std::make_shared<Bytes>();
+
+  chunk_->reserve(capacity);
+}
+
+inline void
+SendQueue::shrink(const size_t &capacity)
+{
+  if (chunk_ != nullptr && chunk_->capacity() > capacity)
+    chunk_.reset();
+}
+
+}
+
+#endif /* IO_REACTOR_REACTOR_SENDQUEUE_H_ */
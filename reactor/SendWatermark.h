@@ -0,0 +1,107 @@
+/*
+ * SendWatermark.h
+ *
+ *  Created on: 2026. 10. 17.
+ *      Author: tys
+ */
+
+#ifndef IO_REACTOR_REACTOR_SENDWATERMARK_H_
+#define IO_REACTOR_REACTOR_SENDWATERMARK_H_
+
+#include <atomic>
+#include <stddef.h>
+
+namespace reactor
+{
+
+/**
+ * bytes queued to send of a connection, against the high and low watermarks. (backpressure)
+ * over high a send is refused and the connection is blocked until the bytes written
+ * go under low, then sub() returns true once. (handle_writable)
+ * high 0: no limit, the bytes are counted still. (default) thread-safe.
+ */
+class SendWatermark
+{
+public:
+  typedef enum
+  {
+    POLICY_REJECT = 0,  // send() returns false. (default)
+    POLICY_CLOSE  = 1,  // send() returns false and the connection is closed. (slow consumer)
+  } POLICY;
+
+  // call before the connection starts. low is high if it is over high.
+  void set(const size_t &high, const size_t &low, const POLICY &policy = POLICY_REJECT)
+  {
+    high_   = high;
+    low_    = low < high ? low : high;
+    policy_ = policy;
+  }
+
+  // false: refused, the queue is over high or the connection is blocked.
+  bool    add   (const size_t &size);
+  // the bytes written or dropped. true: it went under low, unblocked.
+  bool    sub   (const size_t &size);
+  void    reset ()
+  {
+    bytes_  .store(0);
+    blocked_.store(false);
+  }
+
+  size_t  bytes   () const { return bytes_.load(std::memory_order_relaxed); }
+  bool    blocked () const { return blocked_.load(std::memory_order_relaxed); }
+  POLICY  policy  () const { return policy_; }
+
+private:
+  size_t  high_   = 0;
+  size_t  low_    = 0;
+  POLICY  policy_ = POLICY_REJECT;
+
+  std::atomic<size_t> bytes_{0};
+  std::atomic<bool>   blocked_{false};
+};
+
+inline bool
+SendWatermark::add(const size_t &size)
+{
+  if (high_ == 0)
+  {
+    bytes_.fetch_add(size);
+    return true;
+  }
+
+  // an empty queue takes a send over high.
+  size_t bytes = bytes_.load();
+  while (blocked_.load() == false && (bytes == 0 || bytes + size <= high_))
+  {
+    if (bytes_.compare_exchange_weak(bytes, bytes + size) == true)
+      return true;
+  }
+
+  blocked_.store(true);
+
+  // sub() went under low before it saw blocked_, the next sub() unblocks it.
+  // (seq_cst, sub() stores bytes_ and loads blocked_ in the other order)
+  // it is not blocked then, no handle_writable for it.
+  if (bytes_.load() <= low_)
+  {
+    blocked_.exchange(false);
+    bytes_.fetch_add(size);
+    return true;
+  }
+
+  return false;
+}
+
+inline bool
+SendWatermark::sub(const size_t &size)
+{
+  size_t bytes = bytes_.fetch_sub(size) - size;
+  if (bytes > low_ || blocked_.load() == false)
+    return false;
+
+  return blocked_.exchange(false);
+}
+
+}
+
+#endif /* IO_REACTOR_REACTOR_SENDWATERMARK_H_ */
@@ -0,0 +1,312 @@
+/*
+ * TimingWheel.h
+ *
+ *  Created on: 2026. 10. 17.
+ *      Author: tys
+ */
+
+#ifndef IO_REACTOR_REACTOR_TIMINGWHEEL_H_
+#define IO_REACTOR_REACTOR_TIMINGWHEEL_H_
+
+#include <reactor/DefinedType.h>
+
+#include <chrono>
+#include <vector>
+
+namespace reactor
+{
+
+/**
+ * hierarchical timing wheel. (5 levels x 64 slots)
+ * intrusive, the object owns its Node, so a timer does not allocate.
+ * register/remove are O(1), the expired objects are extracted in a batch.
+ * a timeout is rounded up to the tick. a timeout beyond 64^5 ticks is clamped.
+ * not thread-safe.
+ */
+template<typename T>
+class TimingWheel
+{
+public:
+  class Node
+  {
+  public:
+    Node(T value = T()) : value(value) {}
+    ~Node() { if (wheel_ != nullptr) wheel_->remove_timeout(*this); }
+
+    Node(const Node &) = delete;
+    Node &operator=(const Node &) = delete;
+
+    bool linked() const { return wheel_ != nullptr; }
+
+    T value;
+
+  private:
+    void unlink()
+    {
+      if (prev_ == nullptr)
+        return;
+
+      prev_->next_ = next_;
+      next_->prev_ = prev_;
+      prev_ = next_ = nullptr;
+    }
+
+    TimingWheel *wheel_ = nullptr;
+    Node        *prev_  = nullptr;
+    Node        *next_  = nullptr;
+    uint64_t    expire_ = 0;
+
+    friend class TimingWheel;
+  };
+
+  TimingWheel(const uint32_t &tick_msec = 1);
+
+  TimingWheel(const TimingWheel &) = delete;
+  TimingWheel &operator=(const TimingWheel &) = delete;
+
+  // call while it is empty.
+  void    set_resolution(const uint32_t &tick_msec) { tick_msec_ = tick_msec > 0 ? tick_msec : 1; }
+
+  // re-registering moves the node.
+  void    register_timeout(const uint32_t &msec, Node &node);
+  bool    remove_timeout  (Node &node);
+  /**
+   * the timeout of node on the steady clock, msec. 0: not registered.
+   * the ticks of the wheels are on the same clock, a timer moves to another wheel
+   * by register_expire without drifting. (Reactors::migrate)
+   */
+  uint64_t expire_milliseconds(const Node &node) const
+  { return node.wheel_ == this ? node.expire_ * tick_msec_ : 0; }
+
+  // register_timeout at expire_msec of the steady clock. the past expires at the next tick.
+  void    register_expire (const uint64_t &expire_msec, Node &node);
+
+  // -1: no timer, 0: expired already. it may be earlier than the nearest timer.
+  int32_t get_min_timeout_milliseconds();
+
+  // appends the values of the expired nodes. the nodes are unlinked.
+  size_t  extract_timeout_objects(std::vector<T> &objects);
+
+  size_t  size() const { return size_; }
+
+private:
+  enum { LEVELS = 5, SLOT_BITS = 6, SLOTS = 1 << SLOT_BITS, SLOT_MASK = SLOTS - 1 };
+
+  uint64_t now_tick() const
+  {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count() / tick_msec_;
+  }
+
+  void link   (Node &node);
+  void cascade(const int &level);
+
+  // circular list heads
+  Node &slot(const int &level, const size_t &index) { return slots_[level * SLOTS + index]; }
+
+private:
+  uint32_t  tick_msec_  = 1;
+  // the ticks before this are processed.
+  uint64_t  current_    = 0;
+  size_t    size_       = 0;
+
+  std::vector<Node> slots_;
+};
+
+template<typename T>
+TimingWheel<T>::TimingWheel(const uint32_t &tick_msec)
+: slots_(LEVELS * SLOTS)
+{
+  set_resolution(tick_msec);
+
+  for (Node &head : slots_)
+    head.prev_ = head.next_ = &head;
+}
+
+template<typename T> void
+TimingWheel<T>::link(Node &node)
+{
+  uint64_t expire = node.expire_ < current_ ? current_ : node.expire_;
+  uint64_t delta  = expire - current_;
+
+  int level = 0;
+  while (level < LEVELS - 1 && delta >= ((uint64_t)SLOTS << (level * SLOT_BITS)))
+    ++level;
+
+  // beyond the wheel, it is cascaded again at the last slot.
+  if (delta >= ((uint64_t)1 << (LEVELS * SLOT_BITS)))
+    expire = current_ + ((uint64_t)1 << (LEVELS * SLOT_BITS)) - 1;
+
+  Node &head = slot(level, (expire >> (level * SLOT_BITS)) & SLOT_MASK);
+
+  node.prev_        = head.prev_;
+  node.next_        = &head;
+  head.prev_->next_ = &node;
+  head.prev_        = &node;
+}
+
+template<typename T> void
+TimingWheel<T>::cascade(const int &level)
+{
+  Node &head = slot(level, (current_ >> (level * SLOT_BITS)) & SLOT_MASK);
+  if (head.next_ == &head)
+    return;
+
+  // detach the list, then link again on the lower levels.
+  Node *node = head.next_;
+  head.prev_->next_ = nullptr;
+  head.prev_ = head.next_ = &head;
+
+  while (node != nullptr)
+  {
+    Node *next = node->next_;
+    node->prev_ = node->next_ = nullptr;
+    link(*node);
+    node = next;
+  }
+}
+
+template<typename T> void
+TimingWheel<T>::register_timeout(const uint32_t &msec, Node &node)
+{
+  if (node.wheel_ != nullptr)
+    node.wheel_->remove_timeout(node);
+
+  uint64_t now = now_tick();
+  if (size_ == 0 && current_ < now)
+    current_ = now;
+
+  node.expire_ = now + (msec + tick_msec_ - 1) / tick_msec_;
+  node.wheel_  = this;
+  link(node);
+  ++size_;
+}
+
+template<typename T> void
+TimingWheel<T>::register_expire(const uint64_t &expire_msec, Node &node)
+{
+  if (node.wheel_ != nullptr)
+    node.wheel_->remove_timeout(node);
+
+  uint64_t now = now_tick();
+  if (size_ == 0 && current_ < now)
+    current_ = now;
+
+  node.expire_ = (expire_msec + tick_msec_ - 1) / tick_msec_;
+  if (node.expire_ <= now)
+    node.expire_ = now + 1;
+
+  node.wheel_  = this;
+  link(node);
+  ++size_;
+}
+
+template<typename T> bool
+TimingWheel<T>::remove_timeout(Node &node)
+{
+  if (node.wheel_ != this)
+    return false;
+
+  node.unlink();
+  node.wheel_ = nullptr;
+  --size_;
+  return true;
+}
+
+template<typename T> int32_t
+TimingWheel<T>::get_min_timeout_milliseconds()
+{
+  if (size_ == 0)
+    return -1;
+
+  uint64_t now  = now_tick();
+  uint64_t next = UINT64_MAX;
+
+  for (size_t index = 0; index < SLOTS; ++index)
+  {
+    Node &head = slot(0, (current_ + index) & SLOT_MASK);
+    if (head.next_ != &head)
+    {
+      next = current_ + index;
+      break;
+    }
+  }
+
+  // upper levels: the next cascade of the nearest slot in use.
+  // the slot of current_ is cascaded at current_ when it is aligned, otherwise next round.
+  for (int level = 1; level < LEVELS; ++level)
+  {
+    int       shift = level * SLOT_BITS;
+    uint64_t  base  = current_ >> shift;
+
+    for (size_t index = 0; index < SLOTS; ++index)
+    {
+      uint64_t tick = (base + index) << shift;
+      if (tick >= next)
+        break;
+
+      Node &head = slot(level, (base + index) & SLOT_MASK);
+      if (head.next_ == &head)
+        continue;
+
+      // past, the next round.
+      if (tick < current_)
+      {
+        tick += (uint64_t)SLOTS << shift;
+        if (tick < next)
+          next = tick;
+        continue;
+      }
+
+      if (tick < next)
+        next = tick;
+      break;
+    }
+  }
+
+  if (next <= now)
+    return 0;
+
+  uint64_t msec = (next - now) * tick_msec_;
+  return msec > INT32_MAX ? INT32_MAX : (int32_t)msec;
+}
+
+template<typename T> size_t
+TimingWheel<T>::extract_timeout_objects(std::vector<T> &objects)
+{
+  size_t count = objects.size();
+  uint64_t now = now_tick();
+
+  while (current_ <= now && size_ > 0)
+  {
+    size_t index = current_ & SLOT_MASK;
+
+    // the lower level went around, bring the next slot of the upper level.
+    for (int level = 1; level < LEVELS && index == 0; ++level)
+    {
+      cascade(level);
+      index = (current_ >> (level * SLOT_BITS)) & SLOT_MASK;
+    }
+
+    Node &head = slot(0, current_ & SLOT_MASK);
+    while (head.next_ != &head)
+    {
+      Node *node = head.next_;
+      node->unlink();
+      node->wheel_ = nullptr;
+      --size_;
+      objects.push_back(node->value);
+    }
+
+    ++current_;
+  }
+
+  if (size_ == 0 && current_ < now)
+    current_ = now;
+
+  return objects.size() - count;
+}
+
+}
+
+#endif /* IO_REACTOR_REACTOR_TIMINGWHEEL_H_ */
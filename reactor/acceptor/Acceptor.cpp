@@ -8,11 +8,28 @@
 #include <unistd.h>
 #include <string.h>
 #include <fcntl.h>
+#include <sys/eventfd.h>
 #include <sys/poll.h>
 #include <sys/un.h>
+#include <sys/stat.h>
+#include <linux/filter.h>
+#include <netinet/tcp.h>
 
 using namespace reactor;
 
+Acceptor::Acceptor(const bool &new_client_to_nonblocking)
+: new_client_to_nonblocking_(new_client_to_nonblocking)
+{
+  memset(&addr_, 0x00, sizeof(addr_));
+  stop_event_ = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+}
+
+Acceptor::~Acceptor()
+{
+  if (stop_event_ != INVALID_IO_HANDLE)
+    ::close(stop_event_);
+}
+
 bool
 Acceptor::bind_and_listen()
 {
@@ -20,14 +37,21 @@ Acceptor::bind_and_listen()
 
   struct sockaddr_in6 &addr = *(reinterpret_cast<struct sockaddr_in6 *>(&addr_));
 
+  // AF_UNIX does not take a longer address than sockaddr_un. (EINVAL)
+  socklen_t addr_size = addr_.ss_family == AF_UNIX ? sizeof(sockaddr_un) : sizeof(addr_);
+
   /* don't forget your error checking for these calls: */
-  if (::bind(io_handle_, (struct sockaddr *)&addr, sizeof(addr_)) < 0)
+  if (::bind(io_handle_, (struct sockaddr *)&addr, addr_size) < 0)
   {
     err_code_ = errno;
     reactor_trace << this->address_ << this->port_ << strerror(err_code_) << std::endl;
     return false;
   }
 
+  // before listen, SO_RCVBUF decides the window scale of the connections.
+  if (set_listen_options() == false)
+    return false;
+
   if (::listen(io_handle_, backlog_) < 0)
   {
     err_code_ = errno;
@@ -38,6 +62,45 @@ Acceptor::bind_and_listen()
   int io_flag = fcntl(io_handle_, F_GETFL, 0);
   fcntl(io_handle_, F_SETFL, io_flag | O_NONBLOCK);
 
+  reset_stop();
+  return true;
+}
+
+bool
+Acceptor::set_listen_options()
+{
+  struct Option
+  {
+    int level;
+    int name;
+    int value;
+    bool tcp;
+  };
+
+  const Option options[] =
+  {
+    { SOL_SOCKET,   SO_SNDBUF,          options_.send_buffer_size,  false },
+    { SOL_SOCKET,   SO_RCVBUF,          options_.recv_buffer_size,  false },
+    { IPPROTO_TCP,  TCP_NOTSENT_LOWAT,  options_.notsent_lowat,     true  },
+    { IPPROTO_TCP,  TCP_DEFER_ACCEPT,   options_.defer_accept_sec,  true  },
+    { IPPROTO_TCP,  TCP_FASTOPEN,       options_.fastopen_queue,    true  },
+  };
+
+  bool tcp = addr_.ss_family == AF_INET || addr_.ss_family == AF_INET6;
+
+  for (const Option &option : options)
+  {
+    if (option.value <= 0 || (option.tcp == true && tcp == false))
+      continue;
+
+    if (setsockopt(io_handle_, option.level, option.name, &option.value, sizeof(option.value)) < 0)
+    {
+      err_code_ = errno;
+      reactor_trace << strerror(errno) << ":" << io_handle_ << std::endl;
+      return false;
+    }
+  }
+
   return true;
 }
 
@@ -126,7 +189,8 @@ Acceptor::listen_ipv6(const uint16_t     &port,
 bool
 Acceptor::listen_uds(const std::string &path,
                      const bool        &reuse,
-                     const int         &backlog)
+                     const int         &backlog,
+                     const mode_t      &mode)
 {
   if (path.length() >= sizeof(sockaddr_un::sun_path))
     return false;
@@ -138,6 +202,13 @@ Acceptor::listen_uds(const std::string &path,
   if (set_socketopt(AF_UNIX) == false)
     return false;
 
+  // linux, bind creates the file with the mode of the socket. (less the umask)
+  if (mode != 0 && ::fchmod(io_handle_, mode) < 0)
+  {
+    err_code_ = errno;
+    return false;
+  }
+
   struct sockaddr_un &addr = *(reinterpret_cast<struct sockaddr_un *>(&addr_));
 
   addr.sun_family = AF_UNIX;
@@ -155,6 +226,58 @@ Acceptor::listen_uds(const std::string &path,
 }
 
 
+bool
+Acceptor::listen_handle(const io_handle_t &io_handle)
+{
+  err_code_ = 0;
+
+  socklen_t addr_size = sizeof(addr_);
+  memset(&addr_, 0x00, sizeof(addr_));
+  if (::getsockname(io_handle, (sockaddr *)&addr_, &addr_size) < 0)
+  {
+    err_code_ = errno;
+    return false;
+  }
+
+  char address[INET6_ADDRSTRLEN] = {0};
+  switch (addr_.ss_family)
+  {
+    case AF_INET:
+    {
+      sockaddr_in &addr = *(reinterpret_cast<sockaddr_in *>(&addr_));
+      inet_ntop(AF_INET, &addr.sin_addr, address, sizeof(address));
+      set_port_addr(ntohs(addr.sin_port), address);
+      break;
+    }
+    case AF_INET6:
+    {
+      sockaddr_in6 &addr = *(reinterpret_cast<sockaddr_in6 *>(&addr_));
+      inet_ntop(AF_INET6, &addr.sin6_addr, address, sizeof(address));
+      set_port_addr(ntohs(addr.sin6_port), address);
+      break;
+    }
+    case AF_UNIX:
+      set_port_addr(0, reinterpret_cast<sockaddr_un *>(&addr_)->sun_path);
+      break;
+
+    default:
+      err_code_ = EAFNOSUPPORT;
+      return false;
+  }
+
+  ipv4_ = addr_.ss_family == AF_INET;
+  ipv6_ = addr_.ss_family == AF_INET6;
+  uds_  = addr_.ss_family == AF_UNIX;
+
+  io_handle_ = io_handle;
+
+  int io_flag = fcntl(io_handle_, F_GETFL, 0);
+  fcntl(io_handle_, F_SETFL, io_flag | O_NONBLOCK);
+
+  reset_stop();
+  return true;
+}
+
 bool
 Acceptor::set_socketopt(const int &domain, const bool &ipv6only)
 {
@@ -173,6 +296,14 @@ Acceptor::set_socketopt(const int &domain, const bool &ipv6only)
     return false;
   }
 
+  if (reuse_port_ == true &&
+      setsockopt(io_handle_, SOL_SOCKET, SO_REUSEPORT, &enable, sizeof(enable)) < 0)
+  {
+    err_code_ = errno;
+    reactor_trace << strerror(errno) << ":" << io_handle_ << std::endl;
+    return false;
+  }
+
   struct linger solinger = { 1, 0 };
   if (setsockopt(io_handle_, SOL_SOCKET, SO_LINGER, &solinger, sizeof(struct linger)) == -1)
   {
@@ -184,8 +315,9 @@ Acceptor::set_socketopt(const int &domain, const bool &ipv6only)
   if (ipv6only == false)
     enable = 0;
 
-  // only ipv6_
-  if (setsockopt(io_handle_, IPPROTO_IPV6, IPV6_V6ONLY, (char *)&enable, sizeof(enable)) < 0)
+  // only ipv6_. an AF_INET socket has no IPV6_V6ONLY. (ENOPROTOOPT)
+  if (domain == AF_INET6 &&
+      setsockopt(io_handle_, IPPROTO_IPV6, IPV6_V6ONLY, (char *)&enable, sizeof(enable)) < 0)
   {
     err_code_ = errno;
     reactor_trace << strerror(errno) << ":" << io_handle_ << std::endl;
@@ -195,84 +327,200 @@ Acceptor::set_socketopt(const int &domain, const bool &ipv6only)
   return true;
 }
 
-static thread_local struct pollfd fds[1];
-static thread_local bool pollfd_init = false;
+bool
+Acceptor::attach_reuseport_cbpf(const size_t                        &group_size,
+                                const std::vector<std::vector<int>> &cpus)
+{
+  err_code_ = 0;
 
-io_handle_t
-Acceptor::accept(struct ::sockaddr_storage &client_addr, const int32_t &timeout_msec)
+  if (group_size == 0)
+  {
+    err_code_ = EINVAL;
+    return false;
+  }
+
+  // A = cpu, (if A == cpu of a socket, return the index of the socket)..., return A % group_size
+  std::vector<struct sock_filter> code;
+  code.push_back(BPF_STMT(BPF_LD | BPF_W | BPF_ABS, (uint32_t)(SKF_AD_OFF + SKF_AD_CPU)));
+
+  for (size_t index = 0; index < cpus.size() && index < group_size; ++index)
+  {
+    for (const int &cpu : cpus[index])
+    {
+      code.push_back(BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, (uint32_t)cpu, 0, 1));
+      code.push_back(BPF_STMT(BPF_RET | BPF_K, (uint32_t)index));
+    }
+  }
+
+  code.push_back(BPF_STMT(BPF_ALU | BPF_MOD | BPF_K, (uint32_t)group_size));
+  code.push_back(BPF_STMT(BPF_RET | BPF_A, 0));
+
+  if (code.size() > BPF_MAXINSNS)
+  {
+    err_code_ = E2BIG;
+    return false;
+  }
+
+  struct sock_fprog program;
+  program.len    = (unsigned short)code.size();
+  program.filter = code.data();
+
+  if (setsockopt(io_handle_, SOL_SOCKET, SO_ATTACH_REUSEPORT_CBPF, &program, sizeof(program)) < 0)
+  {
+    err_code_ = errno;
+    reactor_trace << strerror(errno) << ":" << io_handle_ << std::endl;
+    return false;
+  }
+
+  return true;
+}
+
+bool
+Acceptor::set_client_nodelay(const bool &value)
 {
-  if (pollfd_init == false)
+  int enable = value == true ? 1 : 0;
+  if (setsockopt(io_handle_, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable)) < 0)
   {
-    fds[0].fd     = io_handle_;
-    fds[0].events = POLLIN | POLLPRI | POLLERR | POLLHUP;
-    pollfd_init   = true;
+    err_code_ = errno;
+    return false;
   }
 
+  return true;
+}
+
+io_handle_t
+Acceptor::accept(struct ::sockaddr_storage &client_addr, const int32_t &timeout_msec)
+{
+  Client client;
+
+  int result = this->accept(&client, 1, timeout_msec);
+  if (result <= 0)
+    return result;
+
+  client_addr = client.addr;
+  return client.io_handle;
+}
+
+int
+Acceptor::accept(Client *clients, const size_t &max_count, const int32_t &timeout_msec)
+{
+  // the options of the listening socket (SO_REUSEADDR, TCP_NODELAY) are inherited.
+  int flags = SOCK_CLOEXEC;
+  if (new_client_to_nonblocking_ == true)
+    flags |= SOCK_NONBLOCK;
+
   std::chrono::steady_clock::time_point timeout_point =
       std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_msec);
 
   int32_t remain_timeout_msec = timeout_msec;
-  int32_t poll_result = 0;
+
+  struct pollfd fds[2];
+  fds[0].fd     = io_handle_;
+  fds[0].events = POLLIN | POLLPRI | POLLERR | POLLHUP;
+  fds[1].fd     = stop_event_;
+  fds[1].events = POLLIN;
 
   while (true)
   {
-    poll_result = poll(fds, 1, remain_timeout_msec);
+    if (stopped_.load() == true)
+      return -1;
 
-    if (poll_result <= 0)
-      return poll_result;
+    // drains the backlog, poll only when it is empty.
+    size_t count = 0;
+    while (count < max_count)
+    {
+      socklen_t addr_size = sizeof(clients[count].addr);
+      clients[count].io_handle = ::accept4(io_handle_, (sockaddr *)&clients[count].addr, &addr_size, flags);
+      if (clients[count].io_handle < 0)
+        break;
 
-    // when shutdown
-    if (!(fds[0].revents & (POLLIN | POLLPRI)))
-      break;
+      ++count;
+    }
 
-    static socklen_t sin_size = sizeof(client_addr);
-    io_handle_t new_io_handle = ::accept(io_handle_, (sockaddr *)&client_addr, &sin_size);
+    if (count > 0)
+    {
+      err_code_ = 0;
+      return (int)count;
+    }
 
-    if (new_io_handle < 0 && errno != EWOULDBLOCK)
+    if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR && errno != ECONNABORTED)
     {
       char buffer[100];
       reactor_trace << io_handle_ << errno << strerror_r(errno, buffer, sizeof(buffer));
-      continue;
     }
 
-    if (new_io_handle < 0 && errno == EWOULDBLOCK)
+    if (timeout_msec >= 0)
     {
-      if (timeout_msec >= 0)
-      {
-        remain_timeout_msec =
-            std::chrono::duration_cast<std::chrono::milliseconds>
-        (timeout_point - std::chrono::steady_clock::now()).count();
-
-        if (remain_timeout_msec <= 0)
-          return 0;
-      }
-      else
-      {
-        remain_timeout_msec = -1;
-      }
+      remain_timeout_msec =
+          std::chrono::duration_cast<std::chrono::milliseconds>
+      (timeout_point - std::chrono::steady_clock::now()).count();
 
-      continue;
+      if (remain_timeout_msec < 0)
+        return 0;
     }
 
-    err_code_ = 0;
-    static int enable = 1;
-    if (setsockopt(new_io_handle, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable)) < 0)
-    {
-      err_code_ = errno;
-      reactor_trace << strerror(errno) << ":" << io_handle_ << std::endl;
-      return -1;
-    }
+    fds[0].revents  = 0;
+    fds[1].revents  = 0;
+    int poll_result = poll(fds, 2, remain_timeout_msec);
 
-    if (new_client_to_nonblocking_ == true)
-    {
-      int io_flag = fcntl(new_io_handle, F_GETFL, 0);
-      fcntl(new_io_handle, F_SETFL, io_flag | O_NONBLOCK);
-    }
+    if (poll_result <= 0)
+      return poll_result;
 
-    return new_io_handle;
+    // stop_accept, the socket is kept.
+    if (fds[1].revents != 0)
+      return -1;
+
+    // when shutdown
+    if (!(fds[0].revents & (POLLIN | POLLPRI)))
+      break;
   }
 
-  ::close(io_handle_);
+  // the owner closes the socket. (close_listeners) its number must not be closed twice.
+  return -1;
+}
+
+int
+Acceptor::pause(const int32_t &timeout_msec)
+{
+  if (stopped_.load() == true)
+    return -1;
+
+  // no events, only shutdown (POLLHUP), error or stop_accept wakes it up.
+  struct pollfd fds[2];
+  fds[0].fd       = io_handle_;
+  fds[0].events   = 0;
+  fds[0].revents  = 0;
+  fds[1].fd       = stop_event_;
+  fds[1].events   = POLLIN;
+  fds[1].revents  = 0;
+
+  int poll_result = poll(fds, 2, timeout_msec);
+  if (poll_result == 0 || (poll_result < 0 && errno == EINTR))
+    return 0;
+
+  if (fds[1].revents != 0)
+    return -1;
+
+  // shutdown or error, see accept().
   return -1;
 }
 
+void
+Acceptor::reset_stop()
+{
+  stopped_ = false;
+
+  uint64_t value = 0;
+  if (::read(stop_event_, &value, sizeof(value)) < 0)
+    return;
+}
+
+void
+Acceptor::stop_accept()
+{
+  stopped_ = true;
+
+  uint64_t value = 1;
+  if (::write(stop_event_, &value, sizeof(value)) < 0)
+    return;
+}
@@ -9,7 +9,9 @@
 #define IO_REACTOR_REACTOR_ACCEPTOR_ACCEPTOR_H_
 
 #include <reactor/DefinedType.h>
+#include <atomic>
 #include <string>
+#include <vector>
 
 #include <string.h>
 #include <unistd.h>
@@ -18,17 +20,53 @@
 namespace reactor
 {
 
+/**
+ * options of the listening socket, 0: the system default.
+ * the accepted sockets inherit them, no syscall per connection.
+ */
+struct AcceptorOptions
+{
+  // TCP_DEFER_ACCEPT, seconds. a connection is accepted when its first data arrives.
+  int defer_accept_sec  = 0;
+  // TCP_FASTOPEN, max pending fast open requests. the data of the SYN is accepted.
+  // (net.ipv4.tcp_fastopen & 2)
+  int fastopen_queue    = 0;
+  // TCP_NOTSENT_LOWAT, bytes. writable when the unsent data is below it.
+  int notsent_lowat     = 0;
+  // SO_SNDBUF, SO_RCVBUF, bytes.
+  int send_buffer_size  = 0;
+  int recv_buffer_size  = 0;
+};
+
 class Acceptor
 {
 public:
-  Acceptor(const bool &new_client_to_nonblocking = true)
-  : new_client_to_nonblocking_(new_client_to_nonblocking)
-  { memset(&addr_, 0x00, sizeof(addr_)); }
+  Acceptor(const bool &new_client_to_nonblocking = true);
 
-  virtual ~Acceptor() {}
+  virtual ~Acceptor();
 
   void set_client_to_nonblocking(const bool &value) { new_client_to_nonblocking_ = value; }
 
+  /**
+   * SO_REUSEPORT, the listening sockets of the same address form a group,
+   * the kernel spreads the connections over them. (a listener per reactor)
+   * call before listen_*().
+   */
+  void set_reuse_port(const bool &value) { reuse_port_ = value; }
+
+  // see AcceptorOptions. call before listen_*().
+  void set_options(const AcceptorOptions &options) { options_ = options; }
+  const AcceptorOptions &options() const { return options_; }
+
+  /**
+   * SO_ATTACH_REUSEPORT_CBPF, steers a connection by the cpu that received it.
+   * the index of a socket in the group is the order of listen_*().
+   * cpus[index]: cpus of the socket of the index, a cpu not in cpus goes to (cpu % group_size).
+   * call on a socket of the group after every socket is listening.
+   */
+  bool attach_reuseport_cbpf(const size_t                        &group_size,
+                             const std::vector<std::vector<int>> &cpus = std::vector<std::vector<int>>());
+
   bool listen_ipv4  (const uint16_t     &port,
                      const std::string  &address_  = "0.0.0.0",
                      const int          &backlog   = 100);
@@ -53,9 +91,17 @@ public:
                      const int          &backlog,
                      const std::string  &address_  = "::0");
 
+  // mode: permission of the socket file, 0: by the umask.
   bool listen_uds   (const std::string  &path,
                      const bool         &reuse = true,
-                     const int          &backlog = 100);
+                     const int          &backlog = 100,
+                     const mode_t       &mode = 0);
+
+  /**
+   * a socket listening already, the options of its previous owner are kept.
+   * (ListenerHandoff, systemd socket activation)
+   */
+  bool listen_handle(const io_handle_t  &io_handle);
 
   void close    ();
   void shutdown (const int &how);
@@ -68,9 +114,45 @@ public:
   const std::string   &addr     () const { return address_; }
   std::string         addr_port () const { return address_ + ":" + std::to_string(port_); }
 
-  virtual io_handle_t accept    (struct ::sockaddr_storage  &client_addr,
+  struct Client
+  {
+    io_handle_t               io_handle = INVALID_IO_HANDLE;
+    struct ::sockaddr_storage addr;
+  };
+
+  // 0: timeout, < 0: shutdown or error. see accept(Client *, ...)
+  io_handle_t accept            (struct ::sockaddr_storage  &client_addr,
                                  const int32_t              &timeout_msec = -1);
 
+  /**
+   * accepts up to max_count connections. accept4() until the backlog is empty,
+   * it polls only when there is no connection to accept.
+   * return the count of clients, 0: timeout, < 0: shutdown or error.
+   * the socket is not closed then, the owner close() it.
+   */
+  virtual int         accept    (Client                     *clients,
+                                 const size_t               &max_count,
+                                 const int32_t              &timeout_msec = -1);
+
+  /**
+   * does not accept for timeout_msec, the connections wait in the backlog.
+   * see AdmissionControl. return 0: timeout, < 0: shutdown or error. (like accept)
+   */
+  int         pause     (const int32_t              &timeout_msec);
+
+  /**
+   * accept() and pause() of all threads return < 0, the listening socket is not shut down.
+   * the socket can be handed off to another process. (ListenerHandoff)
+   * shutdown() stops them too, but the socket stops for the other process as well.
+   */
+  void        stop_accept();
+
+  /**
+   * TCP_NODELAY of the listening socket, inherited by the accepted sockets.
+   * call after listen_*().
+   */
+  bool set_client_nodelay(const bool &value);
+
   std::string err_str () const
   {
     char error_string[240];
@@ -79,7 +161,7 @@ public:
 
   const int   &err_code() const { return err_code_; }
 
-protected:
+  // listening io handle, see Reactor::register_acceptor.
   const io_handle_t &io_handle() const { return io_handle_; }
 
 private:
@@ -91,6 +173,9 @@ private:
   }
 
   bool bind_and_listen();
+  bool set_listen_options();
+  // a new listen after stop_accept().
+  void reset_stop();
 
 private:
   uint16_t    port_     = 0;
@@ -107,8 +192,15 @@ private:
   io_handle_t io_handle_ = INVALID_IO_HANDLE;
   struct sockaddr_storage addr_;
 
+private:
+  // stop_accept(), eventfd. it stays readable, every poll wakes up.
+  io_handle_t       stop_event_ = INVALID_IO_HANDLE;
+  std::atomic<bool> stopped_{false};
+
 private:
   bool  new_client_to_nonblocking_ = false;
+  bool  reuse_port_ = false;
+  AcceptorOptions options_;
 };
 
 inline bool
@@ -132,12 +224,20 @@ Acceptor::listen_ipv6 (const uint16_t    &port,
 inline void
 Acceptor::close()
 {
+  if (io_handle_ == INVALID_IO_HANDLE)
+    return;
+
   ::close(io_handle_);
+  // shutdown() after close must not hit a new socket of the same number.
+  io_handle_ = INVALID_IO_HANDLE;
 }
 
 inline void
 Acceptor::shutdown(const int &how)
 {
+  if (io_handle_ == INVALID_IO_HANDLE)
+    return;
+
   ::shutdown(io_handle_, how);
 }
 
@@ -0,0 +1,150 @@
+/*
+ * AcceptorHandler.cpp
+ *
+ *  Created on: 2026. 10. 17.
+ *      Author: tys
+ */
+
+#include "AcceptorHandler.h"
+#include <reactor/EventHandlerAttr.h>
+#include <reactor/trace.h>
+
+#include <sys/socket.h>
+
+namespace reactor
+{
+
+bool
+AcceptorHandler::register_acceptor()
+{
+  const std::vector<Reactor *> &reactors = reactors_.get_reactors();
+  if (reactor_index_ >= reactors.size())
+    return false;
+
+  // tcp nodelay, inherited by the accepted sockets.
+  if (acceptor_.is_uds() == false)
+    acceptor_.set_client_nodelay(true);
+
+  EventHandlerAttr::io_handle(this) = acceptor_.io_handle();
+  return reactors[reactor_index_]->register_acceptor(this, acceptor_.io_handle());
+}
+
+void
+AcceptorHandler::handle_accept(const io_handle_t &client_io_handle)
+{
+  // the demuxer accepts without the address.
+  Acceptor::Client client;
+  client.io_handle = client_io_handle;
+  socklen_t addr_size = sizeof(client.addr);
+  if (::getpeername(client_io_handle, (sockaddr *)&client.addr, &addr_size) < 0)
+  {
+    ::close(client_io_handle);
+    return;
+  }
+
+  // accepted with the pending ones of the event, it waits for room like in the backlog.
+  if (admission_ != nullptr && (paused_ == true || pause_if_full() == true))
+  {
+    waiting_.push_back(client);
+    return;
+  }
+
+  admit_client(client);
+}
+
+void
+AcceptorHandler::admit_client(const Acceptor::Client &client)
+{
+  const io_handle_t &client_io_handle = client.io_handle;
+
+  // the reactor can be changed to one with room.
+  size_t    reactor_index = reactor_index_;
+  uint64_t  admission_key = 0;
+  if (admission_ != nullptr &&
+      admission_->admit(reactor_index, client.addr, admission_key) == false)
+  {
+    ::close(client_io_handle);
+    return;
+  }
+
+  Reactor *reactor = reactors_.get_reactors()[reactor_index];
+
+  EventHandler *event_handler = handler_factory_.create(client_io_handle, client.addr);
+  if (event_handler == nullptr)
+  {
+    if (admission_ != nullptr) admission_->release(admission_key);
+    return;
+  }
+
+  EventHandlerAttr::io_handle(event_handler) = client_io_handle;
+  if (on_created_handler(event_handler, *reactor, reactors_, reactor_index) == false)
+  {
+    if (admission_ != nullptr) admission_->release(admission_key);
+    ::close(client_io_handle);
+    return;
+  }
+
+  EventHandlerAttr::admission(event_handler, admission_, admission_key);
+
+  // on the same thread, it is registered without waking up the reactor.
+  reactor->register_event_handler(event_handler, client_io_handle);
+}
+
+bool
+AcceptorHandler::pause_if_full()
+{
+  int32_t retry_msec = 0;
+  if (admission_ == nullptr || draining_ == true || admission_->acquirable(retry_msec) > 0)
+    return false;
+
+  // the kernel backlog holds the clients, and refuses them when it is full.
+  admission_->count_deferred();
+  if (paused_ == false)
+  {
+    paused_ = true;
+    reactor_->pause_acceptor(this);
+  }
+
+  reactor_->set_timeout(this, (uint32_t)retry_msec);
+  return true;
+}
+
+void
+AcceptorHandler::handle_timeout()
+{
+  if (paused_ == false || draining_ == true)
+    return;
+
+  while (waiting_.empty() == false)
+  {
+    if (pause_if_full() == true)
+      return;
+
+    Acceptor::Client client = waiting_.front();
+    waiting_.pop_front();
+    admit_client(client);
+  }
+
+  if (pause_if_full() == true)
+    return;
+
+  paused_ = false;
+  reactor_->resume_acceptor(this);
+}
+
+void
+AcceptorHandler::close_waiting()
+{
+  for (const Acceptor::Client &client : waiting_)
+    ::close(client.io_handle);
+
+  waiting_.clear();
+}
+
+void
+AcceptorHandler::handle_error(const int &error_no, const std::string &error_str)
+{
+  reactor_trace << acceptor_.addr_port() << ":" << error_no << ":" << error_str << std::endl;
+}
+
+}
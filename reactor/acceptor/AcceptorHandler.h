@@ -0,0 +1,112 @@
+/*
+ * AcceptorHandler.h
+ *
+ *  Created on: 2026. 10. 17.
+ *      Author: tys
+ */
+
+#ifndef IO_REACTOR_REACTOR_ACCEPTOR_ACCEPTORHANDLER_H_
+#define IO_REACTOR_REACTOR_ACCEPTOR_ACCEPTORHANDLER_H_
+
+#include <reactor/acceptor/Acceptor.h>
+#include <reactor/acceptor/AdmissionControl.h>
+#include <reactor/acceptor/EventHandlerFactory.h>
+
+#include <reactor/EventHandler.h>
+#include <reactor/Reactors.h>
+
+#include <deque>
+
+namespace reactor
+{
+
+/**
+ * listener of a reactor, the AcceptorThread without the thread.
+ * the connections are accepted and registered on the reactor thread,
+ * no hand-off to another thread. with an SO_REUSEPORT listener per reactor,
+ * the kernel spreads the connections over the reactors. (Acceptor::set_reuse_port)
+ * the acceptor and the handler live until the reactor is stopped.
+ */
+class AcceptorHandler : public EventHandler
+{
+public:
+  AcceptorHandler(Acceptor            &acceptor,
+                  Reactors            &reactors,
+                  const size_t        &reactor_index,
+                  EventHandlerFactory &event_handler_factory);
+
+  virtual ~AcceptorHandler() {}
+
+  // registers the listening io handle on reactors.get_reactors()[reactor_index].
+  bool register_acceptor();
+
+  const Acceptor &get_acceptor() const { return acceptor_; }
+
+  /**
+   * connection limits, nullptr: unlimited. (default) see AcceptorThread::set_admission_control
+   * the listener is not read while nothing is acquirable. the reactor accepts the pending
+   * connections of an event together, the ones over a limit wait in the handler for room.
+   * call before register_acceptor().
+   */
+  void set_admission_control(AdmissionControl *admission) { admission_ = admission; }
+
+protected:
+  // see AcceptorThread::on_created_handler
+  virtual bool on_created_handler(EventHandler  *,
+                                  Reactor       &,
+                                  Reactors      &,
+                                  const size_t  &reactor_index) { (void)reactor_index; return true; }
+
+protected:
+  void handle_accept    (const io_handle_t &io_handle) override;
+  void handle_error     (const int &error_no, const std::string &error_str) override;
+  // stops accepting, the listening socket is not closed.
+  void handle_drain     () override
+  {
+    draining_ = true;
+    reactor_->remove_event_handler(this);
+  }
+  // resumes the paused listener.
+  void handle_timeout   () override;
+
+  void handle_registered() override {}
+  void handle_removed   () override { close_waiting(); }
+  void handle_input     () override {}
+  void handle_output    () override {}
+  void handle_close     () override {}
+  void handle_shutdown  () override { close_waiting(); }
+
+  // admits and registers the connection, or closes it. (rejected)
+  void admit_client     (const Acceptor::Client &client);
+  // the listener is not read while nothing is acquirable. false: acquirable.
+  bool pause_if_full    ();
+  void close_waiting    ();
+
+private:
+  Acceptor            &acceptor_;
+  Reactors            &reactors_;
+  size_t              reactor_index_;
+  EventHandlerFactory &handler_factory_;
+  AdmissionControl    *admission_ = nullptr;
+
+  // reactor thread. accepted while paused, admitted at handle_timeout().
+  bool                paused_   = false;
+  bool                draining_ = false;
+  std::deque<Acceptor::Client> waiting_;
+};
+
+inline
+AcceptorHandler::AcceptorHandler(Acceptor            &acceptor,
+                                 Reactors            &reactors,
+                                 const size_t        &reactor_index,
+                                 EventHandlerFactory &event_handler_factory)
+: acceptor_       (acceptor),
+  reactors_       (reactors),
+  reactor_index_  (reactor_index),
+  handler_factory_(event_handler_factory)
+{
+}
+
+}
+
+#endif /* IO_REACTOR_REACTOR_ACCEPTOR_ACCEPTORHANDLER_H_ */
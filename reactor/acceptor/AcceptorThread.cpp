@@ -9,9 +9,6 @@
 #include <reactor/EventHandlerAttr.h>
 #include <reactor/trace.h>
 
-// tcp nodelay
-#include <linux/socket.h>
-#include <netinet/tcp.h>
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <netinet/in.h>
@@ -22,12 +19,18 @@ namespace reactor
 void
 AcceptorThread::run()
 {
-  io_handle_t               client_io_handle  = INVALID_IO_HANDLE;
-  struct ::sockaddr_storage client_addr;
+  std::vector<Acceptor::Client> clients(ACCEPT_BATCH);
 
-  Reactor       *reactor        = nullptr;
-  size_t        reactors_index  = 0;
-  EventHandler  *event_handler  = nullptr;
+  // the handlers of a batch by the reactor, registered with a wake up per reactor.
+  const std::vector<Reactor *> &reactors = reactors_.get_reactors();
+  std::vector<std::vector<EventHandler *>> registrations(reactors.size());
+
+  if (CpuAffinity::set_current_thread(cpus_) == false)
+    reactor_trace << "cpu affinity failed" << std::endl;
+
+  // tcp nodelay, inherited by the accepted sockets.
+  if (acceptor_.is_uds() == false)
+    acceptor_.set_client_nodelay(true);
 
   if (acceptor_thread_handler_factory_ != nullptr)
   {
@@ -55,33 +58,84 @@ AcceptorThread::run()
       }
     }
 
-    client_io_handle = acceptor_.accept(client_addr, min_timeout);
+    size_t max_count = clients.size();
+    if (admission_ != nullptr)
+    {
+      int32_t retry_msec  = 0;
+      size_t  acquirable  = admission_->acquirable(retry_msec);
+      if (acquirable == 0)
+      {
+        // the kernel backlog holds the clients, and refuses them when it is full.
+        admission_->count_deferred();
+        if (min_timeout >= 0 && min_timeout < retry_msec)
+          retry_msec = min_timeout;
+
+        if (acceptor_.pause(retry_msec) < 0)
+          break;
+
+        continue;
+      }
+
+      if (acquirable < max_count)
+        max_count = acquirable;
+    }
+
+    int count = acceptor_.accept(clients.data(), max_count, min_timeout);
 
     // timeout
-    if (client_io_handle == 0)
+    if (count == 0)
       continue;
 
-    if (client_io_handle < 0)
+    if (count < 0)
       break;
 
-    static int enable = 1;
-    setsockopt(client_io_handle, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(int));
-    setsockopt(client_io_handle, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(int));
+    for (int index = 0; index < count; ++index)
+    {
+      const io_handle_t       &client_io_handle = clients[index].io_handle;
+      const sockaddr_storage  &client_addr      = clients[index].addr;
 
-    reactor = reactors_.get_reactor();
+      size_t  reactors_index  = reactors_.select_reactor(client_io_handle, &client_addr);
 
-    event_handler = handler_factory_.create(client_io_handle, client_addr);
-    if (event_handler == nullptr)
-      continue;
+      // the reactor can be changed to one with room.
+      uint64_t admission_key = 0;
+      if (admission_ != nullptr &&
+          admission_->admit(reactors_index, client_addr, admission_key) == false)
+      {
+        ::close(client_io_handle);
+        continue;
+      }
 
-    EventHandlerAttr::io_handle(event_handler) = client_io_handle;
-    if (on_created_handler(event_handler, *reactor, reactors_, reactors_index) == false)
-    {
-      ::close(client_io_handle);
-      continue;
+      Reactor *reactor = reactors[reactors_index];
+
+      EventHandler *event_handler = handler_factory_.create(client_io_handle, client_addr);
+      if (event_handler == nullptr)
+      {
+        if (admission_ != nullptr) admission_->release(admission_key);
+        continue;
+      }
+
+      EventHandlerAttr::io_handle(event_handler) = client_io_handle;
+      if (on_created_handler(event_handler, *reactor, reactors_, reactors_index) == false)
+      {
+        if (admission_ != nullptr) admission_->release(admission_key);
+        ::close(client_io_handle);
+        continue;
+      }
+
+      EventHandlerAttr::admission(event_handler, admission_, admission_key);
+
+      registrations[reactors_index].push_back(event_handler);
     }
 
-    reactor->register_event_handler(event_handler, client_io_handle);
+    for (size_t reactors_index = 0; reactors_index < registrations.size(); ++reactors_index)
+    {
+      std::vector<EventHandler *> &handlers = registrations[reactors_index];
+      if (handlers.size() == 0)
+        continue;
+
+      reactors[reactors_index]->register_event_handlers(handlers.data(), handlers.size());
+      handlers.clear();
+    }
   }
 
   if (acceptor_thread_handler_ != nullptr)
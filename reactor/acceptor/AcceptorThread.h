@@ -10,6 +10,7 @@
 
 #include <reactor/acceptor/AcceptorThreadHandlerFactory.h>
 #include <reactor/acceptor/Acceptor.h>
+#include <reactor/acceptor/AdmissionControl.h>
 #include <reactor/acceptor/EventHandlerFactory.h>
 
 #include <reactor/ReactorHandlerFactory.h>
@@ -22,6 +23,7 @@
 #include <mutex>
 #include <condition_variable>
 #include <functional>
+#include <vector>
 
 namespace reactor
 {
@@ -38,9 +40,20 @@ public:
 
   void start();
   void stop ();
+  // stops accepting, the listening socket is not shut down. see Acceptor::stop_accept
+  void stop_accept();
 
   const Acceptor &get_acceptor() const { return acceptor_; }
 
+  // cpus of the acceptor thread, empty: not pinned. (default) call before start().
+  void set_cpu_affinity(const std::vector<int> &cpus) { cpus_ = cpus; }
+
+  /**
+   * connection limits, nullptr: unlimited. (default) it can be shared by the acceptors.
+   * the listen socket is not read while nothing is acquirable. call before start().
+   */
+  void set_admission_control(AdmissionControl *admission) { admission_ = admission; }
+
 protected:
   virtual bool on_created_handler(EventHandler  *,
                                   Reactor       &,
@@ -50,6 +63,9 @@ protected:
 protected:
   void    run();
 
+  // connections accepted at once.
+  enum { ACCEPT_BATCH = 64 };
+
 private:
   AcceptorThreadHandler        *acceptor_thread_handler_         = nullptr;
   AcceptorThreadHandlerFactory *acceptor_thread_handler_factory_ = nullptr;
@@ -60,7 +76,9 @@ private:
   EventHandlerFactory &handler_factory_;
 
 private:
-  std::thread *thread_  = nullptr;
+  std::thread       *thread_  = nullptr;
+  std::vector<int>  cpus_;
+  AdmissionControl  *admission_ = nullptr;
 
 private:
   std::condition_variable  run_cond_;
@@ -113,6 +131,18 @@ AcceptorThread::stop()
   thread_ = nullptr;
 }
 
+inline void
+AcceptorThread::stop_accept()
+{
+  acceptor_.stop_accept();
+  if (thread_ == nullptr)
+    return;
+
+  thread_->join();
+  delete thread_;
+  thread_ = nullptr;
+}
+
 }
 
 #endif /* OPEN_REACTOR_TCP_ACCEPTOR_ACCEPTTHREAD_H_ */
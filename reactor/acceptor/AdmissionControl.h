@@ -0,0 +1,381 @@
+/*
+ * AdmissionControl.h
+ *
+ *  Created on: 2026. 10. 17.
+ *      Author: tys
+ */
+
+#ifndef IO_REACTOR_REACTOR_ACCEPTOR_ADMISSIONCONTROL_H_
+#define IO_REACTOR_REACTOR_ACCEPTOR_ADMISSIONCONTROL_H_
+
+#include <reactor/DefinedType.h>
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <sys/socket.h>
+#include <netinet/in.h>
+
+namespace reactor
+{
+
+// 0: unlimited
+struct AdmissionLimits
+{
+  size_t    max_connections             = 0;
+  size_t    max_connections_per_reactor = 0;
+  // token bucket, connections per second. burst 0: accept_rate.
+  uint32_t  accept_rate                 = 0;
+  uint32_t  accept_burst                = 0;
+  // concurrent connections of a source ip address.
+  uint32_t  max_connections_per_ip      = 0;
+
+  bool unlimited() const
+  {
+    return max_connections == 0 && max_connections_per_reactor == 0 &&
+           accept_rate     == 0 && max_connections_per_ip      == 0;
+  }
+};
+
+/**
+ * connection admission of the acceptors. (AcceptorThread::set_admission_control)
+ * the acceptor asks acquirable() before accept(). if it is 0, the listen socket
+ * is not read for a while, the kernel backlog pushes back the clients.
+ * the reactor acceptors stop reading when it is 0, the connections accepted
+ * with the last event wait for room. (AcceptorHandler)
+ * the source ip limit is known only after accept(), such a connection is closed. (rejected)
+ * an admitted connection is released when its handler is removed from the reactor.
+ * the source ips are counted in hashed buckets, a collision counts the other ip too.
+ * thread-safe.
+ */
+class AdmissionControl
+{
+public:
+  AdmissionControl(const AdmissionLimits &limits, const size_t &reactor_count);
+
+  AdmissionControl(const AdmissionControl &) = delete;
+  AdmissionControl &operator=(const AdmissionControl &) = delete;
+
+  /**
+   * count of the connections that can be accepted now.
+   * 0: deferred, retry after retry_msec.
+   */
+  size_t    acquirable(int32_t &retry_msec);
+
+  /**
+   * admits a connection to reactor_index. if the reactor is full, reactor_index is
+   * changed to a reactor with room. false: rejected, close the connection.
+   * key: see EventHandlerAttr::admission, release(key) when the handler is removed.
+   */
+  bool      admit     (size_t &reactor_index, const sockaddr_storage &addr, uint64_t &key);
+
+  void      release   (const uint64_t &key);
+  // the connection of key has moved to reactor_index, key is changed. (Reactors::migrate)
+  // max_connections_per_reactor is not checked.
+  void      move      (uint64_t &key, const size_t &reactor_index);
+
+  struct Stats
+  {
+    uint64_t  active    = 0;
+    uint64_t  admitted  = 0;
+    // closed after accept, the source ip limit or no room.
+    uint64_t  rejected  = 0;
+    // the listen socket was not read because of a limit.
+    uint64_t  deferred  = 0;
+  };
+
+  Stats     stats() const;
+
+  // AcceptorThread, the listen socket is not read.
+  void      count_deferred() { deferred_.fetch_add(1, std::memory_order_relaxed); }
+
+  // retry interval of the connection limits. (no notification on release)
+  enum { RETRY_MSEC = 10 };
+
+private:
+  enum { IP_BUCKETS = 1 << 16 };
+
+  static uint32_t ip_bucket(const sockaddr_storage &addr);
+
+  // reactor index + 1 in the high 32 bits, the ip bucket + 1 in the low 32 bits.
+  static uint64_t make_key(const size_t &reactor_index, const uint32_t &bucket)
+  { return ((uint64_t)(reactor_index + 1) << 32) | (uint64_t)(bucket + 1); }
+
+  bool      acquire_token();
+  // adds the tokens of the elapsed time. token_lock_ is held.
+  void      refill_tokens();
+
+private:
+  AdmissionLimits limits_;
+
+  std::atomic<size_t>                     active_{0};
+  std::unique_ptr<std::atomic<size_t>[]>  reactor_active_;
+  size_t                                  reactor_count_;
+  std::unique_ptr<std::atomic<uint32_t>[]> ip_active_;
+
+  // token bucket
+  std::mutex  token_lock_;
+  double      tokens_ = 0;
+  std::chrono::steady_clock::time_point token_time_ = std::chrono::steady_clock::now();
+
+  std::atomic<uint64_t> admitted_{0};
+  std::atomic<uint64_t> rejected_{0};
+  std::atomic<uint64_t> deferred_{0};
+};
+
+inline
+AdmissionControl::AdmissionControl(const AdmissionLimits &limits, const size_t &reactor_count)
+: limits_         (limits),
+  reactor_active_ (new std::atomic<size_t>[reactor_count > 0 ? reactor_count : 1]),
+  reactor_count_  (reactor_count > 0 ? reactor_count : 1)
+{
+  for (size_t index = 0; index < reactor_count_; ++index)
+    reactor_active_[index] = 0;
+
+  if (limits_.accept_burst == 0)
+    limits_.accept_burst = limits_.accept_rate;
+
+  tokens_ = limits_.accept_burst;
+
+  if (limits_.max_connections_per_ip > 0)
+  {
+    ip_active_.reset(new std::atomic<uint32_t>[IP_BUCKETS]);
+    for (size_t index = 0; index < IP_BUCKETS; ++index)
+      ip_active_[index] = 0;
+  }
+}
+
+inline size_t
+AdmissionControl::acquirable(int32_t &retry_msec)
+{
+  size_t count = SIZE_MAX;
+  retry_msec   = RETRY_MSEC;
+
+  if (limits_.max_connections > 0)
+  {
+    size_t active = active_.load(std::memory_order_relaxed);
+    count = active < limits_.max_connections ? limits_.max_connections - active : 0;
+  }
+
+  if (limits_.max_connections_per_reactor > 0)
+  {
+    size_t room = 0;
+    for (size_t index = 0; index < reactor_count_; ++index)
+    {
+      size_t active = reactor_active_[index].load(std::memory_order_relaxed);
+      if (active < limits_.max_connections_per_reactor)
+        room += limits_.max_connections_per_reactor - active;
+    }
+
+    if (room < count)
+      count = room;
+  }
+
+  if (limits_.accept_rate > 0 && count > 0)
+  {
+    std::lock_guard<std::mutex> guard(token_lock_);
+    refill_tokens();
+
+    if ((size_t)tokens_ < count)
+      count = (size_t)tokens_;
+
+    // the time to the next token
+    if (count == 0)
+      retry_msec = (int32_t)((1.0 - tokens_) * 1000 / limits_.accept_rate) + 1;
+  }
+
+  return count;
+}
+
+inline bool
+AdmissionControl::acquire_token()
+{
+  if (limits_.accept_rate == 0)
+    return true;
+
+  std::lock_guard<std::mutex> guard(token_lock_);
+  // the reactor acceptors admit without acquirable().
+  refill_tokens();
+  if (tokens_ < 1)
+    return false;
+
+  tokens_ -= 1;
+  return true;
+}
+
+inline void
+AdmissionControl::refill_tokens()
+{
+  std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+  double elapsed = std::chrono::duration<double>(now - token_time_).count();
+  token_time_ = now;
+
+  tokens_ += elapsed * limits_.accept_rate;
+  if (tokens_ > limits_.accept_burst)
+    tokens_ = limits_.accept_burst;
+}
+
+inline uint32_t
+AdmissionControl::ip_bucket(const sockaddr_storage &addr)
+{
+  const uint8_t *data = nullptr;
+  size_t        size  = 0;
+
+  if (addr.ss_family == AF_INET)
+  {
+    data = (const uint8_t *)&((const sockaddr_in *)&addr)->sin_addr;
+    size = sizeof(in_addr);
+  }
+  else if (addr.ss_family == AF_INET6)
+  {
+    data = (const uint8_t *)&((const sockaddr_in6 *)&addr)->sin6_addr;
+    size = sizeof(in6_addr);
+  }
+
+  // FNV-1a, see PeerHashBalancer
+  uint64_t hash = 0xCBF29CE484222325ULL;
+  for (size_t index = 0; index < size; ++index)
+  {
+    hash ^= data[index];
+    hash *= 0x100000001B3ULL;
+  }
+
+  hash ^= hash >> 33;
+  hash *= 0xFF51AFD7ED558CCDULL;
+  hash ^= hash >> 33;
+
+  return (uint32_t)(hash % IP_BUCKETS);
+}
+
+inline bool
+AdmissionControl::admit(size_t &reactor_index, const sockaddr_storage &addr, uint64_t &key)
+{
+  key = 0;
+
+  // the count is taken first, and given back if a limit is over.
+  if (limits_.max_connections > 0 &&
+      active_.fetch_add(1, std::memory_order_relaxed) >= limits_.max_connections)
+  {
+    active_.fetch_sub(1, std::memory_order_relaxed);
+    rejected_.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+
+  auto rollback = [&]()
+  {
+    if (limits_.max_connections > 0)
+      active_.fetch_sub(1, std::memory_order_relaxed);
+    rejected_.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  };
+
+  if (reactor_index >= reactor_count_)
+    reactor_index = 0;
+
+  if (limits_.max_connections_per_reactor > 0)
+  {
+    size_t count = 0;
+    for (; count < reactor_count_; ++count)
+    {
+      size_t index = (reactor_index + count) % reactor_count_;
+      if (reactor_active_[index].fetch_add(1, std::memory_order_relaxed) < limits_.max_connections_per_reactor)
+      {
+        reactor_index = index;
+        break;
+      }
+
+      reactor_active_[index].fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    if (count == reactor_count_)
+      return rollback();
+  }
+  else
+  {
+    reactor_active_[reactor_index].fetch_add(1, std::memory_order_relaxed);
+  }
+
+  // a unix domain socket has no source ip.
+  bool      per_ip = ip_active_ && (addr.ss_family == AF_INET || addr.ss_family == AF_INET6);
+  uint32_t  bucket = 0;
+  if (per_ip == true)
+  {
+    bucket = ip_bucket(addr);
+    if (ip_active_[bucket].fetch_add(1, std::memory_order_relaxed) >= limits_.max_connections_per_ip)
+    {
+      ip_active_[bucket].fetch_sub(1, std::memory_order_relaxed);
+      reactor_active_[reactor_index].fetch_sub(1, std::memory_order_relaxed);
+      return rollback();
+    }
+  }
+
+  // acquirable() has counted the token already unless another acceptor took it.
+  if (acquire_token() == false)
+  {
+    if (per_ip == true)
+      ip_active_[bucket].fetch_sub(1, std::memory_order_relaxed);
+    reactor_active_[reactor_index].fetch_sub(1, std::memory_order_relaxed);
+    return rollback();
+  }
+
+  if (limits_.max_connections == 0)
+    active_.fetch_add(1, std::memory_order_relaxed);
+
+  admitted_.fetch_add(1, std::memory_order_relaxed);
+  key = make_key(reactor_index, per_ip == true ? bucket : UINT32_MAX - 1);
+  return true;
+}
+
+inline void
+AdmissionControl::release(const uint64_t &key)
+{
+  if (key == 0)
+    return;
+
+  size_t    reactor_index = (size_t)(key >> 32) - 1;
+  uint32_t  bucket        = (uint32_t)(key & 0xFFFFFFFF) - 1;
+
+  active_.fetch_sub(1, std::memory_order_relaxed);
+
+  if (reactor_index < reactor_count_)
+    reactor_active_[reactor_index].fetch_sub(1, std::memory_order_relaxed);
+
+  if (ip_active_ && bucket < IP_BUCKETS)
+    ip_active_[bucket].fetch_sub(1, std::memory_order_relaxed);
+}
+
+inline void
+AdmissionControl::move(uint64_t &key, const size_t &reactor_index)
+{
+  if (key == 0 || reactor_index >= reactor_count_)
+    return;
+
+  size_t    from    = (size_t)(key >> 32) - 1;
+  uint32_t  bucket  = (uint32_t)(key & 0xFFFFFFFF) - 1;
+  if (from == reactor_index)
+    return;
+
+  if (from < reactor_count_)
+    reactor_active_[from].fetch_sub(1, std::memory_order_relaxed);
+
+  reactor_active_[reactor_index].fetch_add(1, std::memory_order_relaxed);
+  key = make_key(reactor_index, bucket);
+}
+
+inline AdmissionControl::Stats
+AdmissionControl::stats() const
+{
+  Stats stats;
+  stats.active    = active_  .load(std::memory_order_relaxed);
+  stats.admitted  = admitted_.load(std::memory_order_relaxed);
+  stats.rejected  = rejected_.load(std::memory_order_relaxed);
+  stats.deferred  = deferred_.load(std::memory_order_relaxed);
+  return stats;
+}
+
+}
+
+#endif /* IO_REACTOR_REACTOR_ACCEPTOR_ADMISSIONCONTROL_H_ */
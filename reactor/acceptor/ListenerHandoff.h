@@ -0,0 +1,195 @@
+/*
+ * ListenerHandoff.h
+ *
+ *  Created on: 2026. 10. 17.
+ *      Author: tys
+ */
+
+#ifndef IO_REACTOR_REACTOR_ACCEPTOR_LISTENERHANDOFF_H_
+#define IO_REACTOR_REACTOR_ACCEPTOR_LISTENERHANDOFF_H_
+
+#include <reactor/acceptor/Acceptor.h>
+
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace reactor
+{
+
+/**
+ * passes the listening sockets to a new process over a unix domain socket. (SCM_RIGHTS)
+ * the socket and its backlog are shared, no SYN is dropped while the processes change.
+ *
+ *   old process: send(path, handles), then drain. (TCPReactor::handoff)
+ *   new process: receive(path, handles), then Acceptor::listen_handle. (TCPReactor::set_handoff_path)
+ */
+class ListenerHandoff
+{
+public:
+  enum { MAX_HANDLES = 253 }; // SCM_MAX_FD
+
+  /**
+   * waits for the new process on path for timeout_msec (-1: forever),
+   * sends the io handles and closes the unix socket. the io handles are not closed.
+   * the socket file is 0600 and a peer of another user is refused. (SO_PEERCRED)
+   */
+  static bool send    (const std::string              &path,
+                       const std::vector<io_handle_t> &io_handles,
+                       const int32_t                  &timeout_msec = -1)
+  {
+    if (io_handles.size() == 0 || io_handles.size() > MAX_HANDLES)
+      return false;
+
+    Acceptor acceptor(false);
+    if (acceptor.listen_uds(path, true, 1, S_IRUSR | S_IWUSR) == false)
+      return false;
+
+    struct ::sockaddr_storage addr;
+    io_handle_t io_handle = acceptor.accept(addr, timeout_msec);
+
+    acceptor.close();
+    ::remove(path.c_str());
+
+    if (io_handle <= 0)
+      return false;
+
+    if (same_user(io_handle) == false)
+    {
+      ::close(io_handle);
+      return false;
+    }
+
+    bool result = send_handles(io_handle, io_handles);
+    ::close(io_handle);
+    return result;
+  }
+
+  // connects to path until timeout_msec and receives the io handles of the same user.
+  static bool receive (const std::string              &path,
+                       std::vector<io_handle_t>       &io_handles,
+                       const int32_t                  &timeout_msec = 5000)
+  {
+    struct sockaddr_un addr;
+    if (path.length() >= sizeof(addr.sun_path))
+      return false;
+
+    memset(&addr, 0x00, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, path.c_str());
+
+    std::chrono::steady_clock::time_point timeout_point =
+        std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_msec);
+
+    while (true)
+    {
+      io_handle_t io_handle = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+      if (io_handle < 0)
+        return false;
+
+      if (::connect(io_handle, (sockaddr *)&addr, sizeof(addr)) == 0)
+      {
+        bool result = same_user(io_handle) == true && recv_handles(io_handle, io_handles);
+        ::close(io_handle);
+        return result;
+      }
+
+      ::close(io_handle);
+
+      // the old process is not listening yet.
+      if (std::chrono::steady_clock::now() >= timeout_point)
+        return false;
+
+      std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    }
+  }
+
+  // the peer of the unix socket runs as the effective user of this process.
+  static bool same_user   (const io_handle_t              &io_handle)
+  {
+    struct ucred cred;
+    socklen_t size = sizeof(cred);
+    if (::getsockopt(io_handle, SOL_SOCKET, SO_PEERCRED, &cred, &size) < 0)
+      return false;
+
+    return cred.uid == ::geteuid();
+  }
+
+  static bool send_handles(const io_handle_t              &io_handle,
+                           const std::vector<io_handle_t> &io_handles)
+  {
+    uint32_t count = io_handles.size();
+
+    struct iovec iov;
+    iov.iov_base = &count;
+    iov.iov_len  = sizeof(count);
+
+    std::vector<char> control(CMSG_SPACE(sizeof(int) * count), 0);
+
+    struct msghdr msg;
+    memset(&msg, 0x00, sizeof(msg));
+    msg.msg_iov         = &iov;
+    msg.msg_iovlen      = 1;
+    msg.msg_control     = control.data();
+    msg.msg_controllen  = control.size();
+
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level  = SOL_SOCKET;
+    cmsg->cmsg_type   = SCM_RIGHTS;
+    cmsg->cmsg_len    = CMSG_LEN(sizeof(int) * count);
+    memcpy(CMSG_DATA(cmsg), io_handles.data(), sizeof(int) * count);
+
+    return ::sendmsg(io_handle, &msg, MSG_NOSIGNAL) == (ssize_t)sizeof(count);
+  }
+
+  static bool recv_handles(const io_handle_t              &io_handle,
+                           std::vector<io_handle_t>       &io_handles)
+  {
+    uint32_t count = 0;
+
+    struct iovec iov;
+    iov.iov_base = &count;
+    iov.iov_len  = sizeof(count);
+
+    std::vector<char> control(CMSG_SPACE(sizeof(int) * MAX_HANDLES), 0);
+
+    struct msghdr msg;
+    memset(&msg, 0x00, sizeof(msg));
+    msg.msg_iov         = &iov;
+    msg.msg_iovlen      = 1;
+    msg.msg_control     = control.data();
+    msg.msg_controllen  = control.size();
+
+    if (::recvmsg(io_handle, &msg, MSG_CMSG_CLOEXEC) != (ssize_t)sizeof(count))
+      return false;
+
+    io_handles.clear();
+    for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg); cmsg != nullptr; cmsg = CMSG_NXTHDR(&msg, cmsg))
+    {
+      if (cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS)
+        continue;
+
+      size_t size = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+      const int *handles = (const int *)CMSG_DATA(cmsg);
+      io_handles.insert(io_handles.end(), handles, handles + size);
+    }
+
+    if (io_handles.size() == count && (msg.msg_flags & MSG_CTRUNC) == 0)
+      return true;
+
+    for (const io_handle_t &handle : io_handles)
+      ::close(handle);
+
+    io_handles.clear();
+    return false;
+  }
+};
+
+}
+
+#endif /* IO_REACTOR_REACTOR_ACCEPTOR_LISTENERHANDOFF_H_ */
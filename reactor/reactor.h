@@ -9,6 +9,10 @@
 #define LIBS_IO_REACTOR_REACTOR_REACTOR_H_
 
 #include <reactor/acceptor/AcceptorThread.h>
+#include <reactor/acceptor/AcceptorHandler.h>
+#include <reactor/acceptor/AdmissionControl.h>
+#include <reactor/acceptor/ListenerHandoff.h>
+#include <reactor/ObjectPool.h>
 #include <reactor/Reactors.h>
 
 #endif /* LIBS_IO_REACTOR_REACTOR_REACTOR_H_ */
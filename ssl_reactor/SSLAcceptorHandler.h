@@ -0,0 +1,75 @@
+/*
+ * SSLAcceptorHandler.h
+ *
+ *  Created on: 2026. 10. 17.
+ *      Author: tys
+ */
+
+#ifndef IO_REACTOR_SSL_REACTOR_SSLACCEPTORHANDLER_H_
+#define IO_REACTOR_SSL_REACTOR_SSLACCEPTORHANDLER_H_
+
+#include <ssl_reactor/SSLAcceptorThread.h>
+
+#include <reactor/acceptor/AcceptorHandler.h>
+
+namespace reactor
+{
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wreorder"
+
+// listener of a reactor, see AcceptorHandler, SSLAcceptorThread.
+class SSLAcceptorHandler : public AcceptorHandler
+{
+public:
+  SSLAcceptorHandler(SSLSessionHandlerFactory &handler_factory,
+                     SSLContexts              &ssl_ctx_ptrs,
+                     Acceptor                 &acceptor,
+                     Reactors                 &reactors,
+                     const size_t             &reactor_index,
+                     const size_t             &handler_pool_size = 0);
+  virtual ~SSLAcceptorHandler() {}
+
+protected:
+  bool on_created_handler(EventHandler *, Reactor &, Reactors &, const size_t &) override;
+
+private:
+  SSLEventHandlerFactory  ssl_handler_factory_;
+  SSLContexts             ssl_ctx_ptrs_;
+};
+
+inline
+SSLAcceptorHandler::SSLAcceptorHandler(SSLSessionHandlerFactory &handler_factory,
+                                       SSLContexts              &ssl_ctx_ptrs,
+                                       Acceptor                 &acceptor,
+                                       Reactors                 &reactors,
+                                       const size_t             &reactor_index,
+                                       const size_t             &handler_pool_size)
+: ssl_handler_factory_(handler_factory, acceptor, reactors, handler_pool_size),
+  ssl_ctx_ptrs_       (ssl_ctx_ptrs),
+  // ssl_handler_factory_가 초기화 되어야 하므로 AcceptorHandler가 이후에 호출된다.
+  AcceptorHandler     (acceptor,
+                       reactors,
+                       reactor_index,
+                       ssl_handler_factory_)
+{
+}
+
+#pragma GCC diagnostic pop
+
+inline bool
+SSLAcceptorHandler::on_created_handler(EventHandler  *event_handler,
+                                       Reactor       &reactor,
+                                       Reactors      &reactors,
+                                       const size_t  &reactors_index)
+{
+  (void)reactors; (void)reactor;
+  SSL_CTX *ssl_ctx = ssl_ctx_ptrs_[reactors_index]->object();
+
+  SSLEventHandler *ssl_event_handler = static_cast<SSLEventHandler *>(event_handler);
+  return ssl_event_handler->init_ssl(ssl_ctx);
+}
+
+}
+
+#endif /* IO_REACTOR_SSL_REACTOR_SSLACCEPTORHANDLER_H_ */
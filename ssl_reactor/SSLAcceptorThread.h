@@ -52,7 +52,8 @@ public:
                     SSLContexts                   &ssl_ctx_ptrs,
                     Acceptor                      &acceptor,
                     Reactors                      &reactors,
-                    AcceptorThreadHandlerFactory  *acceptor_thread_handler_factory = nullptr);
+                    AcceptorThreadHandlerFactory  *acceptor_thread_handler_factory = nullptr,
+                    const size_t                  &handler_pool_size = 0);
   virtual ~SSLAcceptorThread() {}
 
 protected:
@@ -68,8 +69,9 @@ SSLAcceptorThread::SSLAcceptorThread(SSLSessionHandlerFactory     &handler_facto
                                      SSLContexts                  &ssl_ctx_ptrs,
                                      Acceptor                     &acceptor,
                                      Reactors                     &reactors,
-                                     AcceptorThreadHandlerFactory *acceptor_thread_handler_factory)
-: ssl_handler_factory_(handler_factory, acceptor, reactors),
+                                     AcceptorThreadHandlerFactory *acceptor_thread_handler_factory,
+                                     const size_t                 &handler_pool_size)
+: ssl_handler_factory_(handler_factory, acceptor, reactors, handler_pool_size),
   ssl_ctx_ptrs_       (ssl_ctx_ptrs),
   // ssl_handler_factory_가 초기화 되어야 하므로 AcceptorThread가 이후에 호출된다.
   AcceptorThread      (acceptor,
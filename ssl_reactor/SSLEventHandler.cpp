@@ -3,22 +3,80 @@
 
 using namespace reactor;
 
-SSLEventHandler::SSLEventHandler(SSLSessionHandler       *ssl_session,
-                                 const sockaddr_storage  &client_addr,
-                                 Acceptor                &acceptor,
-                                 Reactors                &reactors)
-: ssl_session_(ssl_session), addr_(client_addr), acceptor_(acceptor), reactors_(reactors)
+SSLEventHandler::SSLEventHandler(Acceptor &acceptor, Reactors &reactors)
+: acceptor_(acceptor), reactors_(reactors)
 {
-  shared_from_this_ = std::shared_ptr<SSLEventHandler>(this);
+  set_output_event_ = false;
+}
+
+SSLEventHandler *
+SSLEventHandler::create(SSLSessionHandler            *ssl_session,
+                        const sockaddr_storage       &client_addr,
+                        Acceptor                     &acceptor,
+                        Reactors                     &reactors,
+                        const SSLEventHandlerPoolPtr &pool)
+{
+  SSLEventHandler *handler = pool != nullptr ? pool->acquire() : nullptr;
+  if (handler == nullptr)
+    handler = new SSLEventHandler(acceptor, reactors);
+
+  handler->attach(ssl_session, client_addr, pool);
+  return handler;
+}
+
+void
+SSLEventHandler::attach(SSLSessionHandler             *ssl_session,
+                        const sockaddr_storage        &client_addr,
+                        const SSLEventHandlerPoolPtr  &pool)
+{
+  ssl_session_          = ssl_session;
+  addr_                 = client_addr;
+  close_                = false;
+  set_output_event_     = false;
+  close_after_sent_     = false;
+  io_handle_            = INVALID_IO_HANDLE;
+  reactor_              = nullptr;
+
+  // ssl_ is kept for SSL_clear. (init_ssl)
+  ssl_state_            = SSL_STATE::NONE;
+  ssl_accept_done_      = false;
+  ssl_read_want_write_  = false;
+
+  // a pooled handler keeps the capacity of its buffers.
+  auto reset_buffer = [](Bytes &buffer)
+  {
+    if (buffer.capacity() > POOLED_BUFFER_CAPACITY)
+      Bytes().swap(buffer);
+    buffer.clear();
+  };
+
+  reset_buffer(send_buffer_);
+  send_buffer_infos_.clear();
+  {
+    std::lock_guard<std::mutex> guard(send_buffers_prepare_lock_);
+    reset_buffer(send_buffers_prepare_);
+    send_buffers_prepare_info_.clear();
+  }
+
+  // see TCPEventHandler::attach
+  shared_from_this_ =
+      std::shared_ptr<SSLEventHandler>(this,
+                                       [pool](SSLEventHandler *handler)
+                                       {
+                                         if (pool == nullptr || pool->release(handler) == false)
+                                           delete handler;
+                                       });
 
   ssl_session_->ssl_handler_ = shared_from_this_;
   ssl_session_->set_socket_address(client_addr);
 
-  recv_buffer_.reserve(10240);
-  recv_buffer_.resize(10240);
-  send_buffers_prepare_.reserve(10240);
+  set_trigger_mode(ssl_session_->trigger_mode_);
 
-  set_output_event_ = false;
+  watermark_.set(ssl_session_->send_high_watermark_, ssl_session_->send_low_watermark_,
+                 ssl_session_->send_policy_);
+  watermark_.reset();
+  gauge_reactor_ = nullptr;
+  gauge_bytes_   = 0;
 }
 
 bool
@@ -45,6 +103,15 @@ void
 SSLEventHandler::handle_registered()
 {
   ssl_state_ = SSL_STATE::NONE;
+
+  // the buffers are allocated on the reactor thread, not the acceptor thread.
+  // (the numa node of the reactor, see Reactor::set_cpu_affinity)
+  recv_buffer_.resize(10240);
+  {
+    std::lock_guard<std::mutex> guard(send_buffers_prepare_lock_);
+    send_buffers_prepare_.reserve(10240);
+  }
+
   ssl_session_->handle_registered();
 }
 
@@ -54,13 +121,26 @@ SSLEventHandler::handle_removed()
   // 시스템으로부터 소켓이 재할당 되지 않도록 reactor에서 제거 된 후 close 한다.
   ssl_session_->handle_removed();
 
-  ::close(io_handle_);
+  update_queued_bytes(true);
+
+  // a late send() of the other threads is refused by sendable(), not registered on a reused io handle.
+  io_handle_t io_handle = io_handle_;
+  reactor_  = nullptr;
+  io_handle_= INVALID_IO_HANDLE;
+
+  ::close(io_handle);
   this->shared_from_this_.reset();
 }
 
 void
 SSLEventHandler::handle_input()
 {
+  if (edge_triggered() == true)
+  {
+    process_ssl_edge(true);
+    return;
+  }
+
   if (ssl_state_ == SSL_STATE::NONE)
     ssl_state_ = SSL_STATE::READ;
 
@@ -70,15 +150,39 @@ SSLEventHandler::handle_input()
 void
 SSLEventHandler::handle_output()
 {
-  if (ssl_state_ == SSL_STATE::NONE)
-    ssl_state_ = SSL_STATE::WRITE;
+  if (edge_triggered() == true)
+  {
+    process_ssl_edge(false);
+  }
+  else
+  {
+    if (ssl_state_ == SSL_STATE::NONE)
+      ssl_state_ = SSL_STATE::WRITE;
 
-  process_ssl();
+    process_ssl();
+  }
 
   bool comparand = true;
   bool exchanged = set_output_event_.compare_exchange_strong(comparand, false);
   if (exchanged == true)
     ssl_session_->handle_output();
+
+  if (close_after_sent_ == false)
+    return;
+
+  // the handshake is not done, nothing was sent.
+  if (ssl_accept_done_ == false || has_buffer_to_send() == false)
+  {
+    // see TCPEventHandler::handle_output, SO_LINGER 0 drops the unsent data.
+    struct linger solinger = { 0, 0 };
+    setsockopt(io_handle_, SOL_SOCKET, SO_LINGER, &solinger, sizeof(solinger));
+    close();
+    return;
+  }
+
+  // the rest was taken from send_buffers_prepare_, WANT_WRITE/READ comes back by itself.
+  if (ssl_state_ == SSL_STATE::NONE)
+    reactor_->register_writable(this);
 }
 
 void
@@ -107,6 +211,48 @@ SSLEventHandler::handle_shutdown()
   ssl_session_->handle_shutdown();
 }
 
+void
+SSLEventHandler::handle_drain()
+{
+  ssl_session_->handle_drain();
+}
+
+void
+SSLEventHandler::handle_idle(const IDLE_TYPE &type)
+{
+  ssl_session_->handle_idle(type);
+}
+
+void
+SSLEventHandler::handle_migrated()
+{
+  update_queued_bytes();
+
+  ssl_session_->handle_migrated();
+}
+
+void
+SSLEventHandler::update_queued_bytes(const bool &removed)
+{
+  Reactor *reactor = removed == true ? nullptr : reactor_.load();
+  size_t   bytes   = removed == true ? 0 : watermark_.bytes();
+
+  if (gauge_reactor_ != reactor)
+  {
+    if (gauge_reactor_ != nullptr)
+      gauge_reactor_->add_queued_bytes(-(int64_t)gauge_bytes_);
+
+    gauge_reactor_ = reactor;
+    gauge_bytes_   = 0;
+  }
+
+  if (gauge_reactor_ == nullptr || bytes == gauge_bytes_)
+    return;
+
+  gauge_reactor_->add_queued_bytes((int64_t)bytes - (int64_t)gauge_bytes_);
+  gauge_bytes_ = bytes;
+}
+
 inline void
 SSLEventHandler::process_ssl()
 {
@@ -124,6 +270,37 @@ SSLEventHandler::process_ssl()
   }
 }
 
+/**
+ * edge-triggered. 이벤트가 다시 오지 않으므로 read/write를 WANT_READ/WANT_WRITE까지 처리한다.
+ * 쓰기 이벤트에서는 이전 ssl_read가 WANT_WRITE였을때만 읽는다.
+ */
+void
+SSLEventHandler::process_ssl_edge(const bool &readable)
+{
+  bool accepted = false;
+  if (ssl_accept_done_ == false)
+  {
+    ssl_accept();
+    if (ssl_accept_done_ == false)
+      return;
+
+    // 협상과 같이 온 데이터가 있을 수 있음.
+    accepted = true;
+  }
+
+  if (readable == true || accepted == true || ssl_read_want_write_ == true)
+  {
+    ssl_state_ = SSL_STATE::READ;
+    ssl_read();
+  }
+
+  if (has_buffer_to_send() == true)
+  {
+    ssl_state_ = SSL_STATE::WRITE;
+    ssl_write();
+  }
+}
+
 void
 SSLEventHandler::ssl_accept()
 {
@@ -145,7 +322,7 @@ SSLEventHandler::ssl_accept()
       return;
 
     case SSLSocket::WANT_WRITE:
-      reactor_->register_writable(this);
+      reactor_->wait_writable(this);
       return;
 
     default: // COMPLETE
@@ -172,6 +349,8 @@ SSLEventHandler::ssl_accept()
 void
 SSLEventHandler::ssl_read()
 {
+  ssl_read_want_write_ = false;
+
   read_ssl_socket:
   int read_size = ssl_socket_.read(recv_buffer_.data(), recv_buffer_.size());
 
@@ -190,7 +369,8 @@ SSLEventHandler::ssl_read()
       return;
 
     case SSLSocket::WANT_WRITE:
-      reactor_->register_writable(this);
+      ssl_read_want_write_ = true;
+      reactor_->wait_writable(this);
       return;
 
     case SSLSocket::NONE:
@@ -207,8 +387,8 @@ SSLEventHandler::ssl_read()
       ssl_state_ = SSL_STATE::NONE;
       ssl_session_->handle_input(recv_buffer_.data(), read_size);
 
-      // 더 읽을게 있는지 체크.
-      if (read_size >= (int)recv_buffer_.size())
+      // 더 읽을게 있는지 체크. edge-triggered는 WANT_READ까지 읽는다.
+      if (edge_triggered() == true || read_size >= (int)recv_buffer_.size())
         goto read_ssl_socket;
 
       return;
@@ -219,12 +399,15 @@ SSLEventHandler::ssl_read()
 void
 SSLEventHandler::ssl_write()
 {
+  write_ssl_socket:
   if (has_buffer_to_send() == false)
   {
     ssl_state_ = SSL_STATE::NONE;
     return;
   }
 
+  update_queued_bytes();
+
   int write_size = ssl_socket_.write(send_buffer_.data(), send_buffer_.size());
 
   // 부하테스트 해봐야 함.
@@ -245,7 +428,7 @@ SSLEventHandler::ssl_write()
       return;
 
     case SSLSocket::WANT_WRITE:
-      reactor_->register_writable(this);
+      reactor_->wait_writable(this);
       return;
 
     case SSLSocket::ZERO_RETURN:
@@ -263,10 +446,19 @@ SSLEventHandler::ssl_write()
         ssl_session_->handle_sent(info.id, send_buffer_.data() + info.begin, info.length);
 
       // goto를 뺏다. 이벤트를 이쪽에서 잡고 있으면 read 기회를 잃을 수 있기 때문에...
+      bool writable = watermark_.sub(send_buffer_.size());
       send_buffer_.clear();
       send_buffer_infos_.clear();
 
+      update_queued_bytes();
+      if (writable == true)
+        ssl_session_->handle_writable();
+
       ssl_state_ = SSL_STATE::NONE;
+
+      // edge-triggered는 쓰기 이벤트가 다시 오지 않을 수 있다.
+      if (edge_triggered() == true)
+        goto write_ssl_socket;
       return;
     }
   }
@@ -12,37 +12,49 @@
 #include <ssl_reactor/SSLState.h>
 
 #include <reactor/acceptor/Acceptor.h>
+#include <reactor/ObjectPool.h>
 #include <reactor/Reactors.h>
 #include <reactor/EventHandler.h>
+#include <reactor/SendWatermark.h>
 #include <reactor/trace.h>
 
 #include <string>
+#include <deque>
 #include <arpa/inet.h>
 
 namespace reactor
 {
 
 class SSLSessionHandler;
+class SSLEventHandler;
 
 using Bytes = std::vector<uint8_t>;
 
+using SSLEventHandlerPool     = ObjectPool<SSLEventHandler>;
+using SSLEventHandlerPoolPtr  = std::shared_ptr<SSLEventHandlerPool>;
+
 class SSLEventHandler : public EventHandler
 {
 public:
   SSLEventHandler() = delete;
-  static SSLEventHandler *create(SSLSessionHandler       *ssl_session,
-                                 const sockaddr_storage  &client_addr,
-                                 Acceptor                &acceptor,
-                                 Reactors                &reactors)
-  {
-    return new SSLEventHandler(ssl_session, client_addr, acceptor, reactors);
-  }
+  /**
+   * see TCPEventHandler::create. a pooled handler keeps its SSL,
+   * init_ssl reuses it by SSL_clear if the SSL_CTX is the same.
+   */
+  static SSLEventHandler *create(SSLSessionHandler            *ssl_session,
+                                 const sockaddr_storage       &client_addr,
+                                 Acceptor                     &acceptor,
+                                 Reactors                     &reactors,
+                                 const SSLEventHandlerPoolPtr &pool = nullptr);
 
   virtual ~SSLEventHandler();
 
   bool init_ssl(SSL_CTX *ssl_ctx);
+  // false: closed, or refused by the send watermark. (see SSLSessionHandler::set_send_watermark)
   bool send    (const int32_t &id, const uint8_t *data, const size_t &size);
   bool close   ();
+  // closes after the queued data is sent. thread-safe.
+  bool close_after_sent();
   bool set_output_event();
 
   int direct_send(const uint8_t *data, const size_t &size);
@@ -52,12 +64,19 @@ public:
   Reactor         *reactor  () { return reactor_; }
   Reactors        &reactors () { return reactors_; }
   sockaddr_storage addr     () { return addr_; }
+  // bytes queued to send, see SSLSessionHandler::set_send_watermark.
+  const SendWatermark &watermark() const { return watermark_; }
 
 protected:
-  SSLEventHandler(SSLSessionHandler       *ssl_session,
-                  const sockaddr_storage  &client_addr,
-                  Acceptor                &acceptor,
-                  Reactors                &reactors);
+  SSLEventHandler(Acceptor &acceptor, Reactors &reactors);
+
+  // a new or pooled handler starts the connection of the session.
+  void attach(SSLSessionHandler             *ssl_session,
+              const sockaddr_storage        &client_addr,
+              const SSLEventHandlerPoolPtr  &pool);
+
+  // the send buffers of a pooled handler are freed over this capacity.
+  enum { POOLED_BUFFER_CAPACITY = 65536 };
 
 protected:
   void handle_registered() override;
@@ -68,9 +87,13 @@ protected:
   void handle_timeout   () override;
   void handle_error     (const int &error_no = 0, const std::string &error_str = "") override;
   void handle_shutdown  () override;
+  void handle_drain     () override;
+  void handle_idle      (const IDLE_TYPE &type) override;
+  void handle_migrated  () override;
 
 protected:
   std::atomic<bool> set_output_event_;
+  std::atomic<bool> close_after_sent_{false};
 
 protected:
   std::shared_ptr<SSLEventHandler> shared_from_this_;
@@ -83,12 +106,17 @@ protected:
   SSL_STATE ssl_state_ = SSL_STATE::NONE;
   SSLSocket ssl_socket_;
   bool      ssl_accept_done_ = false;
+  bool      ssl_read_want_write_ = false;
 
   void process_ssl();
+  void process_ssl_edge(const bool &readable);
   void ssl_accept ();
   void ssl_read   ();
   void ssl_write  ();
 
+  // see TCPEventHandler::update_queued_bytes
+  void update_queued_bytes(const bool &removed = false);
+
 protected:
   Bytes recv_buffer_;
 
@@ -109,6 +137,11 @@ protected:
   Bytes       send_buffers_prepare_;
   std::deque<send_buffer_info_t> send_buffers_prepare_info_;
 
+  // see TCPEventHandler::watermark_
+  SendWatermark watermark_;
+  Reactor      *gauge_reactor_ = nullptr;
+  size_t        gauge_bytes_   = 0;
+
   bool has_buffer_to_send()
   {
     if (send_buffer_.size() > 0)
@@ -166,7 +199,8 @@ SSLEventHandler::direct_send(const void *data, const size_t &size)
 inline bool
 SSLEventHandler::set_output_event()
 {
-  if (io_handle_ == INVALID_IO_HANDLE || reactor_ == nullptr || close_ == true)
+  Reactor *reactor = reactor_.load();
+  if (io_handle_ == INVALID_IO_HANDLE || reactor == nullptr || close_ == true)
     return false;
 
   bool comparand = false;
@@ -174,15 +208,23 @@ SSLEventHandler::set_output_event()
   if (exchanged == false)
     return false;
 
-  return reactor_->register_writable(this);
+  return reactor->register_writable(this);
 }
 
 inline bool
 SSLEventHandler::send(const int32_t &id, const uint8_t *data, const size_t &size)
 {
-  if (io_handle_ == INVALID_IO_HANDLE || reactor_ == nullptr || close_ == true)
+  Reactor *reactor = reactor_.load();
+  if (io_handle_ == INVALID_IO_HANDLE || reactor == nullptr || close_ == true)
     return false;
 
+  if (watermark_.add(size) == false)
+  {
+    if (watermark_.policy() == SendWatermark::POLICY_CLOSE)
+      close();
+    return false;
+  }
+
   {
     std::lock_guard<std::mutex> guard(send_buffers_prepare_lock_);
     size_t begin = send_buffers_prepare_.size();
@@ -190,11 +232,23 @@ SSLEventHandler::send(const int32_t &id, const uint8_t *data, const size_t &size
     send_buffers_prepare_info_.emplace_back(id, begin, size);
   }
 
-  reactor_->register_writable(this);
+  reactor->register_writable(this);
 
   return true;
 }
 
+inline bool
+SSLEventHandler::close_after_sent()
+{
+  Reactor *reactor = reactor_.load();
+  if (io_handle_ == INVALID_IO_HANDLE || reactor == nullptr || close_ == true)
+    return false;
+
+  // handle_output closes it when nothing is left.
+  close_after_sent_ = true;
+  return reactor->register_writable(this);
+}
+
 inline bool
 SSLEventHandler::close()
 {
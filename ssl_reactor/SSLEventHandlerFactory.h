@@ -18,10 +18,16 @@ namespace reactor
 class SSLEventHandlerFactory : public EventHandlerFactory
 {
 public:
+  // see TCPEventHandlerFactory
   SSLEventHandlerFactory(SSLSessionHandlerFactory &handler_factory,
                          Acceptor                 &acceptor,
-                         Reactors                 &reactors)
-  : factory_(handler_factory), acceptor_(acceptor), reactors_(reactors) {}
+                         Reactors                 &reactors,
+                         const size_t             &pool_size = 0)
+  : factory_(handler_factory), acceptor_(acceptor), reactors_(reactors)
+  {
+    if (pool_size > 0)
+      pool_ = std::make_shared<SSLEventHandlerPool>(pool_size);
+  }
   virtual ~SSLEventHandlerFactory() {}
 
   EventHandler *create(const io_handle_t      &client_io_handle,
@@ -36,7 +42,7 @@ public:
 
     try
     {
-      return SSLEventHandler::create(session, client_addr, acceptor_, reactors_);
+      return SSLEventHandler::create(session, client_addr, acceptor_, reactors_, pool_);
     }
     catch (std::runtime_error &e)
     {
@@ -51,6 +57,7 @@ protected:
   SSLSessionHandlerFactory &factory_;
   Acceptor  &acceptor_;
   Reactors  &reactors_;
+  SSLEventHandlerPoolPtr pool_;
 };
 
 }
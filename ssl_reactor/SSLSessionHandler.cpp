@@ -10,6 +10,12 @@ SSLSessionHandler::acceptor()
   return ssl_handler_->acceptor();
 }
 
+bool
+SSLSessionHandler::edge_triggered() const
+{
+  return ssl_handler_->edge_triggered();
+}
+
 Reactor *
 SSLSessionHandler::reactor()
 {
@@ -84,12 +90,13 @@ void
 SSLSessionHandler::handle_timeout()
 {
   int32_t min_msec = 0;
+  std::vector<int64_t> timeouts;
   while ((min_msec = timer_.get_min_timeout_milliseconds()) == 0)
   {
-    std::deque<std::unordered_set<int64_t>> timeouts = timer_.extract_timeout_objects();
-    for (const auto &keys : timeouts)
-      for (const auto &key : keys)
-        this->handle_timeout(key);
+    timeouts.clear();
+    timer_.extract_timeout_objects(timeouts);
+    for (const int64_t &key : timeouts)
+      this->handle_timeout(key);
   }
 
 //  reactor_trace << min_msec;
@@ -111,6 +118,51 @@ SSLSessionHandler::close()
   return ssl_handler_->close();
 }
 
+bool
+SSLSessionHandler::close_after_sent()
+{
+  return ssl_handler_->close_after_sent();
+}
+
+bool
+SSLSessionHandler::migrate(const size_t &reactor_index)
+{
+  return ssl_handler_->reactors().migrate(ssl_handler_.get(), reactor_index);
+}
+
+int32_t
+SSLSessionHandler::reactor_index() const
+{
+  return ssl_handler_->reactors().reactor_index(ssl_handler_->reactor());
+}
+
+size_t
+SSLSessionHandler::send_queued_bytes() const
+{
+  return ssl_handler_->watermark().bytes();
+}
+
+bool
+SSLSessionHandler::send_blocked() const
+{
+  return ssl_handler_->watermark().blocked();
+}
+
+void
+SSLSessionHandler::reuse_session(const struct sockaddr_storage &addr)
+{
+  set_socket_address(addr);
+  handle_reused();
+}
+
+void
+SSLSessionHandler::release_session()
+{
+  // the event handler goes back to its pool.
+  timer_.clear();
+  ssl_handler_.reset();
+}
+
 void
 SSLSessionHandler::set_socket_address(const struct sockaddr_storage &addr)
 {
@@ -10,7 +10,9 @@
 
 #include <ssl_reactor/SSLState.h>
 #include <reactor/acceptor/Acceptor.h>
+#include <reactor/EventHandler.h>
 #include <reactor/ObjectsTimer.h>
+#include <reactor/SendWatermark.h>
 #include <reactor/trace.h>
 
 #include <vector>
@@ -91,6 +93,28 @@ protected:
    * Reactor의 shutdown이 되었을때 호출됨.
    */
   virtual void handle_shutdown  () = 0;
+  /**
+   * SessionPool에서 새 접속에 재사용될때 호출됨. 이전 접속의 상태를 초기화한다.
+   * peer 주소는 새 접속의 것으로 바뀌어 있음.
+   */
+  virtual void handle_reused    () {}
+  /**
+   * Reactor::drain으로 서버가 종료중일때 호출됨. 기본 동작은 close_after_sent().
+   * TCPSessionHandler::handle_drain, Https1Handler 참고.
+   */
+  virtual void handle_drain     () { close_after_sent(); }
+  // TCPSessionHandler::handle_idle 참고
+  virtual void handle_idle      (const EventHandler::IDLE_TYPE &type)
+  {
+    if (type == EventHandler::IDLE_TIMEOUT)
+      close();
+    else
+      close_after_sent();
+  }
+  // TCPSessionHandler::handle_migrated 참고
+  virtual void handle_migrated  () {}
+  // TCPSessionHandler::handle_writable 참고
+  virtual void handle_writable  () {}
 
 public:
   const Acceptor &acceptor();
@@ -105,6 +129,32 @@ public:
   void handle_timeout   ();
   bool set_output_event ();
   bool close            ();
+  // closes after the queued data is sent.
+  bool close_after_sent ();
+  // see Reactors::migrate. handle_migrated on the new reactor.
+  bool migrate          (const size_t &reactor_index);
+  // index of the reactor serving this session in Reactors, -1: not registered.
+  int32_t reactor_index () const;
+
+  /**
+   * call in the constructor. see EventHandler::TRIGGER_MODE.
+   * edge-triggered mode reads and writes until WANT_READ/WANT_WRITE.
+   */
+  void set_trigger_mode (const EventHandler::TRIGGER_MODE &mode) { trigger_mode_ = mode; }
+  bool edge_triggered   () const;
+
+  // call in the constructor. see TCPSessionHandler::set_send_watermark.
+  void set_send_watermark(const size_t &high, const size_t &low,
+                          const SendWatermark::POLICY &policy = SendWatermark::POLICY_REJECT)
+  {
+    send_high_watermark_ = high;
+    send_low_watermark_  = low;
+    send_policy_         = policy;
+  }
+  // bytes queued to send, not written yet. thread-safe.
+  size_t send_queued_bytes() const;
+  // over the high watermark, send() is refused until handle_writable(). thread-safe.
+  bool   send_blocked     () const;
 
   bool is_ipv6() const { return ipv6_; }
   bool is_ipv4() const { return ipv4_; }
@@ -122,8 +172,16 @@ protected:
 private:
   void set_socket_address(const struct ::sockaddr_storage &client_addr);
 
+  // SessionPool
+  void reuse_session     (const struct ::sockaddr_storage &client_addr);
+  void release_session   ();
+
 private:
   ObjectsTimer<int64_t> timer_;
+  EventHandler::TRIGGER_MODE trigger_mode_ = EventHandler::TRIGGER_REACTOR_DEFAULT;
+  size_t                     send_high_watermark_ = 0;
+  size_t                     send_low_watermark_  = 0;
+  SendWatermark::POLICY      send_policy_ = SendWatermark::POLICY_REJECT;
 
 private:
   std::string peer_addr_;
@@ -140,6 +198,7 @@ private:
 private:
   std::shared_ptr<SSLEventHandler> ssl_handler_;
   friend class SSLEventHandler;
+  template<typename> friend class SessionPool;
 };
 
 }
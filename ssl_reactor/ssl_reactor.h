@@ -9,6 +9,7 @@
 #define IO_REACTOR_SSL_REACTOR_SSL_REACTOR_H_
 
 #include <ssl_reactor/SSLAcceptorThread.h>
+#include <ssl_reactor/SSLAcceptorHandler.h>
 #include <ssl_reactor/SSLSessionHandler.h>
 
 #endif /* LIBS_SSL_REACTOR_SSL_REACTOR_H_ */
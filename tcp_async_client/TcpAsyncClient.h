@@ -9,8 +9,10 @@
 #define IO_REACTOR_REACTOR_TCPASYNCCLIENT_H_
 
 #include <tcp_async_client/TcpAsyncEventHandler.h>
+#include <reactor/SendWatermark.h>
 
 #include <vector>
+#include <deque>
 #include <functional>
 
 namespace reactor
@@ -33,12 +35,30 @@ public:
                                        const int32_t      &timeout_msec = 5000);
   bool          disconnect            ();
   void          set_timeout           (const uint32_t &msec);
+  /**
+   * the data is copied to a send buffer and written by send(). no MSG_ZEROCOPY
+   * (see TCPSessionHandler::set_zerocopy): the buffer is moved and reused while the kernel
+   * would still refer to its pages, a zerocopy send needs the data kept until its completion.
+   * the client takes the copy of its small requests. for large data use a TCPSessionHandler.
+   */
   bool          send                  (const int32_t &stream_id, const uint8_t *data, const size_t &size);
   bool          send                  (const int32_t &stream_id, const void    *data, const size_t &size);
   bool          send                  (const int32_t &stream_id, const std::string &data);
   bool          is_connect            () const;
   void          close                 () { ::shutdown(handler_.io_handle(), SHUT_WR); }
 
+  /**
+   * call before connect(). see TCPSessionHandler::set_send_watermark.
+   * POLICY_CLOSE: close(), the output is shut down.
+   */
+  void          set_send_watermark    (const size_t &high, const size_t &low,
+                                       const SendWatermark::POLICY &policy = SendWatermark::POLICY_REJECT)
+  { watermark_.set(high, low, policy); }
+  // bytes queued to send, not written yet.
+  size_t        send_queued_bytes     () const { return watermark_.bytes(); }
+  // over the high watermark, send() is refused until handle_writable().
+  bool          send_blocked          () const { return watermark_.blocked(); }
+
   std::string   local_addr_port       () const { return handler_.local_addr_port(); }
   std::string   local_addr            () const { return handler_.local_addr(); }
   uint16_t      local_port            () const { return handler_.local_port(); }
@@ -56,14 +76,19 @@ protected:
   virtual void  handle_error          (const int &err_no, const std::string &err_str) = 0;
   virtual void  handle_timeout        () = 0;
   virtual void  handle_shutdown       () = 0;
+  // set_send_watermark, the queue went under the low watermark after a send was refused.
+  virtual void  handle_writable       () {}
 
 protected:
   void  on_connect();
   void  on_input  ();
   void  on_output ();
+  void  on_disconnect();
 
 private:
   bool  has_buffer_to_send();
+  // the queued bytes to the gauge of the reactor. (Reactor::queued_bytes)
+  void  update_queued_bytes();
 
 private:
   using Bytes_ = std::vector<uint8_t>;
@@ -87,6 +112,9 @@ private:
   Bytes_      send_buffers_prepare_;
   std::deque<send_buffer_info_t> send_buffers_prepare_info_;
 
+  SendWatermark watermark_;
+  size_t        gauge_bytes_ = 0;
+
   void init_buffers();
 
 private:
@@ -102,6 +130,20 @@ TcpAsyncClient::init_buffers()
   std::lock_guard<std::mutex> guard(send_buffers_prepare_lock_);
   send_buffers_prepare_.clear();
   send_buffers_prepare_info_.clear();
+
+  watermark_.reset();
+  update_queued_bytes();
+}
+
+inline void
+TcpAsyncClient::update_queued_bytes()
+{
+  size_t bytes = watermark_.bytes();
+  if (bytes == gauge_bytes_)
+    return;
+
+  reactor_.add_queued_bytes((int64_t)bytes - (int64_t)gauge_bytes_);
+  gauge_bytes_ = bytes;
 }
 
 inline
@@ -113,7 +155,7 @@ TcpAsyncClient::TcpAsyncClient(Reactor &reactor, const size_t &recv_buffer_size)
   handler_.on_connect         = std::bind(&TcpAsyncClient::on_connect,            this);
   handler_.on_connect_error   = std::bind(&TcpAsyncClient::handle_connect_error,  this, std::placeholders::_1, std::placeholders::_2);
   handler_.on_connect_timeout = std::bind(&TcpAsyncClient::handle_connect_timeout,this, std::placeholders::_1, std::placeholders::_2);
-  handler_.on_disconnect      = std::bind(&TcpAsyncClient::handle_disconnect,     this);
+  handler_.on_disconnect      = std::bind(&TcpAsyncClient::on_disconnect,         this);
   handler_.on_timeout         = std::bind(&TcpAsyncClient::handle_timeout,        this);
   handler_.on_input           = std::bind(&TcpAsyncClient::on_input ,             this);
   handler_.on_output          = std::bind(&TcpAsyncClient::on_output,             this);
@@ -153,6 +195,13 @@ TcpAsyncClient::send(const int32_t &stream_id, const uint8_t *data, const size_t
   if (size == 0 || handler_.io_handle() == INVALID_IO_HANDLE || this->is_connect() == false)
     return false;
 
+  if (watermark_.add(size) == false)
+  {
+    if (watermark_.policy() == SendWatermark::POLICY_CLOSE)
+      close();
+    return false;
+  }
+
   {
     std::lock_guard<std::mutex> guard(send_buffers_prepare_lock_);
     size_t begin = send_buffers_prepare_.size();
@@ -183,6 +232,16 @@ TcpAsyncClient::on_connect()
   handle_connect();
 }
 
+inline void
+TcpAsyncClient::on_disconnect()
+{
+  // the data not sent is left, it is cleared by the next connect.
+  watermark_.reset();
+  update_queued_bytes();
+
+  handle_disconnect();
+}
+
 inline void
 TcpAsyncClient::on_input()
 {
@@ -190,6 +249,19 @@ TcpAsyncClient::on_input()
 
   ssize_t recv_size = ::recv(handler_.io_handle(), recv_buffer_.data(), recv_buffer_.size(), 0);
 
+  // 0 is EOF, handle_disconnect is called by the close event.
+  if (recv_size <= 0)
+  {
+    int err_no = errno;
+    recv_buffer_.clear();
+    if (recv_size < 0 && err_no != EAGAIN)
+    {
+      char str[256];
+      handle_error(err_no, strerror_r(err_no, str, sizeof(str)));
+    }
+    return;
+  }
+
   recv_buffer_.resize(recv_size);
   handle_recv(recv_buffer_);
 }
@@ -200,6 +272,8 @@ TcpAsyncClient::on_output()
   if (has_buffer_to_send() == false)
     return;
 
+  update_queued_bytes();
+
   int write_size = ::send(handler_.io_handle(),
                           send_buffer_.data() + sent_size_,
                           send_buffer_.size() - sent_size_, 0);
@@ -222,6 +296,12 @@ TcpAsyncClient::on_output()
   }
 
   sent_size_ += write_size;
+
+  bool writable = watermark_.sub(write_size);
+  update_queued_bytes();
+  if (writable == true)
+    handle_writable();
+
   if ((ssize_t)send_buffer_.size() < sent_size_)
     return;
 
@@ -17,7 +17,12 @@ namespace reactor
 class TcpAsyncEventHandler : public EventHandler
 {
 public:
-  TcpAsyncEventHandler() { memset(local_addr_, 0x00, sizeof(local_addr_)); }
+  // the client reads once per event.
+  TcpAsyncEventHandler()
+  {
+    memset(local_addr_, 0x00, sizeof(local_addr_));
+    set_trigger_mode(TRIGGER_LEVEL);
+  }
   virtual ~TcpAsyncEventHandler() {}
 
   virtual bool  prepare_socket  (const std::string  &host,
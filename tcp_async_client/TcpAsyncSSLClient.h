@@ -15,6 +15,7 @@
 
 #include <string_view>
 #include <vector>
+#include <deque>
 #include <functional>
 
 namespace reactor
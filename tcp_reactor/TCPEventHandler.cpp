@@ -1,31 +1,103 @@
 #include "TCPEventHandler.h"
 #include "TCPSessionHandler.h"
-#include <functional>
+#include <algorithm>
+#include <sys/uio.h>
+#include <sys/sendfile.h>
+#include <fcntl.h>
+#include <linux/errqueue.h>
+#include <netinet/in.h>
 
 using namespace reactor;
 
-TCPEventHandler::TCPEventHandler(TCPSessionHandler       *session,
-                                 const sockaddr_storage  &client_addr,
-                                 Acceptor                &acceptor,
-                                 Reactors                &reactors)
-: session_(session), addr_(client_addr), acceptor_(acceptor), reactors_(reactors)
+TCPEventHandler::TCPEventHandler(Acceptor &acceptor, Reactors &reactors)
+: acceptor_(acceptor), reactors_(reactors)
 {
-  shared_from_this_         = std::shared_ptr<TCPEventHandler>(this);
-  session_->event_handler_  = shared_from_this_;
+  set_output_event_ = false;
+}
 
-  send_buffer_         .reserve(10240);
-  send_buffers_prepare_.reserve(10240);
+TCPEventHandler *
+TCPEventHandler::create(TCPSessionHandler            *session,
+                        const sockaddr_storage       &client_addr,
+                        Acceptor                     &acceptor,
+                        Reactors                     &reactors,
+                        const TCPEventHandlerPoolPtr &pool)
+{
+  TCPEventHandler *handler = pool != nullptr ? pool->acquire() : nullptr;
+  if (handler == nullptr)
+    handler = new TCPEventHandler(acceptor, reactors);
+
+  handler->attach(session, client_addr, pool);
+  return handler;
+}
 
+void
+TCPEventHandler::attach(TCPSessionHandler             *session,
+                        const sockaddr_storage        &client_addr,
+                        const TCPEventHandlerPoolPtr  &pool)
+{
+  session_          = session;
+  addr_             = client_addr;
+  close_            = false;
   set_output_event_ = false;
+  close_after_sent_ = false;
+  io_handle_        = INVALID_IO_HANDLE;
+  reactor_          = nullptr;
+
+  // a pooled handler keeps the capacity of its buffers.
+  send_queue_.clear();
+  send_queue_.shrink(POOLED_BUFFER_CAPACITY);
+  sending_ = false;
+  {
+    std::lock_guard<std::mutex> guard(send_queue_prepare_lock_);
+    send_queue_prepare_.clear();
+    send_queue_prepare_.shrink(POOLED_BUFFER_CAPACITY);
+    send_queue_prepared_ = false;
+  }
+
+  // the last reference of the session and the reactor gives it back to the pool.
+  shared_from_this_ =
+      std::shared_ptr<TCPEventHandler>(this,
+                                       [pool](TCPEventHandler *handler)
+                                       {
+                                         if (pool == nullptr || pool->release(handler) == false)
+                                           delete handler;
+                                       });
+
+  session_->event_handler_ = shared_from_this_;
+
+  set_trigger_mode   (session_->trigger_mode_);
+  set_recv_completion(session_->recv_completion_);
+
+  zerocopy_size_ = session_->zerocopy_size_;
+  zerocopy_seq_  = 0;
+  zerocopy_used_ = false;
+
+  watermark_.set(session_->send_high_watermark_, session_->send_low_watermark_, session_->send_policy_);
+  watermark_.reset();
+  gauge_reactor_ = nullptr;
+  gauge_bytes_   = 0;
 }
 
 void
 TCPEventHandler::handle_registered()
 {
-  send_buffer_.clear();
-  send_buffer_.reserve(10240);
+  // the buffers are allocated on the reactor thread, not the acceptor thread.
+  // (the numa node of the reactor, see Reactor::set_cpu_affinity)
+  send_queue_.reserve(10240);
+  {
+    std::lock_guard<std::mutex> guard(send_queue_prepare_lock_);
+    send_queue_prepare_.reserve(10240);
+  }
+
+  set_zerocopy();
 
   session_->handle_registered();
+
+  // deferred accept, the first request has arrived already. it is read now,
+  // not after an epoll round. (the io_uring recv completion receives it by itself)
+  if (acceptor_.options().defer_accept_sec > 0 &&
+      (recv_completion() == false || reactor_->engine() != Reactor::IoDemuxer::ENGINE_IO_URING))
+    handle_input();
 }
 
 void
@@ -34,7 +106,14 @@ TCPEventHandler::handle_removed()
   // 시스템으로부터 소켓이 재할당 되지 않도록 reactor에서 제거 된 후 close 한다.
   session_->handle_removed();
 
-  ::close(io_handle_);
+  update_queued_bytes(true);
+
+  // a late send() of the other threads is refused by sendable(), not registered on a reused io handle.
+  io_handle_t io_handle = io_handle_;
+  reactor_  = nullptr;
+  io_handle_= INVALID_IO_HANDLE;
+
+  ::close(io_handle);
   this->shared_from_this_.reset();
 }
 
@@ -44,6 +123,12 @@ TCPEventHandler::handle_input()
   session_->handle_input();
 }
 
+void
+TCPEventHandler::handle_recv(const uint8_t *data, const size_t &size)
+{
+  session_->handle_recv(data, size);
+}
+
 void
 TCPEventHandler::handle_output()
 {
@@ -52,62 +137,269 @@ TCPEventHandler::handle_output()
   if (exchanged == true)
     session_->handle_output();
 
-//  while (true)
-//  {
+  send_buffers();
+
+  if (close_after_sent_ == true && has_buffer_to_send() == false &&
+      send_queue_.zerocopy_pending() == false)
+  {
+    // the connections inherit SO_LINGER 0 of the listener,
+    // the kernel would drop the data not sent yet and reset the connection.
+    struct linger solinger = { 0, 0 };
+    setsockopt(io_handle_, SOL_SOCKET, SO_LINGER, &solinger, sizeof(solinger));
+    close();
+  }
+}
+
+size_t
+TCPEventHandler::send(TCPEventHandler *const    *handlers,
+                      const int32_t             *stream_ids,
+                      const size_t              &count,
+                      const SendQueue::BytesPtr &data,
+                      bool                      *results)
+{
+  if (data == nullptr)
+    return 0;
+
+  // the handlers waiting for the writable event, by reactor.
+  std::vector<std::pair<Reactor *, EventHandler *>> writables;
+  writables.reserve(count);
+
+  size_t queued = 0;
+  for (size_t index = 0; index < count; ++index)
+  {
+    TCPEventHandler *handler = handlers[index];
+
+    bool writable = false;
+    bool result   = handler->enqueue(data->size(),
+                                     [&](SendQueue &queue) { queue.push(stream_ids[index], data); },
+                                     writable);
+    if (result == true)
+      ++queued;
+
+    if (writable == true)
+      writables.emplace_back(handler->reactor_.load(), handler);
+
+    if (results != nullptr)
+      results[index] = result;
+  }
+
+  std::stable_sort(writables.begin(), writables.end(),
+                   [](const std::pair<Reactor *, EventHandler *> &lhs,
+                      const std::pair<Reactor *, EventHandler *> &rhs)
+                   { return lhs.first < rhs.first; });
+
+  std::vector<EventHandler *> batch;
+  for (size_t begin = 0, end = 0; begin < writables.size(); begin = end)
+  {
+    batch.clear();
+    for (end = begin; end < writables.size() && writables[end].first == writables[begin].first; ++end)
+      batch.push_back(writables[end].second);
+
+    writables[begin].first->register_writables(batch.data(), batch.size());
+  }
+
+  return queued;
+}
+
+void
+TCPEventHandler::send_buffers()
+{
   if (has_buffer_to_send() == false)
     return;
 
-  int sent_size =::send(this->io_handle_, send_buffer_.data(), send_buffer_.size(), 0);
-  if (sent_size <= 0)
+  // send() of handle_sent goes to send_queue_prepare_, send_queue_ is being consumed.
+  sending_ = true;
+  struct ScopeExit
+  {
+    ScopeExit(bool &sending) : sending_(sending) {}
+    ~ScopeExit() { sending_ = false; }
+    bool &sending_;
+  } scope_exit(sending_);
+
+  // edge-triggered: EAGAIN이 될때까지 보낸다.
+  while (true)
+  {
+    if (send_buffer_once() == false)
+      break;
+
+    if (has_buffer_to_send() == false)
+      break;
+
+    // 다른 event기회를 주기위해  while문으로 처리 안하고register_writable를 호출함.
+    if (edge_triggered() == false)
+    {
+      reactor_->register_writable(this);
+      break;
+    }
+  }
+
+  update_queued_bytes();
+}
+
+bool
+TCPEventHandler::send_buffer_once()
+{
+  struct iovec iov[SendQueue::MAX_IOV];
+
+  int64_t zerocopy_seq = -1;
+  int     count = 0;
+  ssize_t sent_size = 0;
+
+  const SendQueue::Segment *file = send_queue_.file_segment();
+  if (file != nullptr)
+  {
+    sent_size = send_file(*file);
+  }
+  else if (zerocopy_size_ > 0 &&
+           (count = send_queue_.zerocopy_iovecs(iov, SendQueue::MAX_IOV, zerocopy_size_)) > 0)
+  {
+    struct msghdr msg = {};
+    msg.msg_iov     = iov;
+    msg.msg_iovlen  = count;
+
+    sent_size = ::sendmsg(this->io_handle_, &msg, MSG_ZEROCOPY);
+    if (sent_size > 0)
+    {
+      zerocopy_seq   = zerocopy_seq_++;
+      zerocopy_used_ = true;
+    }
+    // optmem_max is full, it is copied this time.
+    else if (sent_size < 0 && errno == ENOBUFS)
+      sent_size = ::writev(this->io_handle_, iov, count);
+  }
+  else
+  {
+    count = send_queue_.iovecs(iov, SendQueue::MAX_IOV, zerocopy_size_);
+    if (count > 0)
+      sent_size = ::writev(this->io_handle_, iov, count);
+  }
+
+  if (sent_size < 0)
   {
     int err_no = errno;
     if (err_no == EAGAIN)
     {
-      reactor_->register_writable(this);
-      return;
+      reactor_->wait_writable(this);
+      return false;
     }
 
     char str[256];
     std::string err_str = ::strerror_r(err_no, str, sizeof(str));
 
-    for (const send_buffer_info_t &info : send_buffer_infos_)
-      session_->handle_sent_error(err_no, err_str, info.stream_id, send_buffer_.data() + info.begin, info.length);
+    send_queue_.clear([&](const SendQueue::Segment &segment)
+    { session_->handle_sent_error(err_no, err_str, segment.stream_id, segment.data(), segment.length); });
+    watermark_.reset();
 
     ::shutdown(io_handle_, SHUT_RD);
+    return false;
+  }
+
+  send_queue_.consume(sent_size,
+                      [&](const SendQueue::Segment &segment)
+                      { session_->handle_sent(segment.stream_id, segment.data(), segment.length); },
+                      zerocopy_seq);
+
+  // the file regions are not counted.
+  if (file == nullptr && watermark_.sub(sent_size) == true)
+    session_->handle_writable();
+
+  return true;
+}
+
+void
+TCPEventHandler::update_queued_bytes(const bool &removed)
+{
+  Reactor *reactor = removed == true ? nullptr : reactor_.load();
+  size_t   bytes   = removed == true ? 0 : watermark_.bytes();
+
+  // migrated or removed, the bytes leave the gauge of the reactor.
+  if (gauge_reactor_ != reactor)
+  {
+    if (gauge_reactor_ != nullptr)
+      gauge_reactor_->add_queued_bytes(-(int64_t)gauge_bytes_);
+
+    gauge_reactor_ = reactor;
+    gauge_bytes_   = 0;
+  }
+
+  if (gauge_reactor_ == nullptr || bytes == gauge_bytes_)
     return;
+
+  gauge_reactor_->add_queued_bytes((int64_t)bytes - (int64_t)gauge_bytes_);
+  gauge_bytes_ = bytes;
+}
+
+ssize_t
+TCPEventHandler::send_file(const SendQueue::Segment &segment)
+{
+  size_t length = segment.length - segment.sent;
+  off_t  offset = segment.begin + segment.sent;
+
+  // a regular file, EAGAIN is of the socket.
+  ssize_t sent_size = ::sendfile(this->io_handle_, segment.file->fd(), &offset, length);
+
+  // the file is shorter than the region.
+  if (sent_size == 0)
+  {
+    errno = ENODATA;
+    return -1;
   }
 
-  struct ScopeExit
+  return sent_size;
+}
+
+void
+TCPEventHandler::set_zerocopy()
+{
+  if (zerocopy_size_ == 0)
+    return;
+
+  int one = 1;
+  if (::setsockopt(io_handle_, SOL_SOCKET, SO_ZEROCOPY, &one, sizeof(one)) != 0)
   {
-    ScopeExit(std::function<void()> exit_func) : exit_func_(exit_func) {}
-    ~ScopeExit() { exit_func_(); }
-    std::function<void()> exit_func_;
-  };
+    zerocopy_size_ = 0;
+    return;
+  }
 
-  ScopeExit scope_exit([&]()
-  { send_buffer_.erase(send_buffer_.begin(), send_buffer_.begin() + sent_size); });
+  // the io_uring recv completion does not poll the io handle by itself.
+  reactor_->register_error_event(this);
+}
 
-  ssize_t sent_info_size = sent_size;
-  for (auto it = send_buffer_infos_.begin(); it != send_buffer_infos_.end();)
+bool
+TCPEventHandler::read_error_queue()
+{
+  bool completed = false;
+  while (true)
   {
-    send_buffer_info_t &info = *it;
+    char control[CMSG_SPACE(sizeof(struct sock_extended_err)) * 4];
+    struct msghdr msg = {};
+    msg.msg_control     = control;
+    msg.msg_controllen  = sizeof(control);
 
-    sent_info_size -= info.sent_remain;
-    if (sent_info_size < 0)
+    // EAGAIN: no more.
+    if (::recvmsg(io_handle_, &msg, MSG_ERRQUEUE) < 0)
+      return completed;
+
+    for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg); cmsg != nullptr; cmsg = CMSG_NXTHDR(&msg, cmsg))
     {
-      info.sent_remain = -sent_info_size;
-      break;
-    }
+      if ((cmsg->cmsg_level != SOL_IP   || cmsg->cmsg_type != IP_RECVERR) &&
+          (cmsg->cmsg_level != SOL_IPV6 || cmsg->cmsg_type != IPV6_RECVERR))
+        continue;
 
-    session_->handle_sent(info.stream_id, send_buffer_.data() + info.begin, info.length);
-    it = send_buffer_infos_.erase(it);
-  }
+      const struct sock_extended_err *err = (const struct sock_extended_err *)CMSG_DATA(cmsg);
+      if (err->ee_errno != 0 || err->ee_origin != SO_EE_ORIGIN_ZEROCOPY)
+        continue;
 
-  // 다른 event기회를 주기위해  while문으로 처리 안하고register_writable를 호출함.
-  if (has_buffer_to_send() == true)
-    reactor_->register_writable(this);
+      // the kernel copied the data, zerocopy costs more than a copy.
+      if (err->ee_code & SO_EE_CODE_ZEROCOPY_COPIED)
+        zerocopy_size_ = 0;
 
-  return;
+      send_queue_.complete_zerocopy(err->ee_info, err->ee_data,
+                                    [&](const SendQueue::Segment &segment)
+                                    { session_->handle_sent(segment.stream_id, segment.data(), segment.length); });
+      completed = true;
+    }
+  }
 }
 
 void
@@ -126,6 +418,27 @@ TCPEventHandler::handle_timeout()
 void
 TCPEventHandler::handle_error(const int &err_no, const std::string &err_str)
 {
+  // EPOLLERR of the zerocopy completions, the socket has no error.
+  if (zerocopy_used_ == true && read_error_queue() == true)
+  {
+    int so_error = 0;
+    socklen_t length = sizeof(so_error);
+    if (::getsockopt(io_handle_, SOL_SOCKET, SO_ERROR, &so_error, &length) == 0 && so_error == 0)
+    {
+      // EPOLLOUT is not raised with EPOLLERR. close_after_sent waits for the completions.
+      if (has_buffer_to_send() == true || close_after_sent_ == true)
+        reactor_->register_writable(this);
+      return;
+    }
+
+    if (so_error != 0)
+    {
+      session_->handle_error(so_error, std::strerror(so_error));
+      ::shutdown(io_handle_, SHUT_RD);
+      return;
+    }
+  }
+
   session_->handle_error(err_no, err_str);
   ::shutdown(io_handle_, SHUT_RD);
 }
@@ -135,3 +448,27 @@ TCPEventHandler::handle_shutdown()
 {
   session_->handle_shutdown();
 }
+
+void
+TCPEventHandler::handle_drain()
+{
+  session_->handle_drain();
+}
+
+void
+TCPEventHandler::handle_idle(const IDLE_TYPE &type)
+{
+  session_->handle_idle(type);
+}
+
+void
+TCPEventHandler::handle_migrated()
+{
+  // the registration of the error event is not moved.
+  if (zerocopy_size_ > 0 || send_queue_.zerocopy_pending() == true)
+    reactor_->register_error_event(this);
+
+  update_queued_bytes();
+
+  session_->handle_migrated();
+}
@@ -10,9 +10,13 @@
 
 #include <reactor/EventHandler.h>
 #include <reactor/acceptor/Acceptor.h>
+#include <reactor/ObjectPool.h>
 #include <reactor/Reactors.h>
+#include <reactor/SendQueue.h>
+#include <reactor/SendWatermark.h>
 
 #include <vector>
+#include <deque>
 #include <string>
 #include <memory>
 #include <arpa/inet.h>
@@ -23,21 +27,63 @@ namespace reactor
 using Bytes = std::vector<uint8_t>;
 
 class TCPSessionHandler;
+class TCPEventHandler;
+
+using TCPEventHandlerPool     = ObjectPool<TCPEventHandler>;
+using TCPEventHandlerPoolPtr  = std::shared_ptr<TCPEventHandlerPool>;
 
 class TCPEventHandler : public EventHandler
 {
 public:
   TCPEventHandler() = delete;
-  static TCPEventHandler *create(TCPSessionHandler       *session,
-                                 const sockaddr_storage  &client_addr,
-                                 Acceptor                &acceptor,
-                                 Reactors                &reactors)
-  { return new TCPEventHandler(session, client_addr, acceptor, reactors); }
+  /**
+   * pool: the handler is taken from it and goes back to it when the session releases it.
+   * the handlers of a pool must have the same acceptor and reactors. (a pool per factory)
+   */
+  static TCPEventHandler *create(TCPSessionHandler            *session,
+                                 const sockaddr_storage       &client_addr,
+                                 Acceptor                     &acceptor,
+                                 Reactors                     &reactors,
+                                 const TCPEventHandlerPoolPtr &pool = nullptr);
   virtual ~TCPEventHandler();
 
+  /**
+   * thread-safe. on the thread of the reactor it is written right away,
+   * without the lock and the writable event. (run to completion)
+   * the rest waits for the writable event.
+   * re-entrant: written right away, the session gets handle_sent, handle_sent_error and
+   * handle_writable inside this call, before it returns. do not hold a lock of the session
+   * taken again by those callbacks while sending from a callback of the reactor thread.
+   * a send from those callbacks is queued, it is not written inside them.
+   * handle_close and handle_removed are not: an error shuts the socket down, the next event closes it.
+   * Bytes and BytesPtr are queued without a copy, BytesPtr can be shared by the handlers.
+   * false: closed, or refused by the send watermark. (see TCPSessionHandler::set_send_watermark)
+   */
   bool send   (const int32_t &stream_id, const std::string &data);
   bool send   (const int32_t &stream_id, const void *data, const size_t &size);
+  bool send   (const int32_t &stream_id, Bytes &&data);
+  bool send   (const int32_t &stream_id, const SendQueue::BytesPtr &data);
+  /**
+   * head and length bytes of file at offset, as a send. the file is written by sendfile(),
+   * not read. handle_sent(stream_id, nullptr, length) after all of it.
+   * false: file is not a regular file. (see SendQueue::File)
+   */
+  bool send   (const int32_t &stream_id, const std::string &head,
+               const SendQueue::FilePtr &file, const size_t &offset, const size_t &length);
+  /**
+   * send of data to the handlers, stream_ids[i] is the id of handlers[i]. (broadcast)
+   * data is shared, the writable events are registered in a batch per reactor.
+   * the result of handlers[i] is set to results[i] if it is not nullptr.
+   * returns the count queued.
+   */
+  static size_t send(TCPEventHandler *const    *handlers,
+                     const int32_t             *stream_ids,
+                     const size_t              &count,
+                     const SendQueue::BytesPtr &data,
+                     bool                      *results = nullptr);
   bool close  ();
+  // closes after the queued data is sent. thread-safe.
+  bool close_after_sent();
   bool set_output_event();
 
 //  int direct_send(const uint8_t *data, const size_t &size);
@@ -48,61 +94,107 @@ public:
   Reactors          &reactors () { return reactors_;}
   sockaddr_storage  addr      () { return addr_;    }
   const io_handle_t &io_handle() const { return this->io_handle_; }
+  // bytes queued to send, see TCPSessionHandler::set_send_watermark.
+  const SendWatermark &watermark() const { return watermark_; }
 
 protected:
-  TCPEventHandler(TCPSessionHandler       *session,
-                  const sockaddr_storage  &client_addr,
-                  Acceptor                &acceptor,
-                  Reactors                &reactors);
+  TCPEventHandler(Acceptor &acceptor, Reactors &reactors);
+
+  // a new or pooled handler starts the connection of the session.
+  void attach(TCPSessionHandler             *session,
+              const sockaddr_storage        &client_addr,
+              const TCPEventHandlerPoolPtr  &pool);
+
+  // the buffers of a pooled handler are freed over this capacity.
+  enum { POOLED_BUFFER_CAPACITY = 65536 };
 
 protected:
   void handle_registered() override;
   void handle_removed   () override;
   void handle_input     () override;
+  void handle_recv      (const uint8_t *data, const size_t &size) override;
   void handle_output    () override;
   void handle_close     () override;
   void handle_timeout   () override;
   void handle_error     (const int &error_no = 0, const std::string &error_str = "") override;
   void handle_shutdown  () override;
+  void handle_drain     () override;
+  void handle_idle      (const IDLE_TYPE &type) override;
+  void handle_migrated  () override;
+
+  void send_buffers     ();
+  bool send_buffer_once ();
+  // sendfile() of the head segment.
+  ssize_t send_file     (const SendQueue::Segment &segment);
+
+  // MSG_ZEROCOPY, see TCPSessionHandler::set_zerocopy.
+  void set_zerocopy     ();
+  // false: no zerocopy completion in the error queue.
+  bool read_error_queue ();
+
+  // push(SendQueue &) queues size bytes. (the send watermark)
+  template<typename PUSH>
+  bool enqueue          (const size_t &size, PUSH push);
+  // writable: the writable event is left to the caller, true if it must be registered. (a batch)
+  template<typename PUSH>
+  bool enqueue          (const size_t &size, PUSH push, bool &writable);
+  // the send watermark refused a send, POLICY_CLOSE closes. returns false.
+  bool refuse           ();
+  // the queued bytes to the gauge of the reactor. the reactor thread. (Reactor::queued_bytes)
+  void update_queued_bytes(const bool &removed = false);
+  bool sendable         () const
+  { return io_handle_ != INVALID_IO_HANDLE && reactor_ != nullptr && close_ == false; }
+  // the reactor thread, false: it is not the thread or the data of the other threads is waiting.
+  template<typename PUSH>
+  bool enqueue_direct   (PUSH push);
+  // the writable event is not registered.
+  template<typename PUSH>
+  void enqueue_prepare  (PUSH push);
 
 protected:
   std::atomic<bool> set_output_event_;
+  std::atomic<bool> close_after_sent_{false};
 
 protected:
   std::shared_ptr<TCPEventHandler> shared_from_this_;
   TCPSessionHandler *session_ = nullptr;
 
 protected:
-  struct send_buffer_info_t
-  {
-    send_buffer_info_t() {}
-    send_buffer_info_t(const int &stream_id, const size_t &begin, const size_t &length)
-    : stream_id(stream_id), begin(begin), length(length), sent_remain(length) {}
-    int32_t stream_id          = -1;
-    size_t  begin       = 0;
-    size_t  length      = 0;
-    size_t  sent_remain = 0;
-  };
-
-  Bytes send_buffer_;
-  std::deque<send_buffer_info_t> send_buffer_infos_;
+  SendQueue send_queue_;
+  // send_buffers() is running, the sessions may send in handle_sent.
+  bool      sending_ = false;
+
+  // 0: MSG_ZEROCOPY disabled. the id of the next MSG_ZEROCOPY call, counted by the kernel too.
+  size_t    zerocopy_size_  = 0;
+  uint32_t  zerocopy_seq_   = 0;
+  bool      zerocopy_used_  = false;
+
+  // the bytes queued, the file regions are not counted.
+  SendWatermark watermark_;
+  // the bytes reported to the gauge of gauge_reactor_.
+  Reactor      *gauge_reactor_ = nullptr;
+  size_t        gauge_bytes_   = 0;
 
 protected:
-  std::mutex  send_buffers_prepare_lock_;
-  Bytes       send_buffers_prepare_;
-  std::deque<send_buffer_info_t> send_buffers_prepare_info_;
+  std::mutex  send_queue_prepare_lock_;
+  SendQueue   send_queue_prepare_;
+  // send_queue_prepare_ is not empty, read without the lock.
+  std::atomic<bool> send_queue_prepared_{false};
 
   bool has_buffer_to_send()
   {
-    if (send_buffer_.size() > 0)
+    if (send_queue_.empty() == false)
       return true;
 
-    std::lock_guard<std::mutex> guard(send_buffers_prepare_lock_);
-    if (send_buffers_prepare_.size() == 0)
+    if (send_queue_prepared_.load(std::memory_order_acquire) == false)
+      return false;
+
+    std::lock_guard<std::mutex> guard(send_queue_prepare_lock_);
+    send_queue_prepared_.store(false, std::memory_order_relaxed);
+    if (send_queue_prepare_.empty() == true)
       return false;
 
-    send_buffer_      .swap(send_buffers_prepare_);
-    send_buffer_infos_.swap(send_buffers_prepare_info_);
+    send_queue_.swap(send_queue_prepare_);
 
     return true;
   }
@@ -146,7 +238,8 @@ TCPEventHandler::~TCPEventHandler()
 inline bool
 TCPEventHandler::set_output_event()
 {
-  if (io_handle_ == INVALID_IO_HANDLE || reactor_ == nullptr || close_ == true)
+  Reactor *reactor = reactor_.load();
+  if (io_handle_ == INVALID_IO_HANDLE || reactor == nullptr || close_ == true)
     return false;
 
   bool comparand = false;
@@ -154,7 +247,7 @@ TCPEventHandler::set_output_event()
   if (exchanged == false)
     return false;
 
-  return reactor_->register_writable(this);
+  return reactor->register_writable(this);
 }
 
 inline bool
@@ -166,21 +259,121 @@ TCPEventHandler::send(const int32_t &stream_id, const std::string &str)
 inline bool
 TCPEventHandler::send(const int32_t &stream_id, const void *data, const size_t &size)
 {
-  if (io_handle_ == INVALID_IO_HANDLE || reactor_ == nullptr || close_ == true)
+  return enqueue(size, [&](SendQueue &queue) { queue.push(stream_id, data, size); });
+}
+
+inline bool
+TCPEventHandler::send(const int32_t &stream_id, Bytes &&data)
+{
+  size_t size = data.size();
+  return enqueue(size, [&](SendQueue &queue) { queue.push(stream_id, std::move(data)); });
+}
+
+inline bool
+TCPEventHandler::send(const int32_t &stream_id, const SendQueue::BytesPtr &data)
+{
+  if (data == nullptr)
     return false;
 
-  {
-    std::lock_guard<std::mutex> guard(send_buffers_prepare_lock_);
-    size_t begin = send_buffers_prepare_.size();
-    send_buffers_prepare_     .insert(send_buffers_prepare_.end(), (uint8_t *)data, (uint8_t *)data + size);
-    send_buffers_prepare_info_.emplace_back(stream_id, begin, size);
-  }
+  return enqueue(data->size(), [&](SendQueue &queue) { queue.push(stream_id, data); });
+}
+
+inline bool
+TCPEventHandler::send(const int32_t &stream_id, const std::string &head,
+                      const SendQueue::FilePtr &file, const size_t &offset, const size_t &length)
+{
+  if (file == nullptr || file->regular() == false)
+    return false;
+
+  return enqueue(head.size(), [&](SendQueue &queue)
+  { queue.push(stream_id, head.data(), head.size(), file, offset, length); });
+}
+
+template<typename PUSH> bool
+TCPEventHandler::enqueue(const size_t &size, PUSH push)
+{
+  bool writable = false;
+  if (enqueue(size, push, writable) == false)
+    return false;
+
+  if (writable == true)
+    reactor_->register_writable(this);
+
+  return true;
+}
+
+template<typename PUSH> bool
+TCPEventHandler::enqueue(const size_t &size, PUSH push, bool &writable)
+{
+  writable = false;
+  if (sendable() == false)
+    return false;
 
-  reactor_->register_writable(this);
+  if (watermark_.add(size) == false)
+    return refuse();
+
+  if (enqueue_direct(push) == true)
+    return true;
+
+  enqueue_prepare(push);
+  writable = true;
 
   return true;
 }
 
+template<typename PUSH> bool
+TCPEventHandler::enqueue_direct(PUSH push)
+{
+  // sending_ and send_queue_ are of the reactor thread, the other threads do not read them.
+  Reactor *reactor = reactor_.load();
+  if (reactor == nullptr || reactor->in_reactor_thread() == false)
+    return false;
+
+  // the data of the other threads goes first if it is waiting.
+  if (sending_ == true ||
+      migrating() == true ||
+      send_queue_prepared_.load(std::memory_order_acquire) == true)
+    return false;
+
+  // not empty: it is waiting for the writable event already.
+  bool waiting = send_queue_.empty() == false;
+  push(send_queue_);
+
+  if (waiting == false)
+    send_buffers();
+
+  return true;
+}
+
+template<typename PUSH> void
+TCPEventHandler::enqueue_prepare(PUSH push)
+{
+  std::lock_guard<std::mutex> guard(send_queue_prepare_lock_);
+  push(send_queue_prepare_);
+  send_queue_prepared_.store(true, std::memory_order_release);
+}
+
+inline bool
+TCPEventHandler::refuse()
+{
+  if (watermark_.policy() == SendWatermark::POLICY_CLOSE)
+    close();
+
+  return false;
+}
+
+inline bool
+TCPEventHandler::close_after_sent()
+{
+  Reactor *reactor = reactor_.load();
+  if (io_handle_ == INVALID_IO_HANDLE || reactor == nullptr || close_ == true)
+    return false;
+
+  // handle_output closes it when nothing is left.
+  close_after_sent_ = true;
+  return reactor->register_writable(this);
+}
+
 inline bool
 TCPEventHandler::close()
 {
@@ -18,10 +18,19 @@ namespace reactor
 class TCPEventHandlerFactory : public EventHandlerFactory
 {
 public:
+  /**
+   * pool_size: the removed event handlers kept for reuse with their buffers. 0: no pool.
+   * see SessionPool for the sessions.
+   */
   TCPEventHandlerFactory(TCPSessionHandlerFactory &factory,
                          Acceptor                 &acceptor,
-                         Reactors                 &reactors)
-  : factory_(factory), acceptor_(acceptor), reactors_(reactors) {}
+                         Reactors                 &reactors,
+                         const size_t             &pool_size = 0)
+  : factory_(factory), acceptor_(acceptor), reactors_(reactors)
+  {
+    if (pool_size > 0)
+      pool_ = std::make_shared<TCPEventHandlerPool>(pool_size);
+  }
   virtual ~TCPEventHandlerFactory() {}
 
   EventHandler *create(const io_handle_t      &client_io_handle,
@@ -36,7 +45,7 @@ public:
 
     try
     {
-      return TCPEventHandler::create(session, client_addr, acceptor_, reactors_);
+      return TCPEventHandler::create(session, client_addr, acceptor_, reactors_, pool_);
     }
     catch (std::runtime_error &e)
     {
@@ -51,6 +60,7 @@ protected:
   TCPSessionHandlerFactory &factory_;
   Acceptor  &acceptor_;
   Reactors  &reactors_;
+  TCPEventHandlerPoolPtr pool_;
 };
 
 }
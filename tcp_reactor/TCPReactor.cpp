@@ -8,6 +8,11 @@
 
 #include "TCPReactor.h"
 
+#include <cstring>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/un.h>
+
 using namespace reactor;
 
 void
@@ -19,16 +24,60 @@ TCPReactor::stop()
       return;
   }
 
+  // the listening sockets are closed by close_listeners.
   for (const auto &accept : acceptor_threads)
-    accept->stop();
+    accept->stop_accept();
 
   reactors.stop();
+  close_listeners();
+
+  std::unique_lock<std::mutex> lock(stop_cond_lock_);
+  stop_     = true;
+  stop_cond_ .notify_all();
+}
+
+void
+TCPReactor::drain(const uint32_t &timeout_msec)
+{
+  {
+    std::unique_lock<std::mutex> lock(stop_cond_lock_);
+    if (stop_ == true)
+      return;
+  }
+
+  for (const auto &accept : acceptor_threads)
+    accept->stop_accept();
+
+  // the AcceptorHandlers remove themselves. (reuse port)
+  reactors.drain(timeout_msec);
+  close_listeners();
 
   std::unique_lock<std::mutex> lock(stop_cond_lock_);
   stop_     = true;
   stop_cond_ .notify_all();
 }
 
+bool
+TCPReactor::handoff(const std::string &path,
+                    const uint32_t    &drain_msec,
+                    const int32_t     &timeout_msec)
+{
+  if (is_run() == false)
+    return false;
+
+  // the order of listen, the new process matches them by the local address.
+  std::vector<io_handle_t> io_handles;
+  for (const listening_t &listening : listening_)
+    io_handles.push_back(listening.acceptor->io_handle());
+
+  if (ListenerHandoff::send(path, io_handles, timeout_msec) == false)
+    return false;
+
+  handed_off_ = true;
+  drain(drain_msec);
+  return true;
+}
+
 void
 TCPReactor::wait()
 {
@@ -39,12 +88,33 @@ TCPReactor::wait()
 bool
 TCPReactor::start()
 {
-  stop_ = false;
+  stop_       = false;
+  handed_off_ = false;
+
+  inherited_handles_.clear();
+  if (handoff_path_.empty() == false)
+  {
+    std::vector<io_handle_t> io_handles;
+    if (ListenerHandoff::receive(handoff_path_, io_handles, handoff_timeout_) == false)
+    {
+      reactor_trace << "no listening socket from" << handoff_path_;
+      return false;
+    }
+
+    inherited_handles_.assign(io_handles.begin(), io_handles.end());
+  }
 
   if (reactors.init(reactor_thread_num_, reactor_max_clients_,
-                    reactor_max_events_, reactor_handler_factory_) == false)
+                    reactor_max_events_, reactor_handler_factory_,
+                    reactor_engine_) == false)
     return false;
 
+  reactors.set_idle_timeout(idle_timeout_msec_, read_timeout_msec_);
+
+  admission_.reset();
+  if (admission_limits_.unlimited() == false)
+    admission_ = std::make_shared<AdmissionControl>(admission_limits_, reactors.get_reactors().size());
+
   reactors.start();
 
   struct scope_exit_t
@@ -56,30 +126,263 @@ TCPReactor::start()
     std::function<void()> exit_func;
   };
 
-  scope_exit_t scope_exit([&](){ reactors.stop(); });
+  scope_exit_t scope_exit([&]()
+  {
+    for (const auto &accept : acceptor_threads)
+      accept->stop_accept();
+
+    reactors.stop();
+    close_listeners();
+    close_inherited_handles();
+  });
+
+  // set_acceptor_* is the first listener.
+  listener_t config;
+  config.type       = acceptor_type_;
+  config.factory    = session_factory_;
+  config.port       = acceptor_port_;
+  config.address    = acceptor_address_;
+  config.thread_num = acceptor_thread_num_;
+  config.backlog    = acceptor_backlog_;
+
+  if (start_listener(config, acceptor) == false)
+    return false;
 
-  switch (acceptor_type_)
+  listeners_.clear();
+  for (const listener_t &listener_config : listener_configs_)
   {
-    case IPV4 : if (acceptor.listen_ipv4  (acceptor_port_, acceptor_address_, acceptor_backlog_) == false) return false; else break;
-    case IPV6 : if (acceptor.listen_ipv6  (acceptor_port_, acceptor_address_, acceptor_backlog_) == false) return false; else break;
-    case IPV46: if (acceptor.listen_ipv46 (acceptor_port_, acceptor_address_, acceptor_backlog_) == false) return false; else break;
+    listeners_.push_back(std::make_shared<Acceptor>());
+    if (start_listener(listener_config, *listeners_.back()) == false)
+      return false;
+  }
+
+  close_inherited_handles();
+
+  scope_exit.ignore = true;
+  return true;
+}
+
+bool
+TCPReactor::listen(const listener_t &config, Acceptor &listener)
+{
+  // from the previous process, its options and reuseport group are kept.
+  io_handle_t io_handle = take_inherited_handle(config);
+  if (io_handle != INVALID_IO_HANDLE)
+    return listener.listen_handle(io_handle);
+
+  listener.set_options(acceptor_options_);
+
+  switch (config.type)
+  {
+    case IPV4 : return listener.listen_ipv4  (config.port, config.address, config.backlog);
+    case IPV6 : return listener.listen_ipv6  (config.port, config.address, config.backlog);
+    case IPV46: return listener.listen_ipv46 (config.port, config.address, config.backlog);
+    case UDS  : return listener.listen_uds   (config.address, true, config.backlog);
     default: return false;
   }
+}
+
+bool
+TCPReactor::start_listener(const listener_t &config, Acceptor &listener)
+{
+  if (config.factory == nullptr)
+  {
+    reactor_trace << "TCPSessionHandlerFactory is nullptr";
+    return false;
+  }
+
+  // a unix domain socket has no reuseport group.
+  if (reuse_port_ == true && config.type != UDS)
+    return start_reuse_port(config, listener);
+
+  if (listen(config, listener) == false)
+    return false;
+
+  listening_.push_back({&listener, false});
 
-  event_factory_ =
-      std::make_shared<TCPEventHandlerFactory>(*session_factory_,
-                                               acceptor,
-                                               reactors);
+  event_factories_.push_back(
+      std::make_shared<TCPEventHandlerFactory>(*config.factory,
+                                               listener,
+                                               reactors,
+                                               handler_pool_size_));
 
-  for (size_t thread_num = 0; thread_num < acceptor_thread_num_; ++thread_num)
+  for (size_t thread_num = 0; thread_num < config.thread_num; ++thread_num)
   {
     acceptor_threads.push_back(
-        std::make_shared<AcceptorThread>(acceptor,
+        std::make_shared<AcceptorThread>(listener,
                                          reactors,
-                                         *(event_factory_.get())));
+                                         *(event_factories_.back().get())));
+    acceptor_threads.back()->set_cpu_affinity(acceptor_cpus_);
+    acceptor_threads.back()->set_admission_control(admission_.get());
     acceptor_threads.back()->start();
   }
 
-  scope_exit.ignore = true;
   return true;
 }
+
+bool
+TCPReactor::start_reuse_port(const listener_t &config, Acceptor &first)
+{
+  const std::vector<Reactor *> &reactor_list = reactors.get_reactors();
+
+  // the index of a socket in the reuseport group is the order of listen.
+  std::vector<Acceptor *>         listeners;
+  std::vector<std::vector<int>>   cpus;
+  for (size_t index = 0; index < reactor_list.size(); ++index)
+  {
+    Acceptor *listener = &first;
+    if (index > 0)
+    {
+      reuse_port_acceptors_.push_back(std::make_shared<Acceptor>());
+      listener = reuse_port_acceptors_.back().get();
+    }
+
+    listener->set_reuse_port(true);
+    if (listen(config, *listener) == false)
+      return false;
+
+    listening_.push_back({listener, true});
+
+    listeners.push_back(listener);
+    cpus     .push_back(reactor_list[index]->cpu_affinity());
+  }
+
+  // the rest of the group from the previous process, it had more reactors.
+  // they are kept for the connections queued on them, the reactors take them in turn.
+  // the steering does not choose them, they come after the reactors in the group.
+  io_handle_t io_handle = INVALID_IO_HANDLE;
+  while ((io_handle = take_inherited_handle(config)) != INVALID_IO_HANDLE)
+  {
+    reuse_port_acceptors_.push_back(std::make_shared<Acceptor>());
+    Acceptor *listener = reuse_port_acceptors_.back().get();
+    if (listener->listen_handle(io_handle) == false)
+      return false;
+
+    listening_.push_back({listener, true});
+    listeners .push_back(listener);
+  }
+
+  if (steer_by_cpu_ == true && first.attach_reuseport_cbpf(reactor_list.size(), cpus) == false)
+    return false;
+
+  for (size_t index = 0; index < listeners.size(); ++index)
+  {
+    event_factories_.push_back(
+        std::make_shared<TCPEventHandlerFactory>(*config.factory,
+                                                 *listeners[index],
+                                                 reactors,
+                                                 handler_pool_size_));
+
+    acceptor_handlers.push_back(
+        std::make_shared<AcceptorHandler>(*listeners[index],
+                                          reactors,
+                                          index % reactor_list.size(),
+                                          *(event_factories_.back().get())));
+
+    acceptor_handlers.back()->set_admission_control(admission_.get());
+    if (acceptor_handlers.back()->register_acceptor() == false)
+      return false;
+  }
+
+  return true;
+}
+
+io_handle_t
+TCPReactor::take_inherited_handle(const listener_t &config)
+{
+  for (std::deque<io_handle_t>::iterator it = inherited_handles_.begin();
+       it != inherited_handles_.end(); ++it)
+  {
+    if (listens_on(config, *it) == false)
+      continue;
+
+    io_handle_t io_handle = *it;
+    inherited_handles_.erase(it);
+    return io_handle;
+  }
+
+  return INVALID_IO_HANDLE;
+}
+
+bool
+TCPReactor::listens_on(const listener_t &config, const io_handle_t &io_handle)
+{
+  struct sockaddr_storage addr;
+  socklen_t addr_size = sizeof(addr);
+  memset(&addr, 0x00, sizeof(addr));
+  if (::getsockname(io_handle, (sockaddr *)&addr, &addr_size) < 0)
+    return false;
+
+  switch (config.type)
+  {
+    case IPV4:
+    {
+      const sockaddr_in &local = *(reinterpret_cast<sockaddr_in *>(&addr));
+      struct in_addr address;
+      if (addr.ss_family != AF_INET || inet_pton(AF_INET, config.address.c_str(), &address) != 1)
+        return false;
+
+      return ntohs(local.sin_port) == config.port && local.sin_addr.s_addr == address.s_addr;
+    }
+    case IPV6:
+    case IPV46:
+    {
+      const sockaddr_in6 &local = *(reinterpret_cast<sockaddr_in6 *>(&addr));
+      struct in6_addr address;
+      if (addr.ss_family != AF_INET6 || inet_pton(AF_INET6, config.address.c_str(), &address) != 1)
+        return false;
+
+      if (ntohs(local.sin6_port) != config.port ||
+          memcmp(&local.sin6_addr, &address, sizeof(address)) != 0)
+        return false;
+
+      // IPV6 is v6 only, IPV46 takes v4 too.
+      int v6only = 0;
+      socklen_t size = sizeof(v6only);
+      if (::getsockopt(io_handle, IPPROTO_IPV6, IPV6_V6ONLY, &v6only, &size) < 0)
+        return false;
+
+      return (v6only != 0) == (config.type == IPV6);
+    }
+    case UDS:
+    {
+      const sockaddr_un &local = *(reinterpret_cast<sockaddr_un *>(&addr));
+      return addr.ss_family == AF_UNIX && config.address == local.sun_path;
+    }
+    default: return false;
+  }
+}
+
+// after the reactors are stopped or drained, the acceptor threads have stopped accepting.
+void
+TCPReactor::close_listeners()
+{
+  for (const listening_t &listening : listening_)
+  {
+    // a pending multishot accept of io_uring keeps the socket until the ring is released,
+    // it must leave the reuseport group now.
+    // handed off: the new process shares the socket, shutdown would stop it there too.
+    // (the AcceptorHandlers have cancelled their accepts on drain)
+    if (listening.on_reactor == true && handed_off_ == false)
+      listening.acceptor->shutdown(SHUT_RDWR);
+
+    listening.acceptor->close();
+  }
+
+  // the threads and the handlers refer to the acceptors and the factories.
+  acceptor_threads     .clear();
+  acceptor_handlers    .clear();
+  event_factories_     .clear();
+  reuse_port_acceptors_.clear();
+  listening_           .clear();
+}
+
+// the listening sockets from the previous process of no listener now. (not configured anymore)
+void
+TCPReactor::close_inherited_handles()
+{
+  for (const io_handle_t &io_handle : inherited_handles_)
+    ::close(io_handle);
+
+  inherited_handles_.clear();
+}
@@ -13,11 +13,13 @@
 #include <tcp_reactor/TCPEventHandlerFactory.h>
 #include <reactor/reactor.h>
 #include <memory>
+#include <deque>
 
 namespace reactor
 {
 
-using AcceptorThreadPtr = std::shared_ptr<AcceptorThread>;
+using AcceptorThreadPtr   = std::shared_ptr<AcceptorThread>;
+using AcceptorHandlerPtr  = std::shared_ptr<AcceptorHandler>;
 
 class TCPReactor
 {
@@ -27,6 +29,7 @@ public:
   Reactors reactors;
   Acceptor acceptor;
   std::deque<AcceptorThreadPtr> acceptor_threads;
+  std::deque<AcceptorHandlerPtr> acceptor_handlers;
 
   void set_acceptor_ipv4  (TCPSessionHandlerFactory *factory,
                            const uint16_t           &port,
@@ -46,17 +49,155 @@ public:
                            const size_t             &thread_num = 1,
                            const int                &backlog    = 1000);
 
+  /**
+   * another listener on the same reactors, with its own session factory.
+   * set_acceptor_* is the first one. (acceptor) the options, the admission limits
+   * and the reuse port mode are shared, a unix domain socket uses the acceptor threads.
+   * call before start().
+   */
+  void add_acceptor_ipv4  (TCPSessionHandlerFactory *factory,
+                           const uint16_t           &port,
+                           const std::string        &address    = "0.0.0.0",
+                           const size_t             &thread_num = 1,
+                           const int                &backlog    = 1000);
+
+  void add_acceptor_ipv6  (TCPSessionHandlerFactory *factory,
+                           const uint16_t           &port,
+                           const std::string        &address    = "::0",
+                           const size_t             &thread_num = 1,
+                           const int                &backlog    = 1000);
+
+  void add_acceptor_ipv46 (TCPSessionHandlerFactory *factory,
+                           const uint16_t           &port,
+                           const std::string        &address    = "::0",
+                           const size_t             &thread_num = 1,
+                           const int                &backlog    = 1000);
+
+  void add_acceptor_uds   (TCPSessionHandlerFactory *factory,
+                           const std::string        &path,
+                           const size_t             &thread_num = 1,
+                           const int                &backlog    = 1000);
+
+  // the listeners of add_acceptor_* in order. valid after start().
+  const std::deque<std::shared_ptr<Acceptor>> &listeners() const { return listeners_; }
+
   void set_reactor        (const size_t             &thread_num = 1,
                            const size_t             &max_clients_per_reactor = 1000,
                            const size_t             &max_events_per_reactor  = 100,
                            ReactorHandlerFactory    *factory = nullptr);
 
+  // demuxer engine of the reactors. (default epoll) call before start().
+  void set_engine         (const Reactor::IoDemuxer::ENGINE &engine) { reactor_engine_ = engine; }
+
+  /**
+   * idle sessions are closed without a timer per session. 0: disabled. (default)
+   * see Reactor::set_idle_timeout, TCPSessionHandler::handle_idle. call before start().
+   */
+  void set_idle_timeout   (const uint32_t &idle_msec, const uint32_t &read_msec = 0)
+  {
+    idle_timeout_msec_ = idle_msec;
+    read_timeout_msec_ = read_msec;
+  }
+
+  // options of the listening sockets, see AcceptorOptions. call before start().
+  void set_acceptor_options(const AcceptorOptions &options) { acceptor_options_ = options; }
+
+  /**
+   * removed event handlers kept for reuse with their buffers, per listener. 0: no pool. (default)
+   * see SessionPool for the sessions. call before start().
+   */
+  void set_handler_pool_size(const size_t &size) { handler_pool_size_ = size; }
+
+  /**
+   * connection caps, accept rate and source ip limits of the acceptors. (default unlimited)
+   * over a limit the acceptors stop reading the listening socket. the source ip limit
+   * closes the connection. see AdmissionControl. call before start().
+   */
+  void set_admission_limits(const AdmissionLimits &limits) { admission_limits_ = limits; }
+
+  // accepted/rejected/deferred counts, nullptr if unlimited. valid after start().
+  const AdmissionControl *admission_control() const { return admission_.get(); }
+
+  /**
+   * pins reactor i on reactor_cpus[i % size] and the acceptor threads on acceptor_cpus.
+   * see Reactors::set_cpu_affinity, CpuAffinity::numa_node_cpus. call before start().
+   */
+  void set_cpu_affinity   (const std::vector<std::vector<int>> &reactor_cpus,
+                           const std::vector<int>              &acceptor_cpus = std::vector<int>())
+  {
+    reactors.set_cpu_affinity(reactor_cpus);
+    acceptor_cpus_ = acceptor_cpus;
+  }
+
+  /**
+   * a SO_REUSEPORT listener per reactor instead of the acceptor threads. (AcceptorHandler)
+   * a connection is accepted and registered on the reactor thread, no hand-off.
+   * acceptor is the listener of the first reactor, the thread_num of set_acceptor_* is ignored.
+   * steer_by_cpu: the connection goes to the reactor pinned on the cpu that received it,
+   * see set_cpu_affinity, Acceptor::attach_reuseport_cbpf. call before start().
+   */
+  void set_reuse_port     (const bool &value, const bool &steer_by_cpu = false)
+  {
+    reuse_port_   = value;
+    steer_by_cpu_ = steer_by_cpu;
+  }
+
+  /**
+   * the listening sockets of the previous process are received from path
+   * by start() instead of a new listen. see handoff, ListenerHandoff.
+   * start() fails if nothing comes within timeout_msec. call before start().
+   */
+  void set_handoff_path   (const std::string &path, const int32_t &timeout_msec = 5000)
+  {
+    handoff_path_     = path;
+    handoff_timeout_  = timeout_msec;
+  }
+
   bool start  ();
   void stop   ();
   void wait   ();
   bool is_run () const { return !stop_; }
 
+  /**
+   * stops accepting and waits up to timeout_msec for the sessions to finish.
+   * idle sessions are closed at once, a request in progress after its response.
+   * (see TCPSessionHandler::handle_drain) the sessions left get handle_shutdown.
+   */
+  void drain  (const uint32_t &timeout_msec);
+
+  /**
+   * zero downtime restart. waits timeout_msec (-1: forever) for the new process
+   * (set_handoff_path) on path, passes the listening sockets and drains.
+   * false: nothing was sent, still running.
+   */
+  bool handoff(const std::string &path,
+               const uint32_t    &drain_msec,
+               const int32_t     &timeout_msec = -1);
+
 private:
+  enum { IPV4, IPV6, IPV46, UDS };
+
+  struct listener_t
+  {
+    int         type        = IPV4;
+    TCPSessionHandlerFactory *factory = nullptr;
+    uint16_t    port        = 0;
+    // path of UDS
+    std::string address;
+    size_t      thread_num  = 1;
+    int         backlog     = 100;
+  };
+
+  bool listen           (const listener_t &config, Acceptor &listener);
+  bool start_listener   (const listener_t &config, Acceptor &listener);
+  bool start_reuse_port (const listener_t &config, Acceptor &listener);
+  void close_listeners  ();
+  void close_inherited_handles();
+
+  // the first inherited socket listening on the address of config, INVALID_IO_HANDLE: none.
+  io_handle_t take_inherited_handle(const listener_t &config);
+  static bool listens_on(const listener_t &config, const io_handle_t &io_handle);
+
   void set_acceptor(const int                 &type,
                     TCPSessionHandlerFactory  *factory,
                     const uint16_t            &port,
@@ -64,23 +205,61 @@ private:
                     const size_t              &thread_num,
                     const int                 &backlog);
 
+  void add_acceptor(const int                 &type,
+                    TCPSessionHandlerFactory  *factory,
+                    const uint16_t            &port,
+                    const std::string         &address,
+                    const size_t              &thread_num,
+                    const int                 &backlog);
+
 private:
   size_t      reactor_thread_num_   = 1;
   size_t      reactor_max_clients_  = 10000;
   size_t      reactor_max_events_   = 100;
   ReactorHandlerFactory *reactor_handler_factory_ = nullptr;
+  Reactor::IoDemuxer::ENGINE reactor_engine_ = Reactor::IoDemuxer::ENGINE_EPOLL;
+  uint32_t    idle_timeout_msec_    = 0;
+  uint32_t    read_timeout_msec_    = 0;
 
 private:
-  enum { IPV4, IPV6, IPV46 };
   int         acceptor_type_        = IPV4;
   size_t      acceptor_thread_num_  = 1;
   std::string acceptor_address_;
   uint16_t    acceptor_port_        = 0;
   int         acceptor_backlog_     = 100;
+  std::vector<int> acceptor_cpus_;
+  AcceptorOptions  acceptor_options_;
+  size_t           handler_pool_size_ = 0;
+  AdmissionLimits  admission_limits_;
+  std::shared_ptr<AdmissionControl> admission_;
+
+private:
+  std::deque<listener_t>                listener_configs_;
+  std::deque<std::shared_ptr<Acceptor>> listeners_;
+
+  // the listening sockets in the order of listen. (handoff)
+  struct listening_t
+  {
+    Acceptor  *acceptor   = nullptr;
+    // an AcceptorHandler on a reactor, or the acceptor threads.
+    bool      on_reactor  = false;
+  };
+  std::vector<listening_t> listening_;
+
+private:
+  bool        reuse_port_           = false;
+  bool        steer_by_cpu_         = false;
+  std::deque<std::shared_ptr<Acceptor>>               reuse_port_acceptors_;
+  std::deque<std::shared_ptr<TCPEventHandlerFactory>> event_factories_;
+
+private:
+  std::string             handoff_path_;
+  int32_t                 handoff_timeout_  = 5000;
+  bool                    handed_off_       = false;
+  std::deque<io_handle_t> inherited_handles_;
 
 private:
   TCPSessionHandlerFactory *session_factory_ = nullptr;
-  std::shared_ptr<TCPEventHandlerFactory> event_factory_;
 
 private:
   bool                    stop_ = false;
@@ -138,6 +317,64 @@ TCPReactor::set_acceptor(const int                &type,
   acceptor_backlog_     = backlog;
 }
 
+inline void
+TCPReactor::add_acceptor_ipv4(TCPSessionHandlerFactory  *factory,
+                              const uint16_t            &port,
+                              const std::string         &address,
+                              const size_t              &thread_num,
+                              const int                 &backlog)
+{
+  this->add_acceptor(IPV4, factory, port, address, thread_num, backlog);
+}
+
+inline void
+TCPReactor::add_acceptor_ipv6(TCPSessionHandlerFactory  *factory,
+                              const uint16_t            &port,
+                              const std::string         &address,
+                              const size_t              &thread_num,
+                              const int                 &backlog)
+{
+  this->add_acceptor(IPV6, factory, port, address, thread_num, backlog);
+}
+
+inline void
+TCPReactor::add_acceptor_ipv46(TCPSessionHandlerFactory *factory,
+                               const uint16_t           &port,
+                               const std::string        &address,
+                               const size_t             &thread_num,
+                               const int                &backlog)
+{
+  this->add_acceptor(IPV46, factory, port, address, thread_num, backlog);
+}
+
+inline void
+TCPReactor::add_acceptor_uds(TCPSessionHandlerFactory *factory,
+                             const std::string        &path,
+                             const size_t             &thread_num,
+                             const int                &backlog)
+{
+  this->add_acceptor(UDS, factory, 0, path, thread_num, backlog);
+}
+
+inline void
+TCPReactor::add_acceptor(const int                &type,
+                         TCPSessionHandlerFactory *factory,
+                         const uint16_t           &port,
+                         const std::string        &address,
+                         const size_t             &thread_num,
+                         const int                &backlog)
+{
+  listener_t config;
+  config.type       = type;
+  config.factory    = factory;
+  config.port       = port;
+  config.address    = address;
+  config.thread_num = thread_num;
+  config.backlog    = backlog;
+
+  listener_configs_.push_back(config);
+}
+
 inline void
 TCPReactor::set_reactor(const size_t           &thread_num,
                         const size_t           &max_clients_per_reactor,
@@ -10,6 +10,12 @@ TCPSessionHandler::io_handle() const
   return event_handler_->io_handle();
 }
 
+bool
+TCPSessionHandler::edge_triggered() const
+{
+  return event_handler_->edge_triggered();
+}
+
 const Acceptor &
 TCPSessionHandler::acceptor()
 {
@@ -34,6 +40,39 @@ TCPSessionHandler::send(const int32_t &id, const std::string &data)
   return event_handler_->send(id, (const uint8_t *)data.data(), data.size());
 }
 
+bool
+TCPSessionHandler::send(const int32_t &id, Bytes &&data)
+{
+  return event_handler_->send(id, std::move(data));
+}
+
+bool
+TCPSessionHandler::send(const int32_t &id, const SendQueue::BytesPtr &data)
+{
+  return event_handler_->send(id, data);
+}
+
+bool
+TCPSessionHandler::send(const int32_t &id, const std::string &head,
+                        const SendQueue::FilePtr &file, const size_t &offset, const size_t &length)
+{
+  return event_handler_->send(id, head, file, offset, length);
+}
+
+size_t
+TCPSessionHandler::send(TCPSessionHandler *const  *sessions,
+                        const int32_t             *ids,
+                        const size_t              &count,
+                        const SendQueue::BytesPtr &data,
+                        bool                      *results)
+{
+  std::vector<TCPEventHandler *> handlers(count);
+  for (size_t index = 0; index < count; ++index)
+    handlers[index] = sessions[index]->event_handler_.get();
+
+  return TCPEventHandler::send(handlers.data(), ids, count, data, results);
+}
+
 //int
 //TCPSessionHandler::direct_send(const uint8_t *data, const size_t &size)
 //{
@@ -78,12 +117,13 @@ void
 TCPSessionHandler::handle_timeout()
 {
   int32_t min_msec = 0;
+  std::vector<int64_t> timeouts;
   while ((min_msec = timer_.get_min_timeout_milliseconds()) == 0)
   {
-    std::deque<std::unordered_set<int64_t>> timeouts = timer_.extract_timeout_objects();
-    for (const auto &keys : timeouts)
-      for (const auto &key : keys)
-        this->handle_timeout(key);
+    timeouts.clear();
+    timer_.extract_timeout_objects(timeouts);
+    for (const int64_t &key : timeouts)
+      this->handle_timeout(key);
   }
 
   //  reactor_trace << min_msec;
@@ -105,6 +145,51 @@ TCPSessionHandler::close()
   return event_handler_->close();
 }
 
+bool
+TCPSessionHandler::close_after_sent()
+{
+  return event_handler_->close_after_sent();
+}
+
+bool
+TCPSessionHandler::migrate(const size_t &reactor_index)
+{
+  return event_handler_->reactors().migrate(event_handler_.get(), reactor_index);
+}
+
+int32_t
+TCPSessionHandler::reactor_index() const
+{
+  return event_handler_->reactors().reactor_index(event_handler_->reactor());
+}
+
+size_t
+TCPSessionHandler::send_queued_bytes() const
+{
+  return event_handler_->watermark().bytes();
+}
+
+bool
+TCPSessionHandler::send_blocked() const
+{
+  return event_handler_->watermark().blocked();
+}
+
+void
+TCPSessionHandler::reuse_session(const struct sockaddr_storage &addr)
+{
+  set_socket_address(addr);
+  handle_reused();
+}
+
+void
+TCPSessionHandler::release_session()
+{
+  // the event handler goes back to its pool.
+  timer_.clear();
+  event_handler_.reset();
+}
+
 void
 TCPSessionHandler::set_socket_address(const struct sockaddr_storage &addr)
 {
@@ -11,6 +11,8 @@
 #include <reactor/acceptor/Acceptor.h>
 #include <reactor/ObjectsTimer.h>
 #include <reactor/Reactors.h>
+#include <reactor/SendQueue.h>
+#include <reactor/SendWatermark.h>
 #include <reactor/trace.h>
 
 #include <vector>
@@ -54,6 +56,13 @@ protected:
    * @param size
    */
   virtual void handle_input     () = 0;
+  /**
+   * set_recv_completion(true)이고 reactor가 io_uring engine이면 handle_input 대신 호출됨.
+   * reactor가 이미 수신한 데이터이며 이 함수 안에서만 유효함.
+   * @param data
+   * @param size 0보다 큼.
+   */
+  virtual void handle_recv      (const uint8_t *data, const size_t &size) { (void)data; (void)size; }
   /**
    * set_handle_output_event를 호출하고 보낼버퍼가 비어있다면 이 함수를 호출해준다.
    */
@@ -88,18 +97,118 @@ protected:
    * Reactor의 shutdown이 되었을때 호출됨.
    */
   virtual void handle_shutdown  () = 0;
+  /**
+   * SessionPool에서 새 접속에 재사용될때 호출됨. 이전 접속의 상태를 초기화한다.
+   * peer 주소는 새 접속의 것으로 바뀌어 있음.
+   */
+  virtual void handle_reused    () {}
+  /**
+   * Reactor::drain으로 서버가 종료중일때 호출됨. 기본 동작은 close_after_sent().
+   * 처리중인 요청을 먼저 끝내려면 재정의함. (Http1Handler 참고)
+   * 제한시간까지 남아있는 session은 handle_shutdown이 호출됨.
+   */
+  virtual void handle_drain     () { close_after_sent(); }
+  /**
+   * Reactor::set_idle_timeout에 지정한 시간동안 유휴상태일때 호출됨.
+   * 기본 동작: IDLE_TIMEOUT은 close, IDLE_READ_TIMEOUT은 전송 대기중인 데이터를 보낸 후 close.
+   */
+  virtual void handle_idle      (const EventHandler::IDLE_TYPE &type)
+  {
+    if (type == EventHandler::IDLE_TIMEOUT)
+      close();
+    else
+      close_after_sent();
+  }
+  /**
+   * migrate()가 완료되어 새 reactor에서 처리되기 시작할때 호출됨.
+   * 접속, 전송 대기중인 데이터와 timer는 그대로 유지됨.
+   */
+  virtual void handle_migrated  () {}
+  /**
+   * set_send_watermark로 send가 거부된 후, 전송 대기중인 데이터가 low watermark 아래로
+   * 줄었을때 호출됨. 다시 send 할 수 있음. reactor thread에서 호출됨.
+   */
+  virtual void handle_writable  () {}
 
 public:
   const Acceptor &acceptor();
 
 public:
+  /**
+   * see TCPEventHandler::send. called on the reactor thread (from a callback of this session),
+   * the data is written at once and handle_sent/handle_sent_error/handle_writable may be
+   * called before send returns. a lock held around send must not be taken in them.
+   */
   bool send             (const int32_t  &id,    const uint8_t *data, const size_t &size);
   bool send             (const int32_t  &id,    const std::string &bytes);
+  // queued without a copy. data can be shared by the sessions. (broadcast)
+  bool send             (const int32_t  &id,    Bytes &&data);
+  bool send             (const int32_t  &id,    const SendQueue::BytesPtr &data);
+  /**
+   * head and length bytes of file at offset, as a send by sendfile(). (large static files)
+   * handle_sent(id, nullptr, length) after all of it, see TCPEventHandler::send.
+   */
+  bool send             (const int32_t  &id,    const std::string &head,
+                         const SendQueue::FilePtr &file, const size_t &offset, const size_t &length);
+  /**
+   * send of data to the sessions, ids[i] is the id of sessions[i]. (broadcast)
+   * see TCPEventHandler::send, returns the count queued.
+   */
+  static size_t send    (TCPSessionHandler *const  *sessions,
+                         const int32_t             *ids,
+                         const size_t              &count,
+                         const SendQueue::BytesPtr &data,
+                         bool                      *results = nullptr);
   bool set_timeout      (const uint32_t &msec,  const int64_t     &key = 0);
   bool unset_timeout    (const int64_t  &key = 0);
   void handle_timeout   ();
   bool set_output_event ();
   bool close            ();
+  // closes after the queued data is sent.
+  bool close_after_sent ();
+  // see Reactors::migrate. handle_migrated on the new reactor.
+  bool migrate          (const size_t &reactor_index);
+  // index of the reactor serving this session in Reactors, -1: not registered.
+  int32_t reactor_index () const;
+
+  /**
+   * call in the constructor. see EventHandler::TRIGGER_MODE.
+   * in edge-triggered mode handle_input must recv until EAGAIN.
+   */
+  void set_trigger_mode (const EventHandler::TRIGGER_MODE &mode) { trigger_mode_ = mode; }
+  bool edge_triggered   () const;
+
+  /**
+   * call in the constructor. see EventHandler::set_recv_completion.
+   * handle_input is still called by the epoll engine.
+   */
+  void set_recv_completion(const bool &value) { recv_completion_ = value; }
+
+  /**
+   * call in the constructor. MSG_ZEROCOPY for the data over size, 0: disabled. (default)
+   * the data of its own buffer only: send(Bytes &&), send(BytesPtr) and the sends over
+   * SendQueue::COPY_SIZE. its handle_sent is called after the kernel completed it.
+   * it is disabled if the kernel copies anyway. (e.g. the loopback)
+   */
+  void set_zerocopy     (const size_t &size) { zerocopy_size_ = size; }
+
+  /**
+   * call in the constructor. limit of the bytes queued to send, not written yet. (backpressure)
+   * over high, send() returns false (POLICY_CLOSE: the connection is closed too) until
+   * handle_writable(), when it goes under low. an empty queue takes a send over high.
+   * the file regions are not counted. high 0: no limit. (default)
+   */
+  void set_send_watermark(const size_t &high, const size_t &low,
+                          const SendWatermark::POLICY &policy = SendWatermark::POLICY_REJECT)
+  {
+    send_high_watermark_ = high;
+    send_low_watermark_  = low;
+    send_policy_         = policy;
+  }
+  // bytes queued to send, not written yet. thread-safe.
+  size_t send_queued_bytes() const;
+  // over the high watermark, send() is refused until handle_writable(). thread-safe.
+  bool   send_blocked     () const;
 
   bool is_ipv6() const { return ipv6_; }
   bool is_ipv4() const { return ipv4_; }
@@ -118,8 +227,18 @@ protected:
 private:
   void set_socket_address(const struct ::sockaddr_storage &client_addr);
 
+  // SessionPool
+  void reuse_session     (const struct ::sockaddr_storage &client_addr);
+  void release_session   ();
+
 private:
   ObjectsTimer<int64_t> timer_;
+  EventHandler::TRIGGER_MODE trigger_mode_ = EventHandler::TRIGGER_REACTOR_DEFAULT;
+  bool                       recv_completion_ = false;
+  size_t                     zerocopy_size_   = 0;
+  size_t                     send_high_watermark_ = 0;
+  size_t                     send_low_watermark_  = 0;
+  SendWatermark::POLICY      send_policy_ = SendWatermark::POLICY_REJECT;
 
 private:
   std::string peer_addr_;
@@ -136,6 +255,7 @@ private:
 private:
   std::shared_ptr<TCPEventHandler> event_handler_;
   friend class TCPEventHandler;
+  template<typename> friend class SessionPool;
 };
 
 }